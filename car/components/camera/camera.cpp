@@ -5,10 +5,24 @@
 #include "esp_camera.h"
 #include "driver/i2c_master.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "DFRobot_AXP313A.h"
+#include "sdkconfig.h"
 
 static const char* TAG = "camera";
 
+// Every frame handed to the stream stays out of the driver until it is sent:
+// each subscriber holds one while sending and the newest one waits for all of
+// them, while the frame queue holds CAMERA_FRAME_QUEUE_DEPTH more. One buffer
+// on top of those is always free to capture into, so slow clients never starve
+// the sensor.
+#ifdef CONFIG_WEB_SERVER_STREAM_MAX_SUBSCRIBERS
+#define CAMERA_STREAM_SUBSCRIBERS CONFIG_WEB_SERVER_STREAM_MAX_SUBSCRIBERS
+#else
+#define CAMERA_STREAM_SUBSCRIBERS 1
+#endif
+#define CAMERA_FB_COUNT (CAMERA_STREAM_SUBSCRIBERS + 1 + CAMERA_FRAME_QUEUE_DEPTH + 1)
+
 #define CAM_PIN_PWDN -1
 #define CAM_PIN_RESET -1
 #define CAM_PIN_XCLK 45
@@ -54,7 +68,7 @@ static camera_config_t camera_config = {
 
     // Lower number = higher quality / larger JPEGs.
     .jpeg_quality = 10,
-    .fb_count = 2,
+    .fb_count = CAMERA_FB_COUNT,
     .fb_location = CAMERA_FB_IN_PSRAM,
     .grab_mode = CAMERA_GRAB_LATEST,
 
@@ -93,15 +107,20 @@ void camera_task(void* p) {
     frame = esp_camera_fb_get();
     if (!frame) {
       ESP_LOGW(TAG, "esp_camera_fb_get() returned NULL");
+      camera_metrics_frame_dropped("capture_failed");
       vTaskDelay(pdMS_TO_TICKS(10));
       continue;
     }
+    camera_frame_t item = {frame, esp_timer_get_time()};
 
     camera_metrics_update(frame->len);
 
-    if (xQueueSendToBack(g_frame_queue, &frame, portMAX_DELAY) != pdPASS) {
-      ESP_LOGE(TAG, "xQueueSendToBack failed");
-      break;
+    // Never wait for the consumer: the driver keeps grabbing the latest frame,
+    // so the next one is newer than any frame that would have waited here.
+    if (xQueueSendToBack(g_frame_queue, &item, 0) != pdPASS) {
+      ESP_LOGD(TAG, "Frame queue full, dropping frame");
+      esp_camera_fb_return(frame);
+      camera_metrics_frame_dropped("queue_full");
     }
   }
   ESP_LOGW(TAG, "Camera task stopped");
@@ -0,0 +1,79 @@
+#include "camera_abr.hpp"
+#include "camera_metrics.hpp"
+#include "esp_log.h"
+
+static const char* TAG = "camera_abr";
+
+// Frame size never exceeds FRAMESIZE_VGA: esp_camera_init sized the JPEG
+// buffers for it, so only smaller frames may be selected at runtime.
+static const camera_abr_level_t kLevels[] = {
+    {FRAMESIZE_VGA, 10},  {FRAMESIZE_VGA, 15},  {FRAMESIZE_VGA, 22},  {FRAMESIZE_HVGA, 15},
+    {FRAMESIZE_QVGA, 15}, {FRAMESIZE_QVGA, 25}, {FRAMESIZE_QQVGA, 25},
+};
+static constexpr size_t kLevelCount = sizeof(kLevels) / sizeof(kLevels[0]);
+
+// Per-frame send budget for a 20 FPS stream.
+static constexpr int64_t kSendBudgetUs = 50000;
+// Windows the link must keep up, with headroom, before stepping back up.
+static constexpr uint32_t kGoodWindowsToUpgrade = 3;
+
+// Weak signal caps the best level regardless of measured send times: by the
+// time sends slow down the link is usually already retrying.
+static size_t rssi_floor(int rssi) {
+  if (rssi < -80) return 4;
+  if (rssi < -72) return 1;
+  return 0;
+}
+
+size_t camera_abr_level_count() { return kLevelCount; }
+
+const camera_abr_level_t* camera_abr_level(size_t level) {
+  return level < kLevelCount ? &kLevels[level] : NULL;
+}
+
+size_t camera_abr_step(camera_abr_state_t* state, const camera_abr_sample_t* sample) {
+  bool congested = sample->peak_send_us > kSendBudgetUs || sample->dropped * 4 > sample->frames;
+  bool headroom = sample->peak_send_us < kSendBudgetUs / 2 && sample->dropped == 0;
+  if (congested) {
+    if (state->level + 1 < kLevelCount) state->level++;
+    state->good_windows = 0;
+  } else if (headroom && sample->frames > 0) {
+    if (++state->good_windows >= kGoodWindowsToUpgrade) {
+      if (state->level > 0) state->level--;
+      state->good_windows = 0;
+    }
+  } else {
+    state->good_windows = 0;
+  }
+  if (sample->rssi_valid) {
+    size_t floor = rssi_floor(sample->rssi);
+    if (state->level < floor) state->level = floor;
+  }
+  return state->level;
+}
+
+static camera_abr_state_t s_state = {};
+
+void camera_abr_update(const camera_abr_sample_t* sample) {
+  size_t previous = s_state.level;
+  size_t level = camera_abr_step(&s_state, sample);
+  if (level == previous) return;
+
+  sensor_t* sensor = esp_camera_sensor_get();
+  if (!sensor) {
+    ESP_LOGW(TAG, "esp_camera_sensor_get() returned NULL");
+    return;
+  }
+  const camera_abr_level_t* next = &kLevels[level];
+  ESP_LOGI(TAG,
+           "Level %u -> %u (framesize %d, quality %d, peak send %lld us, %lu/%lu dropped, "
+           "rssi %d)",
+           (unsigned)previous, (unsigned)level, next->frame_size, next->quality,
+           (long long)sample->peak_send_us, (unsigned long)sample->dropped,
+           (unsigned long)sample->frames, sample->rssi);
+  if (sensor->set_framesize(sensor, next->frame_size) != 0 ||
+      sensor->set_quality(sensor, next->quality) != 0) {
+    ESP_LOGW(TAG, "Failed to apply level %u", (unsigned)level);
+  }
+  camera_metrics_abr_level(level);
+}
@@ -18,8 +18,10 @@ namespace {
 static constexpr int64_t kFrameBufferBytes = 61440;
 
 static opentelemetry::nostd::shared_ptr<metrics_api::Counter<uint64_t>> s_frames_captured;
+static opentelemetry::nostd::shared_ptr<metrics_api::Counter<uint64_t>> s_frames_dropped;
 static opentelemetry::nostd::shared_ptr<metrics_api::ObservableInstrument> s_frame_size;
 static opentelemetry::nostd::shared_ptr<metrics_api::ObservableInstrument> s_frame_buffer;
+static opentelemetry::nostd::shared_ptr<metrics_api::ObservableInstrument> s_abr_level_gauge;
 
 // Peak delivered frame size since the last metric collection; reset on read so
 // each scrape reports the interval peak (the signal for nearing the buffer).
@@ -36,6 +38,13 @@ static void cb_frame_buffer(metrics_api::ObserverResult obs, void*) {
   observe_int64(obs, kFrameBufferBytes);
 }
 
+// Current adaptive bitrate level, written by camera_abr_update().
+static size_t s_abr_level = 0;
+
+static void cb_abr_level(metrics_api::ObserverResult obs, void*) {
+  observe_int64(obs, static_cast<int64_t>(s_abr_level));
+}
+
 }  // namespace
 #endif  // CONFIG_ESP_OPENTELEMETRY_METRICS_ENABLED
 
@@ -46,6 +55,8 @@ void camera_metrics_setup() {
 
   s_frames_captured =
       meter->CreateUInt64Counter("dust_mite.frames_captured", "Camera frames captured", "{frame}");
+  s_frames_dropped = meter->CreateUInt64Counter(
+      "dust_mite.camera.frames_dropped", "Camera frames not handed to the stream", "{frame}");
 
   s_frame_size = meter->CreateInt64ObservableGauge(
       "dust_mite.camera.frame_size_bytes", "Peak delivered JPEG frame size since last collection",
@@ -55,6 +66,11 @@ void camera_metrics_setup() {
   s_frame_buffer = meter->CreateInt64ObservableGauge(
       "dust_mite.camera.frame_buffer_bytes", "JPEG frame-buffer capacity (drop limit)", "By");
   s_frame_buffer->AddCallback(cb_frame_buffer, nullptr);
+
+  s_abr_level_gauge = meter->CreateInt64ObservableGauge(
+      "dust_mite.camera.abr_level",
+      "Adaptive bitrate level (0 = VGA at init quality, higher = smaller/coarser)", "1");
+  s_abr_level_gauge->AddCallback(cb_abr_level, nullptr);
 #endif
 }
 
@@ -66,3 +82,19 @@ void camera_metrics_update(size_t frame_size) {
   (void)frame_size;
 #endif
 }
+
+void camera_metrics_abr_level(size_t level) {
+#ifdef CONFIG_ESP_OPENTELEMETRY_METRICS_ENABLED
+  s_abr_level = level;
+#else
+  (void)level;
+#endif
+}
+
+void camera_metrics_frame_dropped(const char* reason) {
+#ifdef CONFIG_ESP_OPENTELEMETRY_METRICS_ENABLED
+  if (s_frames_dropped) s_frames_dropped->Add(1, {{"reason", reason}});
+#else
+  (void)reason;
+#endif
+}
@@ -4,11 +4,27 @@
 extern "C" {
 #endif
 
+#include <stdint.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
 #include "driver/i2c_master.h"
+#include "esp_camera.h"
+
+// Item of the frame queue. fb->timestamp is the start of the frame's capture
+// and fb_get_us when camera_task got it from the driver, both on the esp_timer
+// clock. The consumer returns fb to the driver.
+typedef struct {
+  camera_fb_t* fb;
+  int64_t fb_get_us;
+} camera_frame_t;
+
+// Length of the frame queue passed to camera_setup. The driver's frame buffers
+// are sized for it.
+#define CAMERA_FRAME_QUEUE_DEPTH 2
 
 void camera_init(i2c_master_bus_handle_t i2c_bus);
+// frame_queue holds camera_frame_t items. camera_task never waits for room:
+// a frame that does not fit is returned to the driver and counted as dropped.
 void camera_setup(QueueHandle_t frame_queue, i2c_master_bus_handle_t i2c_bus);
 void camera_start();
 void camera_stop();
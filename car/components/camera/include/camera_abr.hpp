@@ -0,0 +1,47 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_camera.h"
+
+// Adaptive bitrate control for the camera stream. The sensor steps down a
+// ladder of (frame size, JPEG quality) levels when the link falls behind and
+// climbs back once it has kept up for a while. Level 0 is the configuration
+// the camera is initialised with; the controller never goes above it.
+typedef struct {
+  framesize_t frame_size;
+  int quality;
+} camera_abr_level_t;
+
+// Link feedback gathered by the stream sender over one control window.
+typedef struct {
+  uint32_t frames;       // frames handed to stream subscribers
+  uint32_t dropped;      // frames replaced before a subscriber could send them
+  int64_t peak_send_us;  // slowest single frame send
+  int rssi;              // dBm
+  bool rssi_valid;       // false when the station RSSI could not be read
+} camera_abr_sample_t;
+
+typedef struct {
+  size_t level;
+  uint32_t good_windows;
+} camera_abr_state_t;
+
+size_t camera_abr_level_count();
+const camera_abr_level_t* camera_abr_level(size_t level);
+
+// Advances the controller by one window and returns the new level. Pure: does
+// not touch the sensor.
+size_t camera_abr_step(camera_abr_state_t* state, const camera_abr_sample_t* sample);
+
+// Steps the camera's controller and applies a level change to the sensor.
+void camera_abr_update(const camera_abr_sample_t* sample);
+
+#ifdef __cplusplus
+}
+#endif
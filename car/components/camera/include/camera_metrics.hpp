@@ -4,3 +4,7 @@
 
 void camera_metrics_setup();
 void camera_metrics_update(size_t frame_size);
+void camera_metrics_abr_level(size_t level);
+// reason: "queue_full" (the frame queue had no room) or "capture_failed"
+// (esp_camera_fb_get() returned no frame).
+void camera_metrics_frame_dropped(const char* reason);
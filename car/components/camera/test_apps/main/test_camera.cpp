@@ -76,13 +76,13 @@ TEST_CASE("single_frame", "[camera]") {
 
 TEST_CASE("dma_stress", "[camera]") {
   // Hold one frame buffer for 200 ms while the camera keeps producing to stress
-  // the DMA pool with fb_count=2 (slow consumer vs. fast producer).
+  // the DMA pool (slow consumer vs. fast producer).
   camera_fb_t* frame1 = esp_camera_fb_get();
   TEST_ASSERT_NOT_NULL(frame1);
 
   vTaskDelay(pdMS_TO_TICKS(200));
 
-  // With CAMERA_GRAB_LATEST and one buffer held, the second slot should still
+  // With CAMERA_GRAB_LATEST and one buffer held, another slot should still
   // be available and deliver a valid frame.
   camera_fb_t* frame2 = esp_camera_fb_get();
   TEST_ASSERT_NOT_NULL(frame2);
@@ -0,0 +1,80 @@
+#include "camera_abr.hpp"
+#include "unity.h"
+
+static camera_abr_sample_t healthy_sample() {
+  camera_abr_sample_t sample = {};
+  sample.frames = 20;
+  sample.dropped = 0;
+  sample.peak_send_us = 10000;
+  sample.rssi = -50;
+  sample.rssi_valid = true;
+  return sample;
+}
+
+TEST_CASE("abr_level_0_is_init_config", "[camera_abr]") {
+  const camera_abr_level_t* level = camera_abr_level(0);
+  TEST_ASSERT_NOT_NULL(level);
+  TEST_ASSERT_EQUAL(FRAMESIZE_VGA, level->frame_size);
+  TEST_ASSERT_EQUAL(10, level->quality);
+  TEST_ASSERT_NULL(camera_abr_level(camera_abr_level_count()));
+}
+
+TEST_CASE("abr_slow_send_steps_down", "[camera_abr]") {
+  camera_abr_state_t state = {};
+  camera_abr_sample_t sample = healthy_sample();
+  sample.peak_send_us = 400000;
+  TEST_ASSERT_EQUAL(1, camera_abr_step(&state, &sample));
+  TEST_ASSERT_EQUAL(2, camera_abr_step(&state, &sample));
+}
+
+TEST_CASE("abr_drops_step_down", "[camera_abr]") {
+  camera_abr_state_t state = {};
+  camera_abr_sample_t sample = healthy_sample();
+  sample.dropped = 10;
+  TEST_ASSERT_EQUAL(1, camera_abr_step(&state, &sample));
+}
+
+TEST_CASE("abr_never_below_last_level", "[camera_abr]") {
+  camera_abr_state_t state = {};
+  camera_abr_sample_t sample = healthy_sample();
+  sample.peak_send_us = 2000000;
+  for (size_t i = 0; i < camera_abr_level_count() + 3; i++) {
+    camera_abr_step(&state, &sample);
+  }
+  TEST_ASSERT_EQUAL(camera_abr_level_count() - 1, state.level);
+}
+
+TEST_CASE("abr_recovers_after_good_windows", "[camera_abr]") {
+  camera_abr_state_t state = {};
+  state.level = 2;
+  camera_abr_sample_t sample = healthy_sample();
+  TEST_ASSERT_EQUAL(2, camera_abr_step(&state, &sample));
+  TEST_ASSERT_EQUAL(2, camera_abr_step(&state, &sample));
+  TEST_ASSERT_EQUAL(1, camera_abr_step(&state, &sample));
+}
+
+TEST_CASE("abr_never_above_init_config", "[camera_abr]") {
+  camera_abr_state_t state = {};
+  camera_abr_sample_t sample = healthy_sample();
+  for (int i = 0; i < 10; i++) {
+    TEST_ASSERT_EQUAL(0, camera_abr_step(&state, &sample));
+  }
+}
+
+TEST_CASE("abr_weak_rssi_caps_level", "[camera_abr]") {
+  camera_abr_state_t state = {};
+  camera_abr_sample_t sample = healthy_sample();
+  sample.rssi = -85;
+  TEST_ASSERT_EQUAL(4, camera_abr_step(&state, &sample));
+  sample.rssi = -75;
+  for (int i = 0; i < 9; i++) camera_abr_step(&state, &sample);
+  TEST_ASSERT_EQUAL(1, state.level);
+}
+
+TEST_CASE("abr_unknown_rssi_skips_floor", "[camera_abr]") {
+  camera_abr_state_t state = {};
+  camera_abr_sample_t sample = healthy_sample();
+  sample.rssi = -90;
+  sample.rssi_valid = false;
+  TEST_ASSERT_EQUAL(0, camera_abr_step(&state, &sample));
+}
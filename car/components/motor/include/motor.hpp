@@ -5,16 +5,25 @@ extern "C" {
 #endif
 
 #include "stdint.h"
+#include <stdbool.h>
 #include "freertos/FreeRTOS.h"
-#include "freertos/queue.h"
 
-void motor_setup(QueueHandle_t command_queue);
+void motor_setup();
 
 void car_advance(uint8_t speed);
 void car_retreat(uint8_t speed);
 void car_brake();
 void car_turn_left(uint8_t speed);
 void car_turn_right(uint8_t speed);
+// Arcade drive: throttle and steering (-100..100 each, positive steering turns
+// right) are mixed into four wheel duties and applied in one PWM update, so
+// the car drives arcs instead of stopping to spin. (0, 0) brakes.
+void car_drive(int throttle, int steering);
+// The mix used by car_drive: signed duties (-100..100) for the front left,
+// front right, rear left and rear right wheels.
+void car_mix(int throttle, int steering, int duties[4]);
+// True while car_brake() holds the wheels, until the next drive command.
+bool car_braking();
 
 #define COMMAND_ADVANCE 1
 #define COMMAND_RETREAT 2
@@ -23,12 +32,36 @@ void car_turn_right(uint8_t speed);
 #define COMMAND_TURN_RIGHT 5
 #define COMMAND_LOOK_HORIZONTALLY 6
 #define COMMAND_LOOK_VERTICALLY 7
+#define COMMAND_DRIVE_AND_LOOK 8
+// Holds the speed given in value (0.1 km/h, negative drives backwards) with
+// the wheel encoder until another drive command arrives. The loop coasts when
+// the car is faster than the target; only value 0 stops and brakes.
+#define COMMAND_CRUISE 9
+
+// Payload of COMMAND_DRIVE_AND_LOOK: the whole operator input in one command.
+typedef struct {
+  int8_t throttle;  // -100..100, negative drives backwards
+  int8_t steering;  // -100..100, negative turns left
+  int8_t pan;       // -90..90 degrees, same as COMMAND_LOOK_HORIZONTALLY
+  int8_t tilt;      // -90..90 degrees, same as COMMAND_LOOK_VERTICALLY
+} drive_and_look_t;
 
 typedef struct command_packet {
   char command;
   int value;
+  drive_and_look_t drive_and_look;  // Only used by COMMAND_DRIVE_AND_LOOK
+  // esp_timer clock when the web server received the command; 0 if unknown.
+  int64_t received_us;
 } command_packet_t;
 
+// Hands a command to command_task without blocking. Each actuator (drive, pan,
+// tilt) has a single-slot mailbox: a command replaces one for the same
+// actuator that has not been executed yet, so the car always acts on the
+// latest input. COMMAND_DRIVE_AND_LOOK fills the drive, pan and tilt mailboxes
+// at once and command_task applies all three in the same iteration. Returns
+// false for an unknown command.
+bool motor_post_command(const command_packet_t* packet);
+
 void command_task(void* p);
 
 #ifdef __cplusplus
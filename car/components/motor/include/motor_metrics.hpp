@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdint.h>
+
+void motor_metrics_setup();
+// actuator: "drive", "pan" or "tilt".
+void motor_metrics_command_coalesced(const char* actuator);
+// One executed command, in microseconds: queue_wait_us in its mailbox,
+// dispatch_us executing it until the PWM compare values are written, and
+// total_us from receipt by the web server to the same point. total_us is
+// negative when the receipt time is unknown and is then not recorded.
+void motor_metrics_command_latency(const char* actuator, int64_t queue_wait_us,
+                                   int64_t dispatch_us, int64_t total_us);
+// Latest cruise speed loop step; both 0 while the loop is idle.
+void motor_metrics_speed_control(float error_kph, float output);
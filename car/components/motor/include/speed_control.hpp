@@ -0,0 +1,45 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+
+typedef struct {
+  float kp;
+  float ki;
+  float kd;
+  float output_min;
+  float output_max;
+  float integral;
+  float previous_error;
+  bool has_previous_error;
+} pid_controller_t;
+
+void pid_reset(pid_controller_t* pid);
+// Returns the output for error measured dt_s seconds after the previous
+// update, clamped to [output_min, output_max]. The integral stops growing
+// while the output is saturated (anti-windup).
+float pid_update(pid_controller_t* pid, float error, float dt_s);
+
+// Cumulative wheel encoder pulse count.
+typedef int (*encoder_count_fn_t)();
+// Converts encoder pulses per second into km/h.
+typedef float (*encoder_speed_fn_t)(float pulses_per_second);
+
+// Connects the wheel encoder to the speed control loop run for COMMAND_CRUISE.
+// Until it is called, COMMAND_CRUISE is ignored.
+void speed_control_setup(encoder_count_fn_t count, encoder_speed_fn_t to_kph);
+
+// Starts holding target_kph (negative drives backwards). Returns false if no
+// encoder is connected.
+bool speed_control_start(float target_kph);
+void speed_control_stop();
+bool speed_control_running();
+// One loop iteration, run on command_task for every loop timer tick.
+void speed_control_step();
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,11 +1,16 @@
 #include "motor.hpp"
+#include "motor_metrics.hpp"
 #include "servo.hpp"
+#include "speed_control_loop.hpp"
 #include "utils.hpp"
 #include "freertos/FreeRTOS.h"
-#include "freertos/queue.h"
+#include "freertos/task.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "driver/gpio.h"
 #include "driver/mcpwm_prelude.h"
+#include <math.h>
+#include <stdlib.h>
 
 static const char* TAG = "motor";
 
@@ -24,66 +29,189 @@ typedef struct {
   mcpwm_cmpr_handle_t cmpr_b;
   mcpwm_gen_handle_t gen_a;
   mcpwm_gen_handle_t gen_b;
+  // Generator outputs are forced (low at start, high when braking) instead of
+  // following the comparators.
+  bool forced;
 } motor_t;
 
 // Front left
-static motor_t m1 = {12, 13, 0, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
+static motor_t m1 = {12, 13, 0, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, false};
 // Front right
-static motor_t m2 = {14, 21, 0, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
+static motor_t m2 = {14, 21, 0, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, false};
 // Rear left
-static motor_t m3 = {9, 10, 1, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
+static motor_t m3 = {9, 10, 1, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, false};
 // Rear right
-static motor_t m4 = {47, 11, 1, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
+static motor_t m4 = {47, 11, 1, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, false};
 
 static motor_t* motors[4] = {&m1, &m2, &m3, &m4};
+// Set by car_brake(), cleared when any duty is applied.
+static bool g_braking = false;
 
-static QueueHandle_t g_command_queue = NULL;
+typedef enum {
+  ACTUATOR_DRIVE = 0,
+  ACTUATOR_PAN,
+  ACTUATOR_TILT,
+  ACTUATOR_COUNT,
+} actuator_t;
+
+static const char* const kActuatorNames[ACTUATOR_COUNT] = {"drive", "pan", "tilt"};
+
+typedef struct {
+  command_packet_t packet;
+  int64_t posted_us;  // esp_timer clock when motor_post_command filled the slot
+  bool pending;
+} command_mailbox_t;
+
+// Written by motor_post_command (HTTP server task), drained by command_task.
+static command_mailbox_t g_mailboxes[ACTUATOR_COUNT];
+static portMUX_TYPE g_mailbox_lock = portMUX_INITIALIZER_UNLOCKED;
 static TaskHandle_t g_command_task_handle = NULL;
 
+static bool command_actuator(char command, actuator_t* actuator) {
+  switch (command) {
+    case COMMAND_ADVANCE:
+    case COMMAND_RETREAT:
+    case COMMAND_BRAKE:
+    case COMMAND_TURN_LEFT:
+    case COMMAND_TURN_RIGHT:
+      *actuator = ACTUATOR_DRIVE;
+      return true;
+    case COMMAND_LOOK_HORIZONTALLY:
+      *actuator = ACTUATOR_PAN;
+      return true;
+    case COMMAND_LOOK_VERTICALLY:
+      *actuator = ACTUATOR_TILT;
+      return true;
+    case COMMAND_DRIVE_AND_LOOK:
+    case COMMAND_CRUISE:
+      *actuator = ACTUATOR_DRIVE;
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool motor_post_command(const command_packet_t* packet) {
+  actuator_t actuator;
+  if (!command_actuator(packet->command, &actuator)) {
+    ESP_LOGW(TAG, "Unknown command: %d", packet->command);
+    return false;
+  }
+  command_packet_t packets[ACTUATOR_COUNT];
+  bool posted[ACTUATOR_COUNT] = {};
+  packets[actuator] = *packet;
+  posted[actuator] = true;
+  if (packet->command == COMMAND_DRIVE_AND_LOOK) {
+    packets[ACTUATOR_PAN] = {COMMAND_LOOK_HORIZONTALLY, packet->drive_and_look.pan, {},
+                             packet->received_us};
+    packets[ACTUATOR_TILT] = {COMMAND_LOOK_VERTICALLY, packet->drive_and_look.tilt, {},
+                              packet->received_us};
+    posted[ACTUATOR_PAN] = posted[ACTUATOR_TILT] = true;
+  }
+
+  bool coalesced[ACTUATOR_COUNT] = {};
+  int64_t now = esp_timer_get_time();
+  taskENTER_CRITICAL(&g_mailbox_lock);
+  for (int i = 0; i < ACTUATOR_COUNT; i++) {
+    if (!posted[i]) continue;
+    coalesced[i] = g_mailboxes[i].pending;
+    g_mailboxes[i].packet = packets[i];
+    g_mailboxes[i].posted_us = now;
+    g_mailboxes[i].pending = true;
+  }
+  taskEXIT_CRITICAL(&g_mailbox_lock);
+  for (int i = 0; i < ACTUATOR_COUNT; i++) {
+    if (coalesced[i]) motor_metrics_command_coalesced(kActuatorNames[i]);
+  }
+  if (g_command_task_handle) {
+    xTaskNotify(g_command_task_handle, COMMAND_NOTIFY_MAILBOX, eSetBits);
+  }
+  return true;
+}
+
+static int clamp(int value, int min, int max) {
+  return value < min ? min : (value > max ? max : value);
+}
+
+static void execute_command(const command_packet_t* packet) {
+  switch (packet->command) {
+    case COMMAND_ADVANCE:
+      ESP_LOGI(TAG, "COMMAND_ADVANCE: %d", packet->value);
+      car_advance(packet->value);
+      break;
+    case COMMAND_RETREAT:
+      ESP_LOGI(TAG, "COMMAND_RETREAT");
+      car_retreat(packet->value);
+      break;
+    case COMMAND_BRAKE:
+      ESP_LOGI(TAG, "COMMAND_BRAKE");
+      car_brake();
+      break;
+    case COMMAND_TURN_LEFT:
+      ESP_LOGI(TAG, "COMMAND_TURN_LEFT: %d", packet->value);
+      car_turn_left(packet->value);
+      break;
+    case COMMAND_TURN_RIGHT:
+      ESP_LOGI(TAG, "COMMAND_TURN_RIGHT: %d", packet->value);
+      car_turn_right(packet->value);
+      break;
+    case COMMAND_LOOK_HORIZONTALLY:
+      ESP_LOGI(TAG, "COMMAND_LOOK_HORIZONTALLY: %d", packet->value);
+      move_pan(clamp(packet->value, -90, 90));
+      break;
+    case COMMAND_LOOK_VERTICALLY:
+      ESP_LOGI(TAG, "COMMAND_LOOK_VERTICALLY: %d", packet->value);
+      move_tilt(clamp(packet->value, -90, 90));
+      break;
+    case COMMAND_DRIVE_AND_LOOK:
+      // Pan and tilt arrive through their own mailboxes in the same iteration.
+      ESP_LOGI(TAG, "COMMAND_DRIVE_AND_LOOK: %d %d", packet->drive_and_look.throttle,
+               packet->drive_and_look.steering);
+      car_drive(packet->drive_and_look.throttle, packet->drive_and_look.steering);
+      break;
+    case COMMAND_CRUISE:
+      ESP_LOGI(TAG, "COMMAND_CRUISE: %d", packet->value);
+      if (packet->value == 0 || !speed_control_start(packet->value / 10.0f)) {
+        speed_control_stop();
+        car_brake();
+      }
+      break;
+    default:
+      ESP_LOGI(TAG, "Unknown command: %d", packet->command);
+  }
+}
+
 void command_task(void* p) {
-  command_packet_t packet = {0, 0};
   while (true) {
-    if (xQueueReceive(g_command_queue, &packet, portMAX_DELAY) != pdPASS) {
-      ESP_LOGE(TAG, "xQueueReceive failed");
-      return;
+    uint32_t notified = 0;
+    xTaskNotifyWait(0, ULONG_MAX, &notified, portMAX_DELAY);
+    if (notified & COMMAND_NOTIFY_SPEED_CONTROL) speed_control_step();
+    if (!(notified & COMMAND_NOTIFY_MAILBOX)) continue;
+
+    // Take all mailboxes in one critical section so the parts of a
+    // COMMAND_DRIVE_AND_LOOK are never split across iterations.
+    command_mailbox_t taken[ACTUATOR_COUNT];
+    taskENTER_CRITICAL(&g_mailbox_lock);
+    for (int i = 0; i < ACTUATOR_COUNT; i++) {
+      taken[i] = g_mailboxes[i];
+      g_mailboxes[i].pending = false;
     }
-    if (packet.command != 0) {
-      switch (packet.command) {
-        case COMMAND_ADVANCE:
-          ESP_LOGI(TAG, "COMMAND_ADVANCE: %d", packet.value);
-          car_advance(packet.value);
-          break;
-        case COMMAND_RETREAT:
-          ESP_LOGI(TAG, "COMMAND_RETREAT");
-          car_retreat(packet.value);
-          break;
-        case COMMAND_BRAKE:
-          ESP_LOGI(TAG, "COMMAND_BRAKE");
-          car_brake();
-          break;
-        case COMMAND_TURN_LEFT:
-          ESP_LOGI(TAG, "COMMAND_TURN_LEFT: %d", packet.value);
-          car_turn_left(packet.value);
-          break;
-        case COMMAND_TURN_RIGHT:
-          ESP_LOGI(TAG, "COMMAND_TURN_RIGHT: %d", packet.value);
-          car_turn_right(packet.value);
-          break;
-        // TODO: Split car and camera commands
-        // Currently there is no way to drive a car and look around
-        // What's more, you can't look horizontally and vertically and the same time
-        case COMMAND_LOOK_HORIZONTALLY:
-          ESP_LOGI(TAG, "COMMAND_LOOK_HORIZONTALLY: %d", packet.value);
-          move_pan(packet.value);
-          break;
-        case COMMAND_LOOK_VERTICALLY:
-          ESP_LOGI(TAG, "COMMAND_LOOK_VERTICALLY: %d", packet.value);
-          move_tilt(packet.value);
-          break;
-        default:
-          ESP_LOGI(TAG, "Unknown command: %d", packet.command);
-      }
-      packet = {0, 0};
+    taskEXIT_CRITICAL(&g_mailbox_lock);
+    // Any other drive command takes the wheels back from the speed loop.
+    if (taken[ACTUATOR_DRIVE].pending && taken[ACTUATOR_DRIVE].packet.command != COMMAND_CRUISE) {
+      speed_control_stop();
+    }
+    for (int i = 0; i < ACTUATOR_COUNT; i++) {
+      if (!taken[i].pending) continue;
+      int64_t start_us = esp_timer_get_time();
+      execute_command(&taken[i].packet);
+      // The compare values latch at the start of the next PWM period, at most
+      // one period (1 ms for the wheels, 20 ms for the servos) later.
+      int64_t applied_us = esp_timer_get_time();
+      int64_t received_us = taken[i].packet.received_us;
+      motor_metrics_command_latency(kActuatorNames[i], start_us - taken[i].posted_us,
+                                    applied_us - start_us,
+                                    received_us > 0 ? applied_us - received_us : -1);
     }
   }
 }
@@ -132,6 +260,7 @@ static void motor_mcpwm_init(motor_t* m) {
   // Start with both outputs forced low
   ESP_ERROR_CHECK(mcpwm_generator_set_force_level(m->gen_a, 0, true));
   ESP_ERROR_CHECK(mcpwm_generator_set_force_level(m->gen_b, 0, true));
+  m->forced = true;
 
   ESP_ERROR_CHECK(mcpwm_timer_enable(m->timer));
   ESP_ERROR_CHECK(mcpwm_timer_start_stop(m->timer, MCPWM_TIMER_START_NO_STOP));
@@ -143,67 +272,115 @@ void motor_init() {
   }
 }
 
-void motor_setup(QueueHandle_t command_queue) {
+void motor_setup() {
   motor_init();
   servo_init();
 
-  g_command_queue = command_queue;
-  if (xTaskCreate(command_task, "command_task", 4096, (void*)0, 1, &g_command_task_handle) !=
+  // Above telemetry: command_task also runs the 100 Hz speed control step.
+  if (xTaskCreate(command_task, "command_task", 4096, (void*)0, 3, &g_command_task_handle) !=
       pdPASS) {
     ESP_LOGE(TAG, "xTaskCreate(command_task) failed");
     return;
   }
 }
 
-static void motor_advance(motor_t* motor, uint8_t speed) {
-  speed = (uint8_t)interpolate(speed, 0, 100, MOTOR_DEAD_ZONE, 100);
-  uint32_t cmp = (uint32_t)speed * MOTOR_PWM_PERIOD_TICKS / 100;
-  ESP_ERROR_CHECK(mcpwm_comparator_set_compare_value(motor->cmpr_a, cmp));
-  ESP_ERROR_CHECK(mcpwm_generator_set_force_level(motor->gen_b, 0, true));
-  ESP_ERROR_CHECK(mcpwm_generator_set_force_level(motor->gen_a, -1, false));
+static uint32_t duty_to_ticks(int duty) {
+  int magnitude = clamp(abs(duty), 0, 100);
+  if (magnitude == 0) return 0;
+  magnitude = (int)interpolate(magnitude, 0, 100, MOTOR_DEAD_ZONE, 100);
+  return (uint32_t)magnitude * MOTOR_PWM_PERIOD_TICKS / 100;
 }
 
-static void motor_retreat(motor_t* motor, uint8_t speed) {
-  speed = (uint8_t)interpolate(speed, 0, 100, MOTOR_DEAD_ZONE, 100);
-  uint32_t cmp = (uint32_t)speed * MOTOR_PWM_PERIOD_TICKS / 100;
-  ESP_ERROR_CHECK(mcpwm_comparator_set_compare_value(motor->cmpr_b, cmp));
-  ESP_ERROR_CHECK(mcpwm_generator_set_force_level(motor->gen_a, 0, true));
-  ESP_ERROR_CHECK(mcpwm_generator_set_force_level(motor->gen_b, -1, false));
+// Sets all four wheels in one batch, in signed PWM ticks (negative drives
+// backwards). The comparators are configured with update_cmp_on_tez, so each
+// wheel's new compare values are shadowed until the start of its next PWM
+// period, at most 1 ms later. The four timers run unsynchronized, so the
+// wheels switch within that millisecond rather than on the same edge. A wheel
+// with 0 ticks coasts (both outputs low).
+static void motors_apply_ticks(const int ticks[4]) {
+  for (int i = 0; i < 4; i++) {
+    motor_t* m = motors[i];
+    uint32_t magnitude = (uint32_t)abs(ticks[i]);
+    ESP_ERROR_CHECK(mcpwm_comparator_set_compare_value(m->cmpr_a, ticks[i] > 0 ? magnitude : 0));
+    ESP_ERROR_CHECK(mcpwm_comparator_set_compare_value(m->cmpr_b, ticks[i] < 0 ? magnitude : 0));
+  }
+  for (int i = 0; i < 4; i++) {
+    motor_t* m = motors[i];
+    if (!m->forced) continue;
+    ESP_ERROR_CHECK(mcpwm_generator_set_force_level(m->gen_a, -1, false));
+    ESP_ERROR_CHECK(mcpwm_generator_set_force_level(m->gen_b, -1, false));
+    m->forced = false;
+  }
+  g_braking = false;
+}
+
+// Duties in percent (-100..100); any non-zero duty starts past the dead zone.
+static void motors_apply(const int duties[4]) {
+  int ticks[4];
+  for (int i = 0; i < 4; i++) {
+    int magnitude = (int)duty_to_ticks(duties[i]);
+    ticks[i] = duties[i] < 0 ? -magnitude : magnitude;
+  }
+  motors_apply_ticks(ticks);
 }
 
 static void motor_brake(motor_t* motor) {
   ESP_ERROR_CHECK(mcpwm_generator_set_force_level(motor->gen_a, 1, true));
   ESP_ERROR_CHECK(mcpwm_generator_set_force_level(motor->gen_b, 1, true));
+  motor->forced = true;
 }
 
-void car_advance(uint8_t speed) {
-  for (int i = 0; i < 4; i++) {
-    motor_advance(motors[i], speed);
+void car_mix(int throttle, int steering, int duties[4]) {
+  throttle = clamp(throttle, -100, 100);
+  steering = clamp(steering, -100, 100);
+  int left = throttle + steering;
+  int right = throttle - steering;
+  // Scale both sides down together so the turn radius is preserved.
+  int peak = abs(left) > abs(right) ? abs(left) : abs(right);
+  if (peak > 100) {
+    left = left * 100 / peak;
+    right = right * 100 / peak;
   }
+  duties[0] = left;   // Front left
+  duties[1] = right;  // Front right
+  duties[2] = left;   // Rear left
+  duties[3] = right;  // Rear right
 }
 
-void car_retreat(uint8_t speed) {
-  for (int i = 0; i < 4; i++) {
-    motor_retreat(motors[i], speed);
+void car_drive(int throttle, int steering) {
+  if (throttle == 0 && steering == 0) {
+    car_brake();
+    return;
   }
+  int duties[4];
+  car_mix(throttle, steering, duties);
+  motors_apply(duties);
 }
 
-void car_turn_left(uint8_t speed) {
-  motor_advance(&m2, speed);
-  motor_advance(&m4, speed);
-  motor_retreat(&m1, speed);
-  motor_retreat(&m3, speed);
-}
+void car_advance(uint8_t speed) { car_drive(speed, 0); }
 
-void car_turn_right(uint8_t speed) {
-  motor_advance(&m1, speed);
-  motor_advance(&m3, speed);
-  motor_retreat(&m2, speed);
-  motor_retreat(&m4, speed);
-}
+void car_retreat(uint8_t speed) { car_drive(-speed, 0); }
+
+void car_turn_left(uint8_t speed) { car_drive(0, -speed); }
+
+void car_turn_right(uint8_t speed) { car_drive(0, speed); }
 
 void car_brake() {
   for (int i = 0; i < 4; i++) {
     motor_brake(motors[i]);
   }
+  g_braking = true;
+}
+
+bool car_braking() { return g_braking; }
+
+void car_drive_duty(float duty) {
+  if (duty > 100.0f) duty = 100.0f;
+  if (duty < -100.0f) duty = -100.0f;
+  // Linear over the whole period, dead zone included: a small correction is
+  // a small duty, not a jump to MOTOR_DEAD_ZONE.
+  int magnitude = (int)lroundf(fabsf(duty) * MOTOR_PWM_PERIOD_TICKS / 100.0f);
+  int wheel = duty < 0.0f ? -magnitude : magnitude;
+  int ticks[4] = {wheel, wheel, wheel, wheel};
+  motors_apply_ticks(ticks);
 }
@@ -0,0 +1,104 @@
+#include "motor_metrics.hpp"
+#include "sdkconfig.h"
+
+#ifdef CONFIG_ESP_OPENTELEMETRY_METRICS_ENABLED
+#include <cstdint>
+#include "metrics.hpp"
+#include "opentelemetry/context/context.h"
+#include "opentelemetry/metrics/async_instruments.h"
+#include "opentelemetry/metrics/provider.h"
+#include "opentelemetry/metrics/sync_instruments.h"
+#include "opentelemetry/nostd/shared_ptr.h"
+
+namespace metrics_api = opentelemetry::metrics;
+
+namespace {
+static opentelemetry::nostd::shared_ptr<metrics_api::Counter<uint64_t>> s_commands_coalesced;
+static opentelemetry::nostd::shared_ptr<metrics_api::Histogram<uint64_t>> s_command_queue_wait;
+static opentelemetry::nostd::shared_ptr<metrics_api::Histogram<uint64_t>> s_command_dispatch;
+static opentelemetry::nostd::shared_ptr<metrics_api::Histogram<uint64_t>> s_command_latency;
+static opentelemetry::nostd::shared_ptr<metrics_api::ObservableInstrument> s_speed_error_gauge;
+static opentelemetry::nostd::shared_ptr<metrics_api::ObservableInstrument> s_speed_output_gauge;
+
+// Latest speed control step, written by command_task and read by the metric
+// reader; a torn or stale sample is harmless for a gauge.
+static float s_speed_error = 0.0f;
+static float s_speed_output = 0.0f;
+
+static void cb_speed_error(metrics_api::ObserverResult obs, void*) {
+  observe_double(obs, s_speed_error);
+}
+static void cb_speed_output(metrics_api::ObserverResult obs, void*) {
+  observe_double(obs, s_speed_output);
+}
+
+static void record_us(metrics_api::Histogram<uint64_t>* histogram, const char* actuator,
+                      int64_t value_us) {
+  if (!histogram) return;
+  histogram->Record(value_us > 0 ? static_cast<uint64_t>(value_us) : 0, {{"actuator", actuator}},
+                    opentelemetry::context::Context{});
+}
+}  // namespace
+#endif  // CONFIG_ESP_OPENTELEMETRY_METRICS_ENABLED
+
+void motor_metrics_setup() {
+#ifdef CONFIG_ESP_OPENTELEMETRY_METRICS_ENABLED
+  auto meter = metrics_api::Provider::GetMeterProvider()->GetMeter(
+      CONFIG_ESP_OPENTELEMETRY_SERVICE_NAME, "1.0.0");
+  s_commands_coalesced = meter->CreateUInt64Counter(
+      "dust_mite.commands_coalesced",
+      "Commands replaced by a newer command for the same actuator before execution", "{command}");
+  // Microseconds keep the SDK's default bucket boundaries (0 to 10000) useful:
+  // a command normally waits and executes within a few milliseconds.
+  s_command_queue_wait = meter->CreateUInt64Histogram(
+      "dust_mite.command.queue_wait", "Time a command waited in its mailbox for command_task",
+      "us");
+  s_command_dispatch = meter->CreateUInt64Histogram(
+      "dust_mite.command.dispatch",
+      "Time command_task spent executing a command until the PWM compare values were written",
+      "us");
+  s_command_latency = meter->CreateUInt64Histogram(
+      "dust_mite.command.latency",
+      "Time from receipt by the web server until the command's PWM compare values were written",
+      "us");
+
+  s_speed_error_gauge = meter->CreateDoubleObservableGauge(
+      "dust_mite.speed_control.error", "Cruise target minus measured wheel speed", "km/h");
+  s_speed_error_gauge->AddCallback(cb_speed_error, nullptr);
+  s_speed_output_gauge = meter->CreateDoubleObservableGauge(
+      "dust_mite.speed_control.output", "Throttle applied by the cruise speed loop", "%");
+  s_speed_output_gauge->AddCallback(cb_speed_output, nullptr);
+#endif
+}
+
+void motor_metrics_command_coalesced(const char* actuator) {
+#ifdef CONFIG_ESP_OPENTELEMETRY_METRICS_ENABLED
+  if (s_commands_coalesced) s_commands_coalesced->Add(1, {{"actuator", actuator}});
+#else
+  (void)actuator;
+#endif
+}
+
+void motor_metrics_command_latency(const char* actuator, int64_t queue_wait_us,
+                                   int64_t dispatch_us, int64_t total_us) {
+#ifdef CONFIG_ESP_OPENTELEMETRY_METRICS_ENABLED
+  record_us(s_command_queue_wait.get(), actuator, queue_wait_us);
+  record_us(s_command_dispatch.get(), actuator, dispatch_us);
+  if (total_us >= 0) record_us(s_command_latency.get(), actuator, total_us);
+#else
+  (void)actuator;
+  (void)queue_wait_us;
+  (void)dispatch_us;
+  (void)total_us;
+#endif
+}
+
+void motor_metrics_speed_control(float error_kph, float output) {
+#ifdef CONFIG_ESP_OPENTELEMETRY_METRICS_ENABLED
+  s_speed_error = error_kph;
+  s_speed_output = output;
+#else
+  (void)error_kph;
+  (void)output;
+#endif
+}
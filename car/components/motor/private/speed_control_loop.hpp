@@ -0,0 +1,16 @@
+#pragma once
+
+// Driven by command_task: the loop timer only sets
+// COMMAND_NOTIFY_SPEED_CONTROL, the step itself runs on command_task so all
+// motor updates come from one task.
+
+#include <stdint.h>
+#include "speed_control.hpp"
+
+#define COMMAND_NOTIFY_MAILBOX (1 << 0)
+#define COMMAND_NOTIFY_SPEED_CONTROL (1 << 1)
+
+// Drives all four wheels straight at duty percent of the PWM period
+// (-100..100, negative backwards) without car_drive's dead-zone offset, so
+// the speed loop's output is continuous. 0 coasts. Implemented in motor.cpp.
+void car_drive_duty(float duty);
@@ -0,0 +1,130 @@
+#include "speed_control.hpp"
+#include "speed_control_loop.hpp"
+#include "motor.hpp"
+#include "motor_metrics.hpp"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <math.h>
+
+static const char* TAG = "speed_control";
+
+// 100 Hz, independent of the telemetry cadence.
+#define SPEED_CONTROL_PERIOD_US 10000
+// Speed is measured over the last 10 steps: at walking pace the 20-slot
+// encoder gives well under one pulse per step.
+#define SPEED_CONTROL_WINDOW 10
+// Output is duty in percent of the PWM period, error in km/h.
+#define SPEED_CONTROL_KP 15.0f
+#define SPEED_CONTROL_KI 30.0f
+#define SPEED_CONTROL_KD 0.5f
+
+typedef struct {
+  int count;
+  int64_t time_us;
+} encoder_sample_t;
+
+static encoder_count_fn_t s_encoder_count = NULL;
+static encoder_speed_fn_t s_encoder_speed = NULL;
+static esp_timer_handle_t s_timer = NULL;
+static TaskHandle_t s_task = NULL;
+
+static pid_controller_t s_pid = {
+    SPEED_CONTROL_KP, SPEED_CONTROL_KI, SPEED_CONTROL_KD, 0.0f, 100.0f, 0.0f, 0.0f, false};
+static encoder_sample_t s_window[SPEED_CONTROL_WINDOW];
+static int s_window_head = 0;
+static int64_t s_last_step_us = 0;
+static float s_target_kph = 0.0f;
+static bool s_running = false;
+
+void pid_reset(pid_controller_t* pid) {
+  pid->integral = 0.0f;
+  pid->previous_error = 0.0f;
+  pid->has_previous_error = false;
+}
+
+float pid_update(pid_controller_t* pid, float error, float dt_s) {
+  float derivative = 0.0f;
+  if (pid->has_previous_error && dt_s > 0.0f) {
+    derivative = (error - pid->previous_error) / dt_s;
+  }
+  pid->previous_error = error;
+  pid->has_previous_error = true;
+
+  float integral = pid->integral + error * dt_s;
+  float output = pid->kp * error + pid->ki * integral + pid->kd * derivative;
+  if (output > pid->output_max) {
+    output = pid->output_max;
+    if (error < 0.0f) pid->integral = integral;
+  } else if (output < pid->output_min) {
+    output = pid->output_min;
+    if (error > 0.0f) pid->integral = integral;
+  } else {
+    pid->integral = integral;
+  }
+  return output;
+}
+
+static void speed_control_timer_cb(void* arg) {
+  if (s_task) xTaskNotify(s_task, COMMAND_NOTIFY_SPEED_CONTROL, eSetBits);
+}
+
+void speed_control_setup(encoder_count_fn_t count, encoder_speed_fn_t to_kph) {
+  s_encoder_count = count;
+  s_encoder_speed = to_kph;
+
+  esp_timer_create_args_t timer_args = {};
+  timer_args.callback = speed_control_timer_cb;
+  timer_args.name = "speed_control";
+  ESP_ERROR_CHECK(esp_timer_create(&timer_args, &s_timer));
+}
+
+bool speed_control_start(float target_kph) {
+  if (!s_timer) {
+    ESP_LOGW(TAG, "No wheel encoder connected");
+    return false;
+  }
+  s_task = xTaskGetCurrentTaskHandle();
+  s_target_kph = target_kph;
+  if (s_running) return true;
+
+  pid_reset(&s_pid);
+  encoder_sample_t now = {s_encoder_count(), esp_timer_get_time()};
+  for (auto& sample : s_window) sample = now;
+  s_window_head = 0;
+  s_last_step_us = now.time_us;
+  s_running = true;
+  ESP_ERROR_CHECK(esp_timer_start_periodic(s_timer, SPEED_CONTROL_PERIOD_US));
+  return true;
+}
+
+void speed_control_stop() {
+  if (!s_running) return;
+  s_running = false;
+  ESP_ERROR_CHECK(esp_timer_stop(s_timer));
+  motor_metrics_speed_control(0.0f, 0.0f);
+}
+
+bool speed_control_running() { return s_running; }
+
+void speed_control_step() {
+  if (!s_running) return;
+  encoder_sample_t now = {s_encoder_count(), esp_timer_get_time()};
+  encoder_sample_t oldest = s_window[s_window_head];
+  s_window[s_window_head] = now;
+  s_window_head = (s_window_head + 1) % SPEED_CONTROL_WINDOW;
+
+  float window_s = (float)(now.time_us - oldest.time_us) / 1000000.0f;
+  float dt_s = (float)(now.time_us - s_last_step_us) / 1000000.0f;
+  s_last_step_us = now.time_us;
+  if (window_s <= 0.0f) return;
+
+  // The encoder has a single channel: it measures speed, not direction.
+  float speed_kph = s_encoder_speed((float)(now.count - oldest.count) / window_s);
+  float error = fabsf(s_target_kph) - speed_kph;
+  float output = pid_update(&s_pid, error, dt_s);
+  // Above the target the output drops to 0 and the car coasts down to it.
+  car_drive_duty(s_target_kph < 0.0f ? -output : output);
+  motor_metrics_speed_control(error, output);
+}
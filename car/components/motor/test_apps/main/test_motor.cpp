@@ -1,7 +1,9 @@
+#include <stdio.h>
 #include "motor.hpp"
 #include "unity.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "esp_timer.h"
 
 TEST_CASE("advance", "[motor]") {
   car_advance(50);
@@ -28,3 +30,58 @@ TEST_CASE("turn_right", "[motor]") {
   vTaskDelay(pdMS_TO_TICKS(1000));
   car_brake();
 }
+TEST_CASE("post_command_does_not_block", "[motor]") {
+  // A burst of drive commands must return immediately; superseded commands
+  // are coalesced instead of queued behind the command task.
+  command_packet_t packet = {COMMAND_ADVANCE, 50, {}, 0};
+  int64_t start = esp_timer_get_time();
+  for (int i = 0; i < 100; i++) {
+    TEST_ASSERT_TRUE(motor_post_command(&packet));
+  }
+  int64_t elapsed = esp_timer_get_time() - start;
+  printf("100 commands posted in %lld us\n", elapsed);
+  TEST_ASSERT_LESS_THAN(10000, elapsed);
+
+  packet = {COMMAND_BRAKE, 0, {}, 0};
+  TEST_ASSERT_TRUE(motor_post_command(&packet));
+  vTaskDelay(pdMS_TO_TICKS(100));
+}
+TEST_CASE("post_unknown_command", "[motor]") {
+  command_packet_t packet = {42, 0, {}, 0};
+  TEST_ASSERT_FALSE(motor_post_command(&packet));
+}
+TEST_CASE("post_drive_and_look", "[motor]") {
+  command_packet_t packet = {COMMAND_DRIVE_AND_LOOK, 0, {50, -20, 30, -10}, 0};
+  TEST_ASSERT_TRUE(motor_post_command(&packet));
+  vTaskDelay(pdMS_TO_TICKS(1000));
+
+  packet = {COMMAND_DRIVE_AND_LOOK, 0, {0, 0, 0, 0}, 0};
+  TEST_ASSERT_TRUE(motor_post_command(&packet));
+  vTaskDelay(pdMS_TO_TICKS(100));
+}
+TEST_CASE("mix_straight", "[motor]") {
+  int duties[4];
+  car_mix(60, 0, duties);
+  int expected[4] = {60, 60, 60, 60};
+  TEST_ASSERT_EQUAL_INT_ARRAY(expected, duties, 4);
+}
+TEST_CASE("mix_arc_right", "[motor]") {
+  // Left wheels faster than right; saturated sides are scaled down together.
+  int duties[4];
+  car_mix(80, 40, duties);
+  int expected[4] = {100, 33, 100, 33};
+  TEST_ASSERT_EQUAL_INT_ARRAY(expected, duties, 4);
+}
+TEST_CASE("mix_spin_left", "[motor]") {
+  int duties[4];
+  car_mix(0, -50, duties);
+  int expected[4] = {-50, 50, -50, 50};
+  TEST_ASSERT_EQUAL_INT_ARRAY(expected, duties, 4);
+}
+TEST_CASE("drive_arc", "[motor]") {
+  car_drive(60, 30);
+  vTaskDelay(pdMS_TO_TICKS(1000));
+  car_drive(-60, -30);
+  vTaskDelay(pdMS_TO_TICKS(1000));
+  car_brake();
+}
@@ -0,0 +1,64 @@
+#include "speed_control.hpp"
+#include "motor.hpp"
+#include "unity.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static pid_controller_t make_pid(float kp, float ki, float kd) {
+  pid_controller_t pid = {kp, ki, kd, 0.0f, 100.0f, 0.0f, 0.0f, false};
+  return pid;
+}
+
+TEST_CASE("pid_proportional", "[speed_control]") {
+  pid_controller_t pid = make_pid(10.0f, 0.0f, 0.0f);
+  TEST_ASSERT_EQUAL_FLOAT(25.0f, pid_update(&pid, 2.5f, 0.01f));
+}
+
+TEST_CASE("pid_integral_accumulates", "[speed_control]") {
+  pid_controller_t pid = make_pid(0.0f, 10.0f, 0.0f);
+  for (int i = 0; i < 100; i++) pid_update(&pid, 1.0f, 0.01f);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 10.0f, pid_update(&pid, 0.0f, 0.01f));
+}
+
+TEST_CASE("pid_output_clamped", "[speed_control]") {
+  pid_controller_t pid = make_pid(100.0f, 0.0f, 0.0f);
+  TEST_ASSERT_EQUAL_FLOAT(100.0f, pid_update(&pid, 5.0f, 0.01f));
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, pid_update(&pid, -5.0f, 0.01f));
+}
+
+TEST_CASE("pid_anti_windup", "[speed_control]") {
+  // A long saturated stretch must not leave a large integral behind.
+  pid_controller_t pid = make_pid(50.0f, 10.0f, 0.0f);
+  for (int i = 0; i < 1000; i++) pid_update(&pid, 10.0f, 0.01f);
+  TEST_ASSERT_LESS_THAN_FLOAT(10.0f, pid_update(&pid, 0.0f, 0.01f));
+}
+
+TEST_CASE("pid_reset", "[speed_control]") {
+  pid_controller_t pid = make_pid(0.0f, 10.0f, 1.0f);
+  pid_update(&pid, 1.0f, 0.01f);
+  pid_reset(&pid);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, pid_update(&pid, 0.0f, 0.01f));
+}
+
+static int s_fake_pulses = 0;
+
+// 10 pulses per call: about 1000 pulses/s at the 10 ms steps below.
+static int fake_encoder_count() { return s_fake_pulses += 10; }
+
+static float fake_encoder_speed(float pulses_per_second) { return pulses_per_second / 100.0f; }
+
+TEST_CASE("speed_control_coasts_above_target", "[speed_control]") {
+  // The wheels report about 10 km/h against a 2 km/h target: the loop must
+  // let the car coast down instead of braking it.
+  speed_control_setup(fake_encoder_count, fake_encoder_speed);
+  car_brake();
+  TEST_ASSERT_TRUE(speed_control_start(2.0f));
+  for (int i = 0; i < 50; i++) {
+    vTaskDelay(pdMS_TO_TICKS(10));
+    speed_control_step();
+    TEST_ASSERT_FALSE(car_braking());
+  }
+  speed_control_stop();
+  car_brake();
+  TEST_ASSERT_TRUE(car_braking());
+}
@@ -0,0 +1,132 @@
+#include "ahrs.hpp"
+#include <math.h>
+
+#define DEG_TO_RAD 0.01745329252f
+#define RAD_TO_DEG 57.2957795131f
+
+static float inv_sqrt(float x) { return 1.0f / sqrtf(x); }
+
+vector3_t imu_to_body_frame(vector3_t sensor) {
+  vector3_t body = {sensor.x, -sensor.y, -sensor.z};
+  return body;
+}
+
+void ahrs_init(ahrs_t* ahrs, float beta) {
+  ahrs->q0 = 1.0f;
+  ahrs->q1 = 0.0f;
+  ahrs->q2 = 0.0f;
+  ahrs->q3 = 0.0f;
+  ahrs->beta = beta;
+}
+
+// Gradient descent step for the accelerometer only (roll and pitch).
+static void ahrs_imu_step(const ahrs_t* a, float ax, float ay, float az, float* s) {
+  float q0 = a->q0, q1 = a->q1, q2 = a->q2, q3 = a->q3;
+  float _2q0 = 2.0f * q0, _2q1 = 2.0f * q1, _2q2 = 2.0f * q2, _2q3 = 2.0f * q3;
+  float _4q0 = 4.0f * q0, _4q1 = 4.0f * q1, _4q2 = 4.0f * q2;
+  float _8q1 = 8.0f * q1, _8q2 = 8.0f * q2;
+  float q0q0 = q0 * q0, q1q1 = q1 * q1, q2q2 = q2 * q2, q3q3 = q3 * q3;
+
+  s[0] = _4q0 * q2q2 + _2q2 * ax + _4q0 * q1q1 - _2q1 * ay;
+  s[1] = _4q1 * q3q3 - _2q3 * ax + 4.0f * q0q0 * q1 - _2q0 * ay - _4q1 + _8q1 * q1q1 +
+         _8q1 * q2q2 + _4q1 * az;
+  s[2] = 4.0f * q0q0 * q2 + _2q0 * ax + _4q2 * q3q3 - _2q3 * ay - _4q2 + _8q2 * q1q1 +
+         _8q2 * q2q2 + _4q2 * az;
+  s[3] = 4.0f * q1q1 * q3 - _2q1 * ax + 4.0f * q2q2 * q3 - _2q2 * ay;
+}
+
+// Gradient descent step for accelerometer and magnetometer.
+static void ahrs_marg_step(const ahrs_t* a, float ax, float ay, float az, float mx, float my,
+                           float mz, float* s) {
+  float q0 = a->q0, q1 = a->q1, q2 = a->q2, q3 = a->q3;
+  float _2q0mx = 2.0f * q0 * mx, _2q0my = 2.0f * q0 * my, _2q0mz = 2.0f * q0 * mz;
+  float _2q1mx = 2.0f * q1 * mx;
+  float _2q0 = 2.0f * q0, _2q1 = 2.0f * q1, _2q2 = 2.0f * q2, _2q3 = 2.0f * q3;
+  float _2q0q2 = 2.0f * q0 * q2, _2q2q3 = 2.0f * q2 * q3;
+  float q0q0 = q0 * q0, q0q1 = q0 * q1, q0q2 = q0 * q2, q0q3 = q0 * q3;
+  float q1q1 = q1 * q1, q1q2 = q1 * q2, q1q3 = q1 * q3;
+  float q2q2 = q2 * q2, q2q3 = q2 * q3, q3q3 = q3 * q3;
+
+  // Earth's magnetic field direction in the earth frame.
+  float hx = mx * q0q0 - _2q0my * q3 + _2q0mz * q2 + mx * q1q1 + _2q1 * my * q2 + _2q1 * mz * q3 -
+             mx * q2q2 - mx * q3q3;
+  float hy = _2q0mx * q3 + my * q0q0 - _2q0mz * q1 + _2q1mx * q2 - my * q1q1 + my * q2q2 +
+             _2q2 * mz * q3 - my * q3q3;
+  float _2bx = sqrtf(hx * hx + hy * hy);
+  float _2bz = -_2q0mx * q2 + _2q0my * q1 + mz * q0q0 + _2q1mx * q3 - mz * q1q1 + _2q2 * my * q3 -
+               mz * q2q2 + mz * q3q3;
+  float _4bx = 2.0f * _2bx, _4bz = 2.0f * _2bz;
+
+  // Residuals of the predicted gravity and magnetic field.
+  float fa_x = 2.0f * q1q3 - _2q0q2 - ax;
+  float fa_y = 2.0f * q0q1 + _2q2q3 - ay;
+  float fa_z = 1.0f - 2.0f * q1q1 - 2.0f * q2q2 - az;
+  float fm_x = _2bx * (0.5f - q2q2 - q3q3) + _2bz * (q1q3 - q0q2) - mx;
+  float fm_y = _2bx * (q1q2 - q0q3) + _2bz * (q0q1 + q2q3) - my;
+  float fm_z = _2bx * (q0q2 + q1q3) + _2bz * (0.5f - q1q1 - q2q2) - mz;
+
+  s[0] = -_2q2 * fa_x + _2q1 * fa_y - _2bz * q2 * fm_x + (-_2bx * q3 + _2bz * q1) * fm_y +
+         _2bx * q2 * fm_z;
+  s[1] = _2q3 * fa_x + _2q0 * fa_y - 4.0f * q1 * fa_z + _2bz * q3 * fm_x +
+         (_2bx * q2 + _2bz * q0) * fm_y + (_2bx * q3 - _4bz * q1) * fm_z;
+  s[2] = -_2q0 * fa_x + _2q3 * fa_y - 4.0f * q2 * fa_z + (-_4bx * q2 - _2bz * q0) * fm_x +
+         (_2bx * q1 + _2bz * q3) * fm_y + (_2bx * q0 - _4bz * q2) * fm_z;
+  s[3] = _2q1 * fa_x + _2q2 * fa_y + (-_4bx * q3 + _2bz * q1) * fm_x +
+         (-_2bx * q0 + _2bz * q2) * fm_y + _2bx * q1 * fm_z;
+}
+
+void ahrs_update(ahrs_t* a, vector3_t gyro, vector3_t accel, vector3_t mag, float dt_s) {
+  float gx = gyro.x * DEG_TO_RAD, gy = gyro.y * DEG_TO_RAD, gz = gyro.z * DEG_TO_RAD;
+  float q0 = a->q0, q1 = a->q1, q2 = a->q2, q3 = a->q3;
+
+  // Rate of change of the quaternion from the gyroscope.
+  float dq0 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+  float dq1 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+  float dq2 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+  float dq3 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+
+  float accel_norm = accel.x * accel.x + accel.y * accel.y + accel.z * accel.z;
+  if (accel_norm > 0.0f) {
+    float r = inv_sqrt(accel_norm);
+    float ax = accel.x * r, ay = accel.y * r, az = accel.z * r;
+    float s[4];
+    float mag_norm = mag.x * mag.x + mag.y * mag.y + mag.z * mag.z;
+    if (mag_norm > 0.0f) {
+      r = inv_sqrt(mag_norm);
+      ahrs_marg_step(a, ax, ay, az, mag.x * r, mag.y * r, mag.z * r, s);
+    } else {
+      ahrs_imu_step(a, ax, ay, az, s);
+    }
+    float s_norm = s[0] * s[0] + s[1] * s[1] + s[2] * s[2] + s[3] * s[3];
+    if (s_norm > 0.0f) {
+      r = inv_sqrt(s_norm);
+      dq0 -= a->beta * s[0] * r;
+      dq1 -= a->beta * s[1] * r;
+      dq2 -= a->beta * s[2] * r;
+      dq3 -= a->beta * s[3] * r;
+    }
+  }
+
+  q0 += dq0 * dt_s;
+  q1 += dq1 * dt_s;
+  q2 += dq2 * dt_s;
+  q3 += dq3 * dt_s;
+  float r = inv_sqrt(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+  a->q0 = q0 * r;
+  a->q1 = q1 * r;
+  a->q2 = q2 * r;
+  a->q3 = q3 * r;
+}
+
+orientation_t ahrs_orientation(const ahrs_t* a) {
+  float q0 = a->q0, q1 = a->q1, q2 = a->q2, q3 = a->q3;
+  float sin_pitch = -2.0f * (q1 * q3 - q0 * q2);
+  if (sin_pitch > 1.0f) sin_pitch = 1.0f;
+  if (sin_pitch < -1.0f) sin_pitch = -1.0f;
+
+  orientation_t o;
+  o.roll = atan2f(q0 * q1 + q2 * q3, 0.5f - q1 * q1 - q2 * q2) * RAD_TO_DEG;
+  o.pitch = asinf(sin_pitch) * RAD_TO_DEG;
+  o.yaw = atan2f(q1 * q2 + q0 * q3, 0.5f - q2 * q2 - q3 * q3) * RAD_TO_DEG;
+  return o;
+}
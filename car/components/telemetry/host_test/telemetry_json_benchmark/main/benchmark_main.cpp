@@ -0,0 +1,134 @@
+// Host micro-benchmark for the telemetry serializer: write_telemetry_*_json()
+// against the previous cJSON path, which built a tree per message, injected
+// the trace context into it with tracing_inject() and printed it into a
+// freshly malloc'd string. Both paths inject the context of an active span
+// through the W3C propagator, as the sender does, and every heap allocation
+// is counted, cJSON's and operator new's alike.
+//
+//   idf.py --preview set-target linux build
+//   ./build/telemetry_json_benchmark.elf
+
+#include <chrono>
+#include <new>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cJSON.h>
+#include "telemetry_types.hpp"
+#include "trace_propagation.hpp"
+#include "opentelemetry/context/propagation/global_propagator.h"
+#include "opentelemetry/trace/default_span.h"
+#include "opentelemetry/trace/propagation/http_trace_context.h"
+#include "opentelemetry/trace/scope.h"
+
+namespace trace_api = opentelemetry::trace;
+
+static size_t s_allocations = 0;
+
+static void* counting_malloc(size_t size) {
+  s_allocations++;
+  return malloc(size);
+}
+
+void* operator new(size_t size) {
+  void* p = counting_malloc(size == 0 ? 1 : size);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) noexcept { free(p); }
+
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+static telemetry_packet_t s_packets[16];
+static char s_buffer[48 + 16 * (TELEMETRY_JSON_PACKET_MAX_SIZE + 1) +
+                     TELEMETRY_JSON_TRACE_CONTEXT_MAX_SIZE];
+
+static size_t write_cjson(size_t count, char* out, size_t out_size) {
+  cJSON* root = count == 1 ? convert_telemetry_packet_to_json(s_packets[0])
+                           : convert_telemetry_batch_to_json(s_packets, count, 3);
+  tracing_inject(*root);
+  char* str = cJSON_PrintUnformatted(root);
+  size_t len = strlen(str);
+  if (len < out_size) memcpy(out, str, len + 1);
+  cJSON_free(str);
+  cJSON_Delete(root);
+  return len;
+}
+
+static size_t write_direct(size_t count, char* out, size_t out_size) {
+  char traceparent[56];  // "00-<32 hex>-<16 hex>-<2 hex>", as in command_trace_context_t
+  char tracestate[513];
+  tracing_inject(traceparent, sizeof(traceparent), tracestate, sizeof(tracestate));
+  return count == 1 ? write_telemetry_packet_json(s_packets[0], traceparent, tracestate, out,
+                                                  out_size)
+                    : write_telemetry_batch_json(s_packets, count, 3, traceparent, tracestate,
+                                                 out, out_size);
+}
+
+typedef size_t (*writer_t)(size_t, char*, size_t);
+
+static double run(writer_t writer, size_t count, size_t iterations, size_t* allocations) {
+  s_allocations = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; i++) {
+    writer(count, s_buffer, sizeof(s_buffer));
+  }
+  auto end = std::chrono::steady_clock::now();
+  *allocations = s_allocations;
+  return std::chrono::duration<double, std::nano>(end - start).count() / (iterations * count);
+}
+
+extern "C" void app_main(void) {
+  cJSON_Hooks hooks = {counting_malloc, free};
+  cJSON_InitHooks(&hooks);
+
+  opentelemetry::context::propagation::GlobalTextMapPropagator::SetGlobalPropagator(
+      opentelemetry::nostd::shared_ptr<opentelemetry::context::propagation::TextMapPropagator>(
+          new trace_api::propagation::HttpTraceContext()));
+  const uint8_t trace_id[16] = {0x0a, 0xf7, 0x65, 0x19, 0x16, 0xcd, 0x43, 0xdd,
+                                0x84, 0x48, 0xeb, 0x21, 0x1c, 0x80, 0x31, 0x9c};
+  const uint8_t span_id[8] = {0xb7, 0xad, 0x6b, 0x71, 0x69, 0x20, 0x33, 0x31};
+  trace_api::SpanContext span_context(trace_api::TraceId(trace_id), trace_api::SpanId(span_id),
+                                      trace_api::TraceFlags(trace_api::TraceFlags::kIsSampled),
+                                      false);
+  trace_api::Scope scope(opentelemetry::nostd::shared_ptr<trace_api::Span>(
+      new trace_api::DefaultSpan(span_context)));
+
+  for (size_t i = 0; i < sizeof(s_packets) / sizeof(s_packets[0]); i++) {
+    telemetry_packet_t& p = s_packets[i];
+    p.rssi = -60 - static_cast<int>(i);
+    p.speed = 0.25f * i;
+    p.accelerometer = {0.01f * i, -0.02f, 0.98f};
+    p.gyroscope = {1.5f, -0.75f * i, 0.125f};
+    p.magnetometer = {0.21f, -0.05f, 0.43f + 0.001f * i};
+    p.orientation = {2.5f, -1.25f, 90.0f + i};
+    p.timestamp_us = 86400000000LL + 100000 * static_cast<int64_t>(i);
+  }
+
+  static const size_t kCounts[] = {1, 5, 16};
+  const size_t iterations = 20000;
+
+  static char expected[sizeof(s_buffer)];
+  int mismatches = 0;
+  printf("%-8s %12s %12s %12s %12s %8s\n", "packets", "cjson ns/pkt", "direct ns/pkt",
+         "cjson alloc", "direct alloc", "speedup");
+  for (size_t count : kCounts) {
+    size_t expected_len = write_cjson(count, expected, sizeof(expected));
+    size_t len = write_direct(count, s_buffer, sizeof(s_buffer));
+    if (len != expected_len || strcmp(expected, s_buffer) != 0) {
+      printf("MISMATCH: %u packets\n  cjson:  %s\n  direct: %s\n", static_cast<unsigned>(count),
+             expected, s_buffer);
+      mismatches++;
+    }
+
+    size_t cjson_allocs = 0, direct_allocs = 0;
+    double cjson_ns = run(write_cjson, count, iterations, &cjson_allocs);
+    double direct_ns = run(write_direct, count, iterations, &direct_allocs);
+    printf("%-8u %12.1f %12.1f %12.1f %12.1f %7.1fx\n", static_cast<unsigned>(count), cjson_ns,
+           direct_ns, static_cast<double>(cjson_allocs) / (iterations * count),
+           static_cast<double>(direct_allocs) / (iterations * count), cjson_ns / direct_ns);
+  }
+  exit(mismatches == 0 ? 0 : 1);
+}
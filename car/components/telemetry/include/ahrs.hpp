@@ -0,0 +1,35 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "telemetry_types.hpp"
+
+// Madgwick orientation filter (https://x-io.co.uk/open-source-imu-and-ahrs-algorithms/).
+// Fuses gyroscope, accelerometer and (optionally) magnetometer samples into a
+// quaternion. beta trades gyroscope drift correction against accelerometer
+// noise; 0.1 is Madgwick's default.
+typedef struct {
+  float q0;
+  float q1;
+  float q2;
+  float q3;
+  float beta;
+} ahrs_t;
+
+// The LSM9DS0 module is mounted upside down: the car's body frame is the
+// sensor frame rotated 180 degrees about X. Applied to the accelerometer,
+// gyroscope and magnetometer alike; negating a single axis would be a
+// reflection and turn gyroscope rotations against the accelerometer.
+vector3_t imu_to_body_frame(vector3_t sensor);
+
+void ahrs_init(ahrs_t* ahrs, float beta);
+// gyro in deg/s; accel and mag in any unit (they are normalized). A zero
+// magnetometer vector updates roll and pitch only and lets yaw drift.
+void ahrs_update(ahrs_t* ahrs, vector3_t gyro, vector3_t accel, vector3_t mag, float dt_s);
+orientation_t ahrs_orientation(const ahrs_t* ahrs);
+
+#ifdef __cplusplus
+}
+#endif
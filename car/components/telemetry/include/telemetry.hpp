@@ -5,22 +5,45 @@ extern "C" {
 #endif
 
 #include "telemetry_types.hpp"
+#include "telemetry_ring.hpp"
 #include "freertos/FreeRTOS.h"
-#include "freertos/queue.h"
 #include "driver/i2c_master.h"
 
 void sync_time();
+// Microseconds to add to an esp_timer timestamp (microseconds since boot) to
+// get microseconds since the Unix epoch. 0 until sync_time() has completed.
+int64_t get_epoch_offset_us();
 void telemetry_init(i2c_master_bus_handle_t i2c_bus);
-void telemetry_setup(QueueHandle_t telemetry_queue, i2c_master_bus_handle_t i2c_bus);
+// Packets are published into telemetry_ring every CONFIG_TELEMETRY_PUBLISH_PERIOD_MS
+// while telemetry is started.
+void telemetry_setup(telemetry_ring_t* telemetry_ring, i2c_master_bus_handle_t i2c_bus);
 void telemetry_start();
 void telemetry_stop();
 
-int get_rssi();
+// Station RSSI in dBm. Returns false, leaving *rssi untouched, while the
+// station is not connected.
+bool get_rssi(int* rssi);
 float get_speed();
+// Cumulative wheel encoder pulses since boot.
+int get_encoder_count();
+float pps_to_kph(float pulses_per_second);
+// Newest sample; drains the sensor FIFO.
 vector3_t read_accelerometer();
 vector3_t read_magnetometer();
+// Newest sample; drains the sensor FIFO.
 vector3_t read_gyroscope();
-// TODO: Compute roll/pitch/yaw - https://github.com/adafruit/Adafruit_AHRS
+// Drain up to max buffered samples (the sensor keeps the last 32, 320 ms at
+// 100 Hz) in a single I2C burst, oldest first. Timestamps are reconstructed
+// from the output data rate. Returns the number of samples written.
+// The IMU readers share static buffers; call them from one task at a time
+// (telemetry_task while telemetry runs).
+size_t read_accelerometer_fifo(imu_sample_t* out, size_t max);
+size_t read_gyroscope_fifo(imu_sample_t* out, size_t max);
+// Latest ultrasonic reading; ranging runs on its own every
+// CONFIG_TELEMETRY_URM_PERIOD_MS, so these never wait for an echo.
+// distance_cm is -1 without a valid echo in the last three periods; age_ms is
+// -1 before the first echo.
+distance_reading_t read_distance_ahead();
 int get_distance_ahead();
 
 #ifdef __cplusplus
@@ -0,0 +1,54 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "telemetry_types.hpp"
+
+// Compact binary encoding of a batch of telemetry packets, the alternative to
+// convert_telemetry_batch_to_json. Little-endian header: version u8, flags u8,
+// packet count u16, dropped u32, timestamp_us i64 of the first packet. With
+// TELEMETRY_BINARY_FLAG_TRACE_CONTEXT set, the header continues with trace id
+// [16], span id [8] and trace flags u8.
+//
+// Each packet is a record of zigzag varints, one per field in this order:
+// timestamp_us, rssi (dBm), speed (0.01 km/h), accelerometer x/y/z (mg),
+// magnetometer x/y/z (0.1 mG), gyroscope x/y/z (0.01 deg/s),
+// distance_ahead (cm), distance_ahead_age_ms, orientation roll/pitch/yaw
+// (0.01 deg). Sensor values are saturated to int16. Every field is the
+// difference from the same field of the previous record; the first record's
+// timestamp is relative to the header timestamp and its other fields to 0,
+// so each message decodes on its own.
+#define TELEMETRY_BINARY_VERSION 1
+#define TELEMETRY_BINARY_HEADER_SIZE 16
+#define TELEMETRY_BINARY_TRACE_CONTEXT_SIZE 25
+#define TELEMETRY_BINARY_FLAG_TRACE_CONTEXT 0x01
+// Upper bound of one encoded record, for sizing buffers.
+#define TELEMETRY_BINARY_RECORD_MAX_SIZE 64
+
+typedef struct {
+  uint8_t flags;
+  uint32_t dropped;
+  uint8_t trace_id[16];
+  uint8_t span_id[8];
+  uint8_t trace_flags;
+} telemetry_binary_header_t;
+
+// Returns the number of bytes written, or 0 if out_size is too small or count
+// does not fit the header.
+size_t encode_telemetry_binary(const telemetry_binary_header_t* header,
+                               const telemetry_packet_t* packets, size_t count, uint8_t* out,
+                               size_t out_size);
+
+// Decodes up to max packets into out and sets *count. Returns false on a
+// malformed message or if the message holds more than max packets.
+bool decode_telemetry_binary(const uint8_t* data, size_t len, telemetry_binary_header_t* header,
+                             telemetry_packet_t* out, size_t max, size_t* count);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,34 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "telemetry_types.hpp"
+
+// Lock-free single-producer/single-consumer ring of telemetry packets. The
+// telemetry task is the only producer and never waits: a push into a full
+// ring drops the packet and counts it. The web server's telemetry sender is
+// the only consumer. Storage is allocated in PSRAM when available.
+typedef struct telemetry_ring telemetry_ring_t;
+
+// capacity is rounded up to a power of two. Returns NULL on allocation failure.
+telemetry_ring_t* telemetry_ring_create(size_t capacity);
+void telemetry_ring_delete(telemetry_ring_t* ring);
+size_t telemetry_ring_capacity(const telemetry_ring_t* ring);
+
+// Producer side. Returns false (and counts a drop) if the ring is full.
+bool telemetry_ring_push(telemetry_ring_t* ring, const telemetry_packet_t* packet);
+
+// Consumer side. Copies up to max packets, oldest first, and returns how
+// many were copied.
+size_t telemetry_ring_pop(telemetry_ring_t* ring, telemetry_packet_t* out, size_t max);
+// Packets dropped since the previous call.
+uint32_t telemetry_ring_take_dropped(telemetry_ring_t* ring);
+
+#ifdef __cplusplus
+}
+#endif
@@ -4,6 +4,8 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
+#include <stdint.h>
 #include <cJSON.h>
 
 typedef struct {
@@ -12,17 +14,54 @@ typedef struct {
   float z;
 } vector3_t;
 
+// Degrees. Roll and pitch are relative to gravity, yaw to magnetic north.
 typedef struct {
-  char timestamp[20 + 1];
+  float roll;
+  float pitch;
+  float yaw;
+} orientation_t;
+
+typedef struct {
+  vector3_t value;
+  int64_t timestamp_us;  // esp_timer clock
+} imu_sample_t;
+
+typedef struct {
+  int distance_cm;
+  int age_ms;
+} distance_reading_t;
+
+typedef struct {
+  // esp_timer clock (microseconds since boot) when the packet was published;
+  // add get_epoch_offset_us() for Unix time.
+  int64_t timestamp_us;
   int rssi;
   float speed;
   vector3_t accelerometer;
   vector3_t magnetometer;
   vector3_t gyroscope;
   int distance_ahead;
+  int distance_ahead_age_ms;
+  orientation_t orientation;
 } telemetry_packet_t;
 
 cJSON* convert_telemetry_packet_to_json(const telemetry_packet_t& p);
+// {"packets": [<packet>, ...], "dropped": <packets lost since the previous batch>}
+cJSON* convert_telemetry_batch_to_json(const telemetry_packet_t* packets, size_t count,
+                                       uint32_t dropped);
+
+// Streaming equivalents of the converters above: write the same bytes as
+// cJSON_PrintUnformatted() of the converted tree, with "traceparent" and
+// "tracestate" appended to the root object when non-empty (as tracing_inject
+// does), straight into out without heap allocations. Return the length
+// without the terminating NUL, or 0 if out_size is too small.
+#define TELEMETRY_JSON_PACKET_MAX_SIZE 768
+#define TELEMETRY_JSON_TRACE_CONTEXT_MAX_SIZE 640
+size_t write_telemetry_packet_json(const telemetry_packet_t& p, const char* traceparent,
+                                   const char* tracestate, char* out, size_t out_size);
+size_t write_telemetry_batch_json(const telemetry_packet_t* packets, size_t count,
+                                  uint32_t dropped, const char* traceparent,
+                                  const char* tracestate, char* out, size_t out_size);
 
 #ifdef __cplusplus
 }
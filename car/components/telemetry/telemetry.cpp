@@ -1,32 +1,35 @@
 #include "telemetry.hpp"
+#include "ahrs.hpp"
 #include "telemetry_metrics.hpp"
 #include "freertos/FreeRTOS.h"
-#include "freertos/queue.h"
 #include "esp_log.h"
 #include "esp_sntp.h"
 #include "esp_netif_sntp.h"
 #include "esp_wifi.h"
 #include "esp_timer.h"
 #include <cJSON.h>
-#include <time.h>
+#include <sys/time.h>
+#include <stdlib.h>
 #include "driver/pulse_cnt.h"
 #include "driver/i2c_master.h"
 #include "driver/gpio.h"
 #include "driver/mcpwm_cap.h"
+#include "sdkconfig.h"
 
 static const char* TAG = "telemetry";
 
 #define TELEMETRY_START_NOTIFICATION_INDEX 0
 #define TELEMETRY_STOP_NOTIFICATION_INDEX 1
-#define TELEMETRY_URM_ISR_INDEX 2
 
-static QueueHandle_t g_telemetry_queue = NULL;
+static telemetry_ring_t* g_telemetry_ring = NULL;
 static TaskHandle_t g_telemetry_task_handle = NULL;
-static TaskHandle_t g_urm_waiting_task = NULL;
 
 static pcnt_unit_handle_t g_pcnt_unit = NULL;
 
+static bool g_time_synced = false;
+
 static uint64_t g_previous_timestamp = 0;
+static int g_previous_count = 0;
 
 static i2c_master_dev_handle_t g_imu_xm_dev = NULL;
 static i2c_master_dev_handle_t g_imu_g_dev = NULL;
@@ -45,12 +48,23 @@ static i2c_master_dev_handle_t g_imu_g_dev = NULL;
 #define LSM9DS0_REGISTER_CTRL_REG6_XM 0x25
 #define LSM9DS0_REGISTER_CTRL_REG7_XM 0x26
 #define LSM9DS0_REGISTER_CTRL_REG1_G 0x20
+#define LSM9DS0_REGISTER_CTRL_REG5_G 0x24
+#define LSM9DS0_REGISTER_CTRL_REG0_XM 0x1F
+#define LSM9DS0_REGISTER_FIFO_CTRL_REG 0x2E  // Same address on XM and G
+#define LSM9DS0_REGISTER_FIFO_SRC_REG 0x2F   // Same address on XM and G
 #define LSM9DS0_REGISTER_OUT_A 0x28
 #define LSM9DS0_REGISTER_OUT_M 0x08
 #define LSM9DS0_REGISTER_OUT_G 0x28
 #define LSM9DS0_RESOLUTION_A (0.00006103515f)  // scale/ADC tick -> 2g/0x8000
 #define LSM9DS0_RESOLUTION_M (0.00006103515f)  // scale/ADC tick -> 2G/0x8000
 #define LSM9DS0_RESOLUTION_G (0.00747680664f)  // scale/ADC tick -> 245DPS/0x8000
+#define LSM9DS0_FIFO_SIZE 32
+#define LSM9DS0_FIFO_EN 0x40
+#define LSM9DS0_FIFO_MODE_STREAM 0x40
+#define LSM9DS0_FIFO_SRC_FSS_MASK 0x1F
+#define LSM9DS0_FIFO_SRC_OVRN 0x40
+#define LSM9DS0_PERIOD_A_US 10000  // 100 Hz ODR (CTRL_REG1_XM)
+#define LSM9DS0_PERIOD_G_US 10526  // 95 Hz ODR (CTRL_REG1_G)
 
 #define URM_ECHO_PIN GPIO_NUM_17
 #define URM_TRIG_PIN GPIO_NUM_16
@@ -64,32 +78,59 @@ void sync_time() {
     ESP_LOGI(TAG, "Waiting for system time to be set...");
   }
   ESP_LOGI(TAG, "Set system time");
+  g_time_synced = true;
 }
 
-void get_timestamp(char* buf) {
-  time_t now;
-  time(&now);
-  tm timeinfo = {};
-  gmtime_r(&now, &timeinfo);
+int64_t get_epoch_offset_us() {
+  if (!g_time_synced) return 0;
+  // Recomputed on every call: SNTP keeps slewing the system clock, while the
+  // esp_timer clock never jumps.
+  timeval now = {};
+  gettimeofday(&now, NULL);
+  return static_cast<int64_t>(now.tv_sec) * 1000000 + now.tv_usec - esp_timer_get_time();
+}
 
-  strftime(buf, (20 + 1) * sizeof(char), "%Y-%m-%dT%H:%M:%SZ", &timeinfo);
-  buf[20] = '\0';
+bool get_rssi(int* rssi) {
+  esp_err_t err = esp_wifi_sta_get_rssi(rssi);
+  if (err != ESP_OK) {
+    ESP_LOGD(TAG, "esp_wifi_sta_get_rssi failed: %s", esp_err_to_name(err));
+    return false;
+  }
+  return true;
 }
 
-int get_rssi() {
-  int rssi = 0;
-  ESP_ERROR_CHECK(esp_wifi_sta_get_rssi(&rssi));
-  return rssi;
+// Keeps the last reading while the station is disconnected.
+static void sample_rssi(telemetry_packet_t* p) { get_rssi(&p->rssi); }
+static void sample_speed(telemetry_packet_t* p) { p->speed = get_speed(); }
+static void sample_magnetometer(telemetry_packet_t* p) { p->magnetometer = read_magnetometer(); }
+static void sample_imu(telemetry_packet_t* p);
+static void sample_distance_ahead(telemetry_packet_t* p) {
+  distance_reading_t reading = read_distance_ahead();
+  p->distance_ahead = reading.distance_cm;
+  p->distance_ahead_age_ms = reading.age_ms;
 }
 
+// Each sensor is sampled on its own period into the latest packet; the packet
+// is published on a separate period.
+typedef struct {
+  void (*sample)(telemetry_packet_t* p);
+  int64_t period_us;
+  int64_t next_us;
+} telemetry_source_t;
+
+static telemetry_source_t g_sources[] = {
+    {sample_imu, CONFIG_TELEMETRY_IMU_PERIOD_MS * 1000LL, 0},
+    {sample_magnetometer, CONFIG_TELEMETRY_MAGNETOMETER_PERIOD_MS * 1000LL, 0},
+    {sample_speed, CONFIG_TELEMETRY_ENCODER_PERIOD_MS * 1000LL, 0},
+    {sample_distance_ahead, CONFIG_TELEMETRY_URM_PERIOD_MS * 1000LL, 0},
+    {sample_rssi, CONFIG_TELEMETRY_RSSI_PERIOD_MS * 1000LL, 0},
+};
+
+#define TELEMETRY_PUBLISH_PERIOD_US (CONFIG_TELEMETRY_PUBLISH_PERIOD_MS * 1000LL)
+
 void get_telemetry_packet(telemetry_packet_t* p) {
-  get_timestamp(p->timestamp);
-  p->rssi = get_rssi();
-  p->speed = get_speed();
-  p->accelerometer = read_accelerometer();
-  p->magnetometer = read_magnetometer();
-  p->gyroscope = read_gyroscope();
-  p->distance_ahead = get_distance_ahead();
+  p->timestamp_us = esp_timer_get_time();
+  for (auto& source : g_sources) source.sample(p);
 }
 
 void pcnt_init() {
@@ -116,20 +157,23 @@ void pcnt_init() {
   ESP_ERROR_CHECK(pcnt_unit_start(g_pcnt_unit));
 }
 
-void reset_pcnt() {
-  g_previous_timestamp = esp_timer_get_time();
-  ESP_ERROR_CHECK(pcnt_unit_clear_count(g_pcnt_unit));
-}
-
-int get_counter() {
+// The count is never cleared: telemetry and the speed control loop each keep
+// their own previous reading.
+int get_encoder_count() {
   int pulses = 0;
   ESP_ERROR_CHECK(pcnt_unit_get_count(g_pcnt_unit, &pulses));
-  ESP_ERROR_CHECK(pcnt_unit_clear_count(g_pcnt_unit));
   return pulses;
 }
 
+void reset_pcnt() {
+  g_previous_timestamp = esp_timer_get_time();
+  g_previous_count = get_encoder_count();
+}
+
 float get_pps() {
-  int pulses = get_counter();
+  int count = get_encoder_count();
+  int pulses = count - g_previous_count;
+  g_previous_count = count;
   uint64_t current_timestamp = (uint64_t)esp_timer_get_time();
   float duration_s = (float)(current_timestamp - g_previous_timestamp) / 1000000.0f;
   g_previous_timestamp = current_timestamp;
@@ -137,22 +181,18 @@ float get_pps() {
   return pulses_per_second;
 }
 
-float get_rpm() {
-  float pulses_per_second = get_pps();
+float pps_to_kph(float pulses_per_second) {
   int encoder_slots = 20;
   float revolutions_per_second = pulses_per_second / encoder_slots;
   float revolutions_per_minute = revolutions_per_second * 60;
-  return revolutions_per_minute;
-}
-
-float get_speed() {
-  float revolutions_per_minute = get_rpm();
   float wheel_diameter_m = 0.066f;  // 6,6 cm
   // S = RPM * DIAMETER_IN_METERS * PI * MINUTES_IN_HOUR/METERS_IN_KILOMETER
   float velocity_kph = revolutions_per_minute * wheel_diameter_m * 3.14f * 60 / 1000;
   return velocity_kph;
 }
 
+float get_speed() { return pps_to_kph(get_pps()); }
+
 static i2c_master_dev_handle_t imu_dev_handle(uint8_t device_address) {
   if (device_address == LSM9DS0_XM_ADDRESS) return g_imu_xm_dev;
   if (device_address == LSM9DS0_G_ADDRESS) return g_imu_g_dev;
@@ -205,74 +245,196 @@ void imu_init(i2c_master_bus_handle_t bus_handle) {
 
   imu_write_register(LSM9DS0_G_ADDRESS, LSM9DS0_REGISTER_CTRL_REG1_G,
                      0x0F);  // Gyroscope normal mode, x/y/z enabled
-}
 
-vector3_t read_accelerometer() {
-  uint8_t buf[6];
-  imu_read_register(LSM9DS0_XM_ADDRESS, LSM9DS0_REGISTER_OUT_A, buf, sizeof(buf));
+  imu_write_register(LSM9DS0_XM_ADDRESS, LSM9DS0_REGISTER_CTRL_REG0_XM,
+                     LSM9DS0_FIFO_EN);  // Accelerometer FIFO enabled
+  imu_write_register(LSM9DS0_XM_ADDRESS, LSM9DS0_REGISTER_FIFO_CTRL_REG,
+                     LSM9DS0_FIFO_MODE_STREAM);  // Keep the newest 32 samples
+  imu_write_register(LSM9DS0_G_ADDRESS, LSM9DS0_REGISTER_CTRL_REG5_G,
+                     LSM9DS0_FIFO_EN);  // Gyroscope FIFO enabled
+  imu_write_register(LSM9DS0_G_ADDRESS, LSM9DS0_REGISTER_FIFO_CTRL_REG,
+                     LSM9DS0_FIFO_MODE_STREAM);  // Keep the newest 32 samples
+}
 
+// All three sensors are converted to the car's body frame, so the AHRS fuses
+// vectors that share one right-handed frame.
+static vector3_t imu_to_vector(const uint8_t* buf, float resolution) {
   int16_t raw_x = (buf[1] << 8) | buf[0];
   int16_t raw_y = (buf[3] << 8) | buf[2];
   int16_t raw_z = (buf[5] << 8) | buf[4];
 
   vector3_t out;
-  out.x = (float)(raw_x)*LSM9DS0_RESOLUTION_A;
-  out.y = (float)(raw_y)*LSM9DS0_RESOLUTION_A;
-  out.z = (float)(raw_z)*LSM9DS0_RESOLUTION_A * -1;  // Module is mounted upside down
-  return out;
+  out.x = (float)(raw_x)*resolution;
+  out.y = (float)(raw_y)*resolution;
+  out.z = (float)(raw_z)*resolution;
+  return imu_to_body_frame(out);
+}
+
+// The accelerometer and gyroscope FIFOs run in stream mode: the sensor keeps
+// the last 32 samples and a drain reads all of them in one I2C burst (the
+// output register address wraps from Z back to X while the FIFO is enabled).
+typedef struct {
+  uint8_t device_address;
+  uint8_t out_register;
+  float resolution;
+  int64_t period_us;
+  int64_t last_sample_us;
+} imu_fifo_t;
+
+static imu_fifo_t g_accelerometer_fifo = {
+    LSM9DS0_XM_ADDRESS,
+    LSM9DS0_REGISTER_OUT_A,
+    LSM9DS0_RESOLUTION_A,
+    LSM9DS0_PERIOD_A_US,
+    0,
+};
+static imu_fifo_t g_gyroscope_fifo = {
+    LSM9DS0_G_ADDRESS, LSM9DS0_REGISTER_OUT_G, LSM9DS0_RESOLUTION_G, LSM9DS0_PERIOD_G_US, 0,
+};
+
+static size_t imu_read_fifo(imu_fifo_t* fifo, imu_sample_t* out, size_t max) {
+  uint8_t src = 0;
+  imu_read_register(fifo->device_address, LSM9DS0_REGISTER_FIFO_SRC_REG, &src, 1);
+  size_t available = src & LSM9DS0_FIFO_SRC_FSS_MASK;
+  if (src & LSM9DS0_FIFO_SRC_OVRN) available = LSM9DS0_FIFO_SIZE;
+  size_t n = available < max ? available : max;
+  if (n == 0) return 0;
+
+  // Static, like the sample arrays below: telemetry_task's stack is 4 KB and
+  // only one task reads the FIFOs.
+  static uint8_t buf[LSM9DS0_FIFO_SIZE * 6];
+  imu_read_register(fifo->device_address, fifo->out_register, buf, n * 6);
+
+  // Samples are spaced by the ODR; the newest buffered one was taken within
+  // one period of now. Keep counting periods from the previous drain so
+  // timestamps stay evenly spaced, and resync when the sensor clock drifted
+  // by more than a period or samples were lost.
+  int64_t now = esp_timer_get_time();
+  int64_t newest = fifo->last_sample_us + (int64_t)available * fifo->period_us;
+  if (fifo->last_sample_us == 0 || newest > now || now - newest > fifo->period_us) newest = now;
+
+  for (size_t i = 0; i < n; i++) {
+    out[i].value = imu_to_vector(buf + i * 6, fifo->resolution);
+    out[i].timestamp_us = newest - (int64_t)(available - 1 - i) * fifo->period_us;
+  }
+  fifo->last_sample_us = out[n - 1].timestamp_us;
+  return n;
+}
+
+size_t read_accelerometer_fifo(imu_sample_t* out, size_t max) {
+  return imu_read_fifo(&g_accelerometer_fifo, out, max);
+}
+
+size_t read_gyroscope_fifo(imu_sample_t* out, size_t max) {
+  return imu_read_fifo(&g_gyroscope_fifo, out, max);
+}
+
+vector3_t read_accelerometer() {
+  static imu_sample_t samples[LSM9DS0_FIFO_SIZE];
+  size_t n = read_accelerometer_fifo(samples, LSM9DS0_FIFO_SIZE);
+  if (n > 0) return samples[n - 1].value;
+  uint8_t buf[6];
+  imu_read_register(LSM9DS0_XM_ADDRESS, LSM9DS0_REGISTER_OUT_A, buf, sizeof(buf));
+  return imu_to_vector(buf, g_accelerometer_fifo.resolution);
 }
 
 vector3_t read_magnetometer() {
+  // The magnetometer has no FIFO.
   uint8_t buf[6];
   imu_read_register(LSM9DS0_XM_ADDRESS, LSM9DS0_REGISTER_OUT_M, buf, sizeof(buf));
-
-  int16_t raw_x = (buf[1] << 8) | buf[0];
-  int16_t raw_y = (buf[3] << 8) | buf[2];
-  int16_t raw_z = (buf[5] << 8) | buf[4];
-
-  vector3_t out;
-  out.x = (float)(raw_x)*LSM9DS0_RESOLUTION_M;
-  out.y = (float)(raw_y)*LSM9DS0_RESOLUTION_M;
-  out.z = (float)(raw_z)*LSM9DS0_RESOLUTION_M;
-  return out;
+  return imu_to_vector(buf, LSM9DS0_RESOLUTION_M);
 }
 
 vector3_t read_gyroscope() {
+  static imu_sample_t samples[LSM9DS0_FIFO_SIZE];
+  size_t n = read_gyroscope_fifo(samples, LSM9DS0_FIFO_SIZE);
+  if (n > 0) return samples[n - 1].value;
   uint8_t buf[6];
   imu_read_register(LSM9DS0_G_ADDRESS, LSM9DS0_REGISTER_OUT_G, buf, sizeof(buf));
+  return imu_to_vector(buf, g_gyroscope_fifo.resolution);
+}
 
-  int16_t raw_x = (buf[1] << 8) | buf[0];
-  int16_t raw_y = (buf[3] << 8) | buf[2];
-  int16_t raw_z = (buf[5] << 8) | buf[4];
+// Orientation is fused on every gyroscope sample (95 Hz) rather than once per
+// published packet.
+#define AHRS_BETA 0.1f
 
-  vector3_t out;
-  out.x = (float)(raw_x)*LSM9DS0_RESOLUTION_G;
-  out.y = (float)(raw_y)*LSM9DS0_RESOLUTION_G;
-  out.z = (float)(raw_z)*LSM9DS0_RESOLUTION_G;
-  return out;
+static ahrs_t g_ahrs = {1.0f, 0.0f, 0.0f, 0.0f, AHRS_BETA};
+static int64_t g_ahrs_timestamp_us = 0;
+
+static void ahrs_reset() {
+  ahrs_init(&g_ahrs, AHRS_BETA);
+  g_ahrs_timestamp_us = 0;
+}
+
+static void sample_imu(telemetry_packet_t* p) {
+  // Two full FIFOs are 1.5 KB; keep them off telemetry_task's stack.
+  static imu_sample_t accel[LSM9DS0_FIFO_SIZE];
+  static imu_sample_t gyro[LSM9DS0_FIFO_SIZE];
+  size_t accel_n = read_accelerometer_fifo(accel, LSM9DS0_FIFO_SIZE);
+  size_t gyro_n = read_gyroscope_fifo(gyro, LSM9DS0_FIFO_SIZE);
+  if (accel_n > 0) p->accelerometer = accel[accel_n - 1].value;
+  if (gyro_n > 0) p->gyroscope = gyro[gyro_n - 1].value;
+
+  // Both FIFOs are oldest first; pair each gyroscope sample with the
+  // accelerometer sample closest in time. The magnetometer has no FIFO and
+  // changes slowly, so its latest reading is used for the whole batch.
+  size_t a = 0;
+  for (size_t g = 0; g < gyro_n; g++) {
+    int64_t t = gyro[g].timestamp_us;
+    while (a + 1 < accel_n &&
+           llabs(accel[a + 1].timestamp_us - t) <= llabs(accel[a].timestamp_us - t)) {
+      a++;
+    }
+    int64_t dt_us = t - g_ahrs_timestamp_us;
+    // First sample, or samples were lost: integrate one nominal period.
+    if (g_ahrs_timestamp_us == 0 || dt_us <= 0 || dt_us > 4 * LSM9DS0_PERIOD_G_US) {
+      dt_us = LSM9DS0_PERIOD_G_US;
+    }
+    vector3_t accel_value = accel_n > 0 ? accel[a].value : p->accelerometer;
+    ahrs_update(&g_ahrs, gyro[g].value, accel_value, p->magnetometer, (float)dt_us / 1000000.0f);
+    g_ahrs_timestamp_us = t;
+  }
+  p->orientation = ahrs_orientation(&g_ahrs);
 }
 
 static uint32_t g_cap_resolution_hz = 0;
 static mcpwm_cap_channel_handle_t g_cap_channel = NULL;
+static esp_timer_handle_t g_urm_timer = NULL;
+
+// A reading older than three ranging periods means echoes stopped arriving.
+#define URM_STALE_US (3 * CONFIG_TELEMETRY_URM_PERIOD_MS * 1000LL)
+
+// Latest echo, written by the capture ISR.
+static int g_urm_distance_cm = -1;
+static int64_t g_urm_timestamp_us = 0;
+static portMUX_TYPE g_urm_lock = portMUX_INITIALIZER_UNLOCKED;
 
 static bool urm_echo_isr_handler(mcpwm_cap_channel_handle_t cap_channel,
                                  const mcpwm_capture_event_data_t* edata, void* user_data) {
   static uint32_t begin_of_sample = 0;
-  static uint32_t end_of_sample = 0;
 
-  BaseType_t high_task_wakeup = pdFALSE;
   if (edata->cap_edge == MCPWM_CAP_EDGE_NEG) {
     begin_of_sample = edata->cap_value;
-    end_of_sample = begin_of_sample;
-  } else {
-    end_of_sample = edata->cap_value;
-    uint32_t pulse_count = end_of_sample - begin_of_sample;
-    if (g_urm_waiting_task != NULL) {
-      xTaskNotifyIndexedFromISR(g_urm_waiting_task, TELEMETRY_URM_ISR_INDEX, pulse_count,
-                                eSetValueWithOverwrite, &high_task_wakeup);
-    }
+    return false;
   }
-  return high_task_wakeup == pdTRUE;
+  uint32_t pulse_count = edata->cap_value - begin_of_sample;
+  uint32_t pulse_width_us = (uint32_t)((uint64_t)pulse_count * 1000000ULL / g_cap_resolution_hz);
+  // 50 ms and longer is the sensor's "no echo" pulse.
+  int distance_cm = pulse_width_us < 50000 ? (int)(pulse_width_us / 50) : -1;
+
+  taskENTER_CRITICAL_ISR(&g_urm_lock);
+  g_urm_distance_cm = distance_cm;
+  g_urm_timestamp_us = esp_timer_get_time();
+  taskEXIT_CRITICAL_ISR(&g_urm_lock);
+  return false;
+}
+
+// Runs on the esp_timer task: the 10 us trigger pulse is the only work, the
+// echo is measured by the capture channel.
+static void urm_trigger(void* arg) {
+  gpio_set_level(URM_TRIG_PIN, 0);
+  esp_rom_delay_us(10);
+  gpio_set_level(URM_TRIG_PIN, 1);
 }
 
 void urm_init() {
@@ -308,75 +470,100 @@ void urm_init() {
   // The HC-SR04 example in v6 likewise requires gpio_set_pull_mode(GPIO_PULLUP_ONLY).
   gpio_pullup_en(URM_ECHO_PIN);
   gpio_pulldown_dis(URM_ECHO_PIN);
-}
 
-int get_distance_ahead() {
-  g_urm_waiting_task = xTaskGetCurrentTaskHandle();
-  xTaskNotifyStateClearIndexed(NULL, TELEMETRY_URM_ISR_INDEX);
-  ESP_ERROR_CHECK(gpio_set_level(URM_TRIG_PIN, 0));
-  esp_rom_delay_us(10);
-  ESP_ERROR_CHECK(gpio_set_level(URM_TRIG_PIN, 1));
-
-  uint32_t pulse_count = 0;
-  bool notified = xTaskNotifyWaitIndexed(TELEMETRY_URM_ISR_INDEX, 0x00, ULONG_MAX, &pulse_count,
-                                         pdMS_TO_TICKS(1000)) == pdTRUE;
-  g_urm_waiting_task = NULL;
-
-  if (notified) {
-    uint32_t pulse_width_us = (uint32_t)((uint64_t)pulse_count * 1000000ULL / g_cap_resolution_hz);
-    if (pulse_width_us >= 50000) {
-      ESP_LOGW(TAG, "Invalid URM pulse width");
-      return -1;
-    }
+  esp_timer_create_args_t timer_args = {};
+  timer_args.callback = urm_trigger;
+  timer_args.name = "urm_trigger";
+  ESP_ERROR_CHECK(esp_timer_create(&timer_args, &g_urm_timer));
+  ESP_ERROR_CHECK(esp_timer_start_periodic(g_urm_timer, CONFIG_TELEMETRY_URM_PERIOD_MS * 1000LL));
+}
 
-    float distance_cm = (float)pulse_width_us / 50;
-    return (int)distance_cm;
-  }
-  ESP_LOGW(TAG, "URM callback timeout");
-  return -1;
+distance_reading_t read_distance_ahead() {
+  taskENTER_CRITICAL(&g_urm_lock);
+  int distance_cm = g_urm_distance_cm;
+  int64_t timestamp_us = g_urm_timestamp_us;
+  taskEXIT_CRITICAL(&g_urm_lock);
+
+  distance_reading_t reading = {-1, -1};
+  if (timestamp_us == 0) return reading;
+  int64_t age_us = esp_timer_get_time() - timestamp_us;
+  reading.age_ms = (int)(age_us / 1000);
+  reading.distance_cm = age_us < URM_STALE_US ? distance_cm : -1;
+  return reading;
 }
 
+int get_distance_ahead() { return read_distance_ahead().distance_cm; }
+
 void telemetry_init(i2c_master_bus_handle_t i2c_bus) {
   pcnt_init();
   imu_init(i2c_bus);
   urm_init();
 }
 
+// Advances a schedule by one period; if the task fell behind, the missed slots
+// are skipped instead of being run back to back.
+static void schedule_next(int64_t* next_us, int64_t period_us, int64_t now) {
+  *next_us += period_us;
+  if (*next_us <= now) *next_us = now + period_us;
+}
+
+static void telemetry_publish(telemetry_packet_t* packet) {
+  packet->timestamp_us = esp_timer_get_time();
+  telemetry_metrics_update(*packet);
+  // Never wait for the consumer: that would stall sampling. The ring holds
+  // CONFIG_TELEMETRY_RING_CAPACITY packets, so a client that stalls for
+  // longer misses packets instead.
+  if (!telemetry_ring_push(g_telemetry_ring, packet)) {
+    ESP_LOGD(TAG, "Telemetry ring full, packet dropped");
+  }
+}
+
 void telemetry_task(void* p) {
   ESP_LOGI(TAG, "Starting telemetry task");
-  bool started = false;
   while (true) {
-    if (!started) {
-      ESP_LOGI(TAG, "Waiting for notification to start telemetry");
-      ulTaskNotifyTakeIndexed(TELEMETRY_START_NOTIFICATION_INDEX, pdTRUE, portMAX_DELAY);
-      started = true;
-      reset_pcnt();
-      ESP_LOGI(TAG, "Telemetry started");
-    }
-
-    if (ulTaskNotifyTakeIndexed(TELEMETRY_STOP_NOTIFICATION_INDEX, pdTRUE, 0) == 1) {
-      started = false;
-      ESP_LOGI(TAG, "Telemetry stopped");
-      continue;
-    }
-
+    ESP_LOGI(TAG, "Waiting for notification to start telemetry");
+    ulTaskNotifyTakeIndexed(TELEMETRY_START_NOTIFICATION_INDEX, pdTRUE, portMAX_DELAY);
+    ulTaskNotifyTakeIndexed(TELEMETRY_STOP_NOTIFICATION_INDEX, pdTRUE, 0);
+    reset_pcnt();
+    ahrs_reset();
     telemetry_packet_t packet = {};
-    get_telemetry_packet(&packet);
-    telemetry_metrics_update(packet);
-
-    if (xQueueSendToBack(g_telemetry_queue, &packet, portMAX_DELAY) != pdPASS) {
-      ESP_LOGE(TAG, "xQueueSendToBack failed");
-      break;
+    int64_t now = esp_timer_get_time();
+    for (auto& source : g_sources) {
+      source.sample(&packet);
+      source.next_us = now + source.period_us;
+    }
+    int64_t next_publish_us = now;
+    ESP_LOGI(TAG, "Telemetry started");
+
+    while (true) {
+      now = esp_timer_get_time();
+      for (auto& source : g_sources) {
+        if (now < source.next_us) continue;
+        source.sample(&packet);
+        schedule_next(&source.next_us, source.period_us, now);
+      }
+      if (now >= next_publish_us) {
+        telemetry_publish(&packet);
+        schedule_next(&next_publish_us, TELEMETRY_PUBLISH_PERIOD_US, now);
+      }
+
+      int64_t next_us = next_publish_us;
+      for (const auto& source : g_sources) {
+        if (source.next_us < next_us) next_us = source.next_us;
+      }
+      int64_t delay_us = next_us - esp_timer_get_time();
+      TickType_t delay = delay_us > 0 ? pdMS_TO_TICKS((delay_us + 999) / 1000) : 0;
+      // Sleeping on the stop notification keeps stop latency at one period.
+      if (ulTaskNotifyTakeIndexed(TELEMETRY_STOP_NOTIFICATION_INDEX, pdTRUE, delay) == 1) {
+        ESP_LOGI(TAG, "Telemetry stopped");
+        break;
+      }
     }
-
-    vTaskDelay(500 / portTICK_PERIOD_MS);
   }
-  ESP_LOGW(TAG, "Telemetry task stopped");
-  vTaskDelete(NULL);
 }
 
-void telemetry_setup(QueueHandle_t telemetry_queue, i2c_master_bus_handle_t i2c_bus) {
-  g_telemetry_queue = telemetry_queue;
+void telemetry_setup(telemetry_ring_t* telemetry_ring, i2c_master_bus_handle_t i2c_bus) {
+  g_telemetry_ring = telemetry_ring;
 
   telemetry_init(i2c_bus);
 
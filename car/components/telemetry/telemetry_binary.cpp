@@ -0,0 +1,175 @@
+#include "telemetry_binary.hpp"
+#include <math.h>
+#include <string.h>
+
+// Fields of one record, in wire order.
+#define TELEMETRY_BINARY_FIELDS 17
+
+#define SPEED_SCALE 100.0f           // 0.01 km/h
+#define ACCELEROMETER_SCALE 1000.0f  // mg
+#define MAGNETOMETER_SCALE 10000.0f  // 0.1 mG
+#define GYROSCOPE_SCALE 100.0f       // 0.01 deg/s
+#define ORIENTATION_SCALE 100.0f     // 0.01 deg
+
+static int64_t to_fixed(float value, float scale) {
+  float scaled = roundf(value * scale);
+  if (!(scaled > INT16_MIN)) return INT16_MIN;  // Also maps NaN
+  if (scaled > INT16_MAX) return INT16_MAX;
+  return (int64_t)scaled;
+}
+
+static float from_fixed(int64_t value, float scale) { return (float)value / scale; }
+
+static void pack_fields(const telemetry_packet_t& p, int64_t* f) {
+  *f++ = p.timestamp_us;
+  *f++ = p.rssi;
+  *f++ = to_fixed(p.speed, SPEED_SCALE);
+  *f++ = to_fixed(p.accelerometer.x, ACCELEROMETER_SCALE);
+  *f++ = to_fixed(p.accelerometer.y, ACCELEROMETER_SCALE);
+  *f++ = to_fixed(p.accelerometer.z, ACCELEROMETER_SCALE);
+  *f++ = to_fixed(p.magnetometer.x, MAGNETOMETER_SCALE);
+  *f++ = to_fixed(p.magnetometer.y, MAGNETOMETER_SCALE);
+  *f++ = to_fixed(p.magnetometer.z, MAGNETOMETER_SCALE);
+  *f++ = to_fixed(p.gyroscope.x, GYROSCOPE_SCALE);
+  *f++ = to_fixed(p.gyroscope.y, GYROSCOPE_SCALE);
+  *f++ = to_fixed(p.gyroscope.z, GYROSCOPE_SCALE);
+  *f++ = p.distance_ahead;
+  *f++ = p.distance_ahead_age_ms;
+  *f++ = to_fixed(p.orientation.roll, ORIENTATION_SCALE);
+  *f++ = to_fixed(p.orientation.pitch, ORIENTATION_SCALE);
+  *f++ = to_fixed(p.orientation.yaw, ORIENTATION_SCALE);
+}
+
+static void unpack_fields(const int64_t* f, telemetry_packet_t* p) {
+  memset(p, 0, sizeof(*p));
+  p->timestamp_us = *f++;
+  p->rssi = (int)*f++;
+  p->speed = from_fixed(*f++, SPEED_SCALE);
+  p->accelerometer.x = from_fixed(*f++, ACCELEROMETER_SCALE);
+  p->accelerometer.y = from_fixed(*f++, ACCELEROMETER_SCALE);
+  p->accelerometer.z = from_fixed(*f++, ACCELEROMETER_SCALE);
+  p->magnetometer.x = from_fixed(*f++, MAGNETOMETER_SCALE);
+  p->magnetometer.y = from_fixed(*f++, MAGNETOMETER_SCALE);
+  p->magnetometer.z = from_fixed(*f++, MAGNETOMETER_SCALE);
+  p->gyroscope.x = from_fixed(*f++, GYROSCOPE_SCALE);
+  p->gyroscope.y = from_fixed(*f++, GYROSCOPE_SCALE);
+  p->gyroscope.z = from_fixed(*f++, GYROSCOPE_SCALE);
+  p->distance_ahead = (int)*f++;
+  p->distance_ahead_age_ms = (int)*f++;
+  p->orientation.roll = from_fixed(*f++, ORIENTATION_SCALE);
+  p->orientation.pitch = from_fixed(*f++, ORIENTATION_SCALE);
+  p->orientation.yaw = from_fixed(*f++, ORIENTATION_SCALE);
+}
+
+static uint8_t* put_le(uint8_t* out, uint64_t value, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    out[i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+  return out + size;
+}
+
+static uint64_t get_le(const uint8_t* in, size_t size) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < size; i++) value |= static_cast<uint64_t>(in[i]) << (8 * i);
+  return value;
+}
+
+static uint8_t* put_varint(uint8_t* out, int64_t value) {
+  uint64_t zigzag = (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+  while (zigzag >= 0x80) {
+    *out++ = static_cast<uint8_t>(zigzag | 0x80);
+    zigzag >>= 7;
+  }
+  *out++ = static_cast<uint8_t>(zigzag);
+  return out;
+}
+
+static const uint8_t* get_varint(const uint8_t* in, const uint8_t* end, int64_t* value) {
+  uint64_t zigzag = 0;
+  for (int shift = 0; shift < 64 && in < end; shift += 7) {
+    uint8_t byte = *in++;
+    zigzag |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      *value = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+      return in;
+    }
+  }
+  return NULL;
+}
+
+size_t encode_telemetry_binary(const telemetry_binary_header_t* header,
+                               const telemetry_packet_t* packets, size_t count, uint8_t* out,
+                               size_t out_size) {
+  if (!header || !out || count > UINT16_MAX || (count > 0 && !packets)) return 0;
+  bool trace = header->flags & TELEMETRY_BINARY_FLAG_TRACE_CONTEXT;
+  size_t header_size =
+      TELEMETRY_BINARY_HEADER_SIZE + (trace ? TELEMETRY_BINARY_TRACE_CONTEXT_SIZE : 0);
+  if (out_size < header_size + count * TELEMETRY_BINARY_RECORD_MAX_SIZE) return 0;
+
+  int64_t previous[TELEMETRY_BINARY_FIELDS] = {};
+  previous[0] = count > 0 ? packets[0].timestamp_us : 0;
+
+  uint8_t* p = out;
+  *p++ = TELEMETRY_BINARY_VERSION;
+  *p++ = header->flags;
+  p = put_le(p, count, 2);
+  p = put_le(p, header->dropped, sizeof(header->dropped));
+  p = put_le(p, static_cast<uint64_t>(previous[0]), sizeof(int64_t));
+  if (trace) {
+    memcpy(p, header->trace_id, sizeof(header->trace_id));
+    p += sizeof(header->trace_id);
+    memcpy(p, header->span_id, sizeof(header->span_id));
+    p += sizeof(header->span_id);
+    *p++ = header->trace_flags;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    int64_t fields[TELEMETRY_BINARY_FIELDS];
+    pack_fields(packets[i], fields);
+    for (size_t f = 0; f < TELEMETRY_BINARY_FIELDS; f++) {
+      p = put_varint(p, fields[f] - previous[f]);
+      previous[f] = fields[f];
+    }
+  }
+  return static_cast<size_t>(p - out);
+}
+
+bool decode_telemetry_binary(const uint8_t* data, size_t len, telemetry_binary_header_t* header,
+                             telemetry_packet_t* out, size_t max, size_t* count) {
+  if (!data || !header || !count || len < TELEMETRY_BINARY_HEADER_SIZE) return false;
+  if (data[0] != TELEMETRY_BINARY_VERSION) return false;
+  const uint8_t* end = data + len;
+  const uint8_t* p = data + 1;
+
+  memset(header, 0, sizeof(*header));
+  header->flags = *p++;
+  size_t n = get_le(p, 2);
+  p += 2;
+  header->dropped = static_cast<uint32_t>(get_le(p, sizeof(header->dropped)));
+  p += sizeof(header->dropped);
+  int64_t previous[TELEMETRY_BINARY_FIELDS] = {};
+  previous[0] = static_cast<int64_t>(get_le(p, sizeof(int64_t)));
+  p += sizeof(int64_t);
+  if (header->flags & TELEMETRY_BINARY_FLAG_TRACE_CONTEXT) {
+    if (end - p < TELEMETRY_BINARY_TRACE_CONTEXT_SIZE) return false;
+    memcpy(header->trace_id, p, sizeof(header->trace_id));
+    p += sizeof(header->trace_id);
+    memcpy(header->span_id, p, sizeof(header->span_id));
+    p += sizeof(header->span_id);
+    header->trace_flags = *p++;
+  }
+  if (n > max || (n > 0 && !out)) return false;
+
+  for (size_t i = 0; i < n; i++) {
+    for (size_t f = 0; f < TELEMETRY_BINARY_FIELDS; f++) {
+      int64_t delta = 0;
+      p = get_varint(p, end, &delta);
+      if (!p) return false;
+      previous[f] += delta;
+    }
+    unpack_fields(previous, &out[i]);
+  }
+  if (p != end) return false;
+  *count = n;
+  return true;
+}
@@ -1,9 +1,15 @@
 #include "telemetry_types.hpp"
 #include <cJSON.h>
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 cJSON* convert_telemetry_packet_to_json(const telemetry_packet_t& p) {
   cJSON* root = cJSON_CreateObject();
-  cJSON_AddStringToObject(root, "timestamp", p.timestamp);
+  cJSON_AddNumberToObject(root, "timestamp_us", (double)p.timestamp_us);
   cJSON_AddNumberToObject(root, "rssi", p.rssi);
   cJSON_AddNumberToObject(root, "speed", p.speed);
 
@@ -23,6 +29,204 @@ cJSON* convert_telemetry_packet_to_json(const telemetry_packet_t& p) {
   cJSON_AddNumberToObject(gyroscope, "z", p.gyroscope.z);
 
   cJSON_AddNumberToObject(root, "distance_ahead", p.distance_ahead);
+  cJSON_AddNumberToObject(root, "distance_ahead_age_ms", p.distance_ahead_age_ms);
 
+  cJSON* orientation = cJSON_AddObjectToObject(root, "orientation");
+  cJSON_AddNumberToObject(orientation, "roll", p.orientation.roll);
+  cJSON_AddNumberToObject(orientation, "pitch", p.orientation.pitch);
+  cJSON_AddNumberToObject(orientation, "yaw", p.orientation.yaw);
+
+  return root;
+}
+
+cJSON* convert_telemetry_batch_to_json(const telemetry_packet_t* packets, size_t count,
+                                       uint32_t dropped) {
+  cJSON* root = cJSON_CreateObject();
+  cJSON* array = cJSON_AddArrayToObject(root, "packets");
+  for (size_t i = 0; i < count; i++) {
+    cJSON_AddItemToArray(array, convert_telemetry_packet_to_json(packets[i]));
+  }
+  cJSON_AddNumberToObject(root, "dropped", dropped);
   return root;
 }
+
+namespace {
+
+// Appends to a fixed buffer; once something does not fit, every later write
+// is dropped and ok stays false.
+struct json_writer_t {
+  char* p;
+  char* end;
+  bool ok;
+};
+
+void put_raw(json_writer_t* w, const char* s, size_t len) {
+  if (!w->ok || static_cast<size_t>(w->end - w->p) <= len) {
+    w->ok = false;
+    return;
+  }
+  memcpy(w->p, s, len);
+  w->p += len;
+}
+
+void put_char(json_writer_t* w, char c) { put_raw(w, &c, 1); }
+
+// Same escaping as cJSON's print_string_ptr.
+void put_string(json_writer_t* w, const char* s) {
+  put_char(w, '"');
+  for (; *s; s++) {
+    unsigned char c = static_cast<unsigned char>(*s);
+    switch (c) {
+      case '"':
+        put_raw(w, "\\\"", 2);
+        break;
+      case '\\':
+        put_raw(w, "\\\\", 2);
+        break;
+      case '\b':
+        put_raw(w, "\\b", 2);
+        break;
+      case '\f':
+        put_raw(w, "\\f", 2);
+        break;
+      case '\n':
+        put_raw(w, "\\n", 2);
+        break;
+      case '\r':
+        put_raw(w, "\\r", 2);
+        break;
+      case '\t':
+        put_raw(w, "\\t", 2);
+        break;
+      default:
+        if (c < 32) {
+          char escaped[7];
+          snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+          put_raw(w, escaped, 6);
+        } else {
+          put_char(w, static_cast<char>(c));
+        }
+    }
+  }
+  put_char(w, '"');
+}
+
+// Same formatting as cJSON's print_number: integral values as %d, others
+// with 15 significant digits unless that does not read back as the same
+// double, NaN and infinities as null.
+void put_number(json_writer_t* w, double d) {
+  if (isnan(d) || isinf(d)) {
+    put_raw(w, "null", 4);
+    return;
+  }
+  char buf[32];
+  int len;
+  // cJSON_CreateNumber's saturating valueint.
+  int valueint = d >= INT_MAX ? INT_MAX : d <= (double)INT_MIN ? INT_MIN : (int)d;
+  if (d == (double)valueint) {
+    len = snprintf(buf, sizeof(buf), "%d", valueint);
+  } else {
+    len = snprintf(buf, sizeof(buf), "%1.15g", d);
+    double test = strtod(buf, NULL);
+    double max = fabs(test) > fabs(d) ? fabs(test) : fabs(d);
+    if (!(fabs(test - d) <= max * DBL_EPSILON)) {
+      len = snprintf(buf, sizeof(buf), "%1.17g", d);
+    }
+  }
+  put_raw(w, buf, static_cast<size_t>(len));
+}
+
+void put_key(json_writer_t* w, const char* key, bool first) {
+  if (!first) put_char(w, ',');
+  put_string(w, key);
+  put_char(w, ':');
+}
+
+void put_vector(json_writer_t* w, const char* key, const vector3_t& v) {
+  put_key(w, key, false);
+  put_raw(w, "{\"x\":", 5);
+  put_number(w, v.x);
+  put_raw(w, ",\"y\":", 5);
+  put_number(w, v.y);
+  put_raw(w, ",\"z\":", 5);
+  put_number(w, v.z);
+  put_char(w, '}');
+}
+
+// Everything of convert_telemetry_packet_to_json's object but the closing
+// brace, so trace context keys can follow at the root.
+void put_packet_fields(json_writer_t* w, const telemetry_packet_t& p) {
+  put_char(w, '{');
+  put_key(w, "timestamp_us", true);
+  put_number(w, (double)p.timestamp_us);
+  put_key(w, "rssi", false);
+  put_number(w, p.rssi);
+  put_key(w, "speed", false);
+  put_number(w, p.speed);
+  put_vector(w, "accelerometer", p.accelerometer);
+  put_vector(w, "magnetometer", p.magnetometer);
+  put_vector(w, "gyroscope", p.gyroscope);
+  put_key(w, "distance_ahead", false);
+  put_number(w, p.distance_ahead);
+  put_key(w, "distance_ahead_age_ms", false);
+  put_number(w, p.distance_ahead_age_ms);
+  put_key(w, "orientation", false);
+  put_char(w, '{');
+  put_key(w, "roll", true);
+  put_number(w, p.orientation.roll);
+  put_key(w, "pitch", false);
+  put_number(w, p.orientation.pitch);
+  put_key(w, "yaw", false);
+  put_number(w, p.orientation.yaw);
+  put_char(w, '}');
+}
+
+void put_trace_context(json_writer_t* w, const char* traceparent, const char* tracestate) {
+  if (traceparent && traceparent[0]) {
+    put_key(w, "traceparent", false);
+    put_string(w, traceparent);
+  }
+  if (tracestate && tracestate[0]) {
+    put_key(w, "tracestate", false);
+    put_string(w, tracestate);
+  }
+}
+
+size_t finish(json_writer_t* w, char* out) {
+  if (!w->ok) return 0;
+  *w->p = '\0';
+  return static_cast<size_t>(w->p - out);
+}
+
+}  // namespace
+
+size_t write_telemetry_packet_json(const telemetry_packet_t& p, const char* traceparent,
+                                   const char* tracestate, char* out, size_t out_size) {
+  if (!out || out_size == 0) return 0;
+  json_writer_t w = {out, out + out_size, true};
+  put_packet_fields(&w, p);
+  put_trace_context(&w, traceparent, tracestate);
+  put_char(&w, '}');
+  return finish(&w, out);
+}
+
+size_t write_telemetry_batch_json(const telemetry_packet_t* packets, size_t count,
+                                  uint32_t dropped, const char* traceparent,
+                                  const char* tracestate, char* out, size_t out_size) {
+  if (!out || out_size == 0) return 0;
+  json_writer_t w = {out, out + out_size, true};
+  put_char(&w, '{');
+  put_key(&w, "packets", true);
+  put_char(&w, '[');
+  for (size_t i = 0; i < count; i++) {
+    if (i > 0) put_char(&w, ',');
+    put_packet_fields(&w, packets[i]);
+    put_char(&w, '}');
+  }
+  put_char(&w, ']');
+  put_key(&w, "dropped", false);
+  put_number(&w, dropped);
+  put_trace_context(&w, traceparent, tracestate);
+  put_char(&w, '}');
+  return finish(&w, out);
+}
@@ -3,8 +3,12 @@
 #include "sdkconfig.h"
 
 #ifdef CONFIG_ESP_OPENTELEMETRY_METRICS_ENABLED
-#include "freertos/FreeRTOS.h"
-#include "freertos/semphr.h"
+#include <array>
+#include <atomic>
+#include <utility>
+
+#include "esp_timer.h"
+#include "opentelemetry/common/key_value_iterable_view.h"
 #include "opentelemetry/metrics/async_instruments.h"
 #include "opentelemetry/metrics/provider.h"
 
@@ -19,17 +23,57 @@ struct State {
   float accel_x = 0.0f, accel_y = 0.0f, accel_z = 0.0f;
   float mag_x = 0.0f, mag_y = 0.0f, mag_z = 0.0f;
   float gyro_x = 0.0f, gyro_y = 0.0f, gyro_z = 0.0f;
+  float roll = 0.0f, pitch = 0.0f, yaw = 0.0f;
 };
 
+// Seqlock: telemetry_metrics_update() is the only writer and never waits.
+// s_seq is odd while s_state is being written; a reader retries if it saw an
+// odd count or the count changed during its copy.
 static State s_state;
-static SemaphoreHandle_t s_mutex = NULL;
-
-static State snapshot_state() {
-  State snap;
-  xSemaphoreTake(s_mutex, portMAX_DELAY);
-  snap = s_state;
-  xSemaphoreGive(s_mutex);
-  return snap;
+static std::atomic<uint32_t> s_seq{0};
+
+// Copy taken once per collection cycle and read by every callback. Only the
+// metric reader thread touches it.
+static State s_snapshot;
+static int64_t s_last_snapshot_time = 0;
+
+static constexpr int kSnapshotRetries = 4;
+
+static const State& snapshot_state() {
+  int64_t now = esp_timer_get_time();
+  if (s_last_snapshot_time != 0 && now - s_last_snapshot_time < 100000LL) return s_snapshot;
+
+  for (int i = 0; i < kSnapshotRetries; i++) {
+    uint32_t seq = s_seq.load(std::memory_order_acquire);
+    if (seq & 1) continue;
+    State snap = s_state;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (s_seq.load(std::memory_order_relaxed) != seq) continue;
+    s_snapshot = snap;
+    s_last_snapshot_time = now;
+    break;
+  }
+  // If the writer kept s_state busy, the previous snapshot is reported and
+  // the next callback tries again.
+  return s_snapshot;
+}
+
+static const char* const kXyz[3] = {"x", "y", "z"};
+static const char* const kRollPitchYaw[3] = {"roll", "pitch", "yaw"};
+
+// One series per axis, told apart by the axis attribute, so a vector sensor
+// is a single instrument and a single callback.
+static void observe_axes(metrics_api::ObserverResult& obs, const char* const (&axes)[3], double a,
+                         double b, double c) {
+  using Pair = std::pair<opentelemetry::nostd::string_view, opentelemetry::common::AttributeValue>;
+  auto& result = opentelemetry::nostd::get<
+      opentelemetry::nostd::shared_ptr<metrics_api::ObserverResultT<double>>>(obs);
+  const double values[3] = {a, b, c};
+  for (size_t i = 0; i < 3; i++) {
+    std::array<Pair, 1> attrs{{{"axis", opentelemetry::nostd::string_view(axes[i])}}};
+    result->Observe(values[i],
+                    opentelemetry::common::KeyValueIterableView<std::array<Pair, 1>>(attrs));
+  }
 }
 
 static void cb_rssi(metrics_api::ObserverResult obs, void*) {
@@ -41,35 +85,24 @@ static void cb_speed(metrics_api::ObserverResult obs, void*) {
 static void cb_distance_ahead(metrics_api::ObserverResult obs, void*) {
   observe_int64(obs, snapshot_state().distance_ahead);
 }
-static void cb_accel_x(metrics_api::ObserverResult obs, void*) {
-  observe_double(obs, snapshot_state().accel_x);
-}
-static void cb_accel_y(metrics_api::ObserverResult obs, void*) {
-  observe_double(obs, snapshot_state().accel_y);
-}
-static void cb_accel_z(metrics_api::ObserverResult obs, void*) {
-  observe_double(obs, snapshot_state().accel_z);
-}
-static void cb_mag_x(metrics_api::ObserverResult obs, void*) {
-  observe_double(obs, snapshot_state().mag_x);
+static void cb_accelerometer(metrics_api::ObserverResult obs, void*) {
+  const State& state = snapshot_state();
+  observe_axes(obs, kXyz, state.accel_x, state.accel_y, state.accel_z);
 }
-static void cb_mag_y(metrics_api::ObserverResult obs, void*) {
-  observe_double(obs, snapshot_state().mag_y);
+static void cb_magnetometer(metrics_api::ObserverResult obs, void*) {
+  const State& state = snapshot_state();
+  observe_axes(obs, kXyz, state.mag_x, state.mag_y, state.mag_z);
 }
-static void cb_mag_z(metrics_api::ObserverResult obs, void*) {
-  observe_double(obs, snapshot_state().mag_z);
+static void cb_gyroscope(metrics_api::ObserverResult obs, void*) {
+  const State& state = snapshot_state();
+  observe_axes(obs, kXyz, state.gyro_x, state.gyro_y, state.gyro_z);
 }
-static void cb_gyro_x(metrics_api::ObserverResult obs, void*) {
-  observe_double(obs, snapshot_state().gyro_x);
-}
-static void cb_gyro_y(metrics_api::ObserverResult obs, void*) {
-  observe_double(obs, snapshot_state().gyro_y);
-}
-static void cb_gyro_z(metrics_api::ObserverResult obs, void*) {
-  observe_double(obs, snapshot_state().gyro_z);
+static void cb_orientation(metrics_api::ObserverResult obs, void*) {
+  const State& state = snapshot_state();
+  observe_axes(obs, kRollPitchYaw, state.roll, state.pitch, state.yaw);
 }
 
-static constexpr size_t kNumInstruments = 12;
+static constexpr size_t kNumInstruments = 7;
 static opentelemetry::nostd::shared_ptr<metrics_api::ObservableInstrument>
     s_instruments[kNumInstruments];
 
@@ -78,12 +111,10 @@ static opentelemetry::nostd::shared_ptr<metrics_api::ObservableInstrument>
 
 void telemetry_metrics_setup() {
 #ifdef CONFIG_ESP_OPENTELEMETRY_METRICS_ENABLED
-  s_mutex = xSemaphoreCreateMutex();
-
   auto meter = metrics_api::Provider::GetMeterProvider()->GetMeter(
       CONFIG_ESP_OPENTELEMETRY_SERVICE_NAME, "1.0.0");
 
-  static_assert(kNumInstruments == 12,
+  static_assert(kNumInstruments == 7,
                 "Update kNumInstruments when adding or removing instruments");
 
   s_instruments[0] = meter->CreateInt64ObservableGauge("dust_mite.rssi", "WiFi RSSI", "dBm");
@@ -91,43 +122,29 @@ void telemetry_metrics_setup() {
   s_instruments[2] =
       meter->CreateInt64ObservableGauge("dust_mite.distance_ahead", "Ultrasonic distance", "cm");
   s_instruments[3] =
-      meter->CreateDoubleObservableGauge("dust_mite.accelerometer.x", "Accelerometer X", "g");
+      meter->CreateDoubleObservableGauge("dust_mite.accelerometer", "Accelerometer", "g");
   s_instruments[4] =
-      meter->CreateDoubleObservableGauge("dust_mite.accelerometer.y", "Accelerometer Y", "g");
+      meter->CreateDoubleObservableGauge("dust_mite.magnetometer", "Magnetometer", "G");
   s_instruments[5] =
-      meter->CreateDoubleObservableGauge("dust_mite.accelerometer.z", "Accelerometer Z", "g");
+      meter->CreateDoubleObservableGauge("dust_mite.gyroscope", "Gyroscope", "deg/s");
   s_instruments[6] =
-      meter->CreateDoubleObservableGauge("dust_mite.magnetometer.x", "Magnetometer X", "G");
-  s_instruments[7] =
-      meter->CreateDoubleObservableGauge("dust_mite.magnetometer.y", "Magnetometer Y", "G");
-  s_instruments[8] =
-      meter->CreateDoubleObservableGauge("dust_mite.magnetometer.z", "Magnetometer Z", "G");
-  s_instruments[9] =
-      meter->CreateDoubleObservableGauge("dust_mite.gyroscope.x", "Gyroscope X", "deg/s");
-  s_instruments[10] =
-      meter->CreateDoubleObservableGauge("dust_mite.gyroscope.y", "Gyroscope Y", "deg/s");
-  s_instruments[11] =
-      meter->CreateDoubleObservableGauge("dust_mite.gyroscope.z", "Gyroscope Z", "deg/s");
+      meter->CreateDoubleObservableGauge("dust_mite.orientation", "Fused orientation", "deg");
 
   s_instruments[0]->AddCallback(cb_rssi, nullptr);
   s_instruments[1]->AddCallback(cb_speed, nullptr);
   s_instruments[2]->AddCallback(cb_distance_ahead, nullptr);
-  s_instruments[3]->AddCallback(cb_accel_x, nullptr);
-  s_instruments[4]->AddCallback(cb_accel_y, nullptr);
-  s_instruments[5]->AddCallback(cb_accel_z, nullptr);
-  s_instruments[6]->AddCallback(cb_mag_x, nullptr);
-  s_instruments[7]->AddCallback(cb_mag_y, nullptr);
-  s_instruments[8]->AddCallback(cb_mag_z, nullptr);
-  s_instruments[9]->AddCallback(cb_gyro_x, nullptr);
-  s_instruments[10]->AddCallback(cb_gyro_y, nullptr);
-  s_instruments[11]->AddCallback(cb_gyro_z, nullptr);
+  s_instruments[3]->AddCallback(cb_accelerometer, nullptr);
+  s_instruments[4]->AddCallback(cb_magnetometer, nullptr);
+  s_instruments[5]->AddCallback(cb_gyroscope, nullptr);
+  s_instruments[6]->AddCallback(cb_orientation, nullptr);
 #endif
 }
 
 void telemetry_metrics_update(const telemetry_packet_t& packet) {
 #ifdef CONFIG_ESP_OPENTELEMETRY_METRICS_ENABLED
-  if (!s_mutex) return;
-  xSemaphoreTake(s_mutex, portMAX_DELAY);
+  uint32_t seq = s_seq.load(std::memory_order_relaxed);
+  s_seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
   s_state.rssi = packet.rssi;
   s_state.speed = packet.speed;
   s_state.distance_ahead = packet.distance_ahead;
@@ -140,6 +157,9 @@ void telemetry_metrics_update(const telemetry_packet_t& packet) {
   s_state.gyro_x = packet.gyroscope.x;
   s_state.gyro_y = packet.gyroscope.y;
   s_state.gyro_z = packet.gyroscope.z;
-  xSemaphoreGive(s_mutex);
+  s_state.roll = packet.orientation.roll;
+  s_state.pitch = packet.orientation.pitch;
+  s_state.yaw = packet.orientation.yaw;
+  s_seq.store(seq + 2, std::memory_order_release);
 #endif
 }
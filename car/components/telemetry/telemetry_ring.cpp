@@ -0,0 +1,70 @@
+#include "telemetry_ring.hpp"
+#include "esp_heap_caps.h"
+#include <atomic>
+#include <new>
+
+struct telemetry_ring {
+  telemetry_packet_t* slots;
+  uint32_t mask;
+  // head and tail count packets since creation and wrap around uint32_t;
+  // head - tail is the fill level. Only the producer writes head and only the
+  // consumer writes tail.
+  std::atomic<uint32_t> head;
+  std::atomic<uint32_t> tail;
+  std::atomic<uint32_t> dropped;
+};
+
+telemetry_ring_t* telemetry_ring_create(size_t capacity) {
+  uint32_t size = 1;
+  while (size < capacity) size <<= 1;
+
+  void* mem = heap_caps_malloc(sizeof(telemetry_ring_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  if (!mem) return NULL;
+  telemetry_ring_t* ring = new (mem) telemetry_ring_t();
+  ring->slots = static_cast<telemetry_packet_t*>(
+      heap_caps_malloc_prefer(size * sizeof(telemetry_packet_t), 2,
+                              MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT, MALLOC_CAP_DEFAULT));
+  if (!ring->slots) {
+    heap_caps_free(ring);
+    return NULL;
+  }
+  ring->mask = size - 1;
+  return ring;
+}
+
+void telemetry_ring_delete(telemetry_ring_t* ring) {
+  if (!ring) return;
+  heap_caps_free(ring->slots);
+  ring->~telemetry_ring();
+  heap_caps_free(ring);
+}
+
+size_t telemetry_ring_capacity(const telemetry_ring_t* ring) { return ring->mask + 1; }
+
+bool telemetry_ring_push(telemetry_ring_t* ring, const telemetry_packet_t* packet) {
+  uint32_t head = ring->head.load(std::memory_order_relaxed);
+  uint32_t tail = ring->tail.load(std::memory_order_acquire);
+  if (head - tail > ring->mask) {
+    ring->dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  ring->slots[head & ring->mask] = *packet;
+  // Publish the slot contents before the consumer can see the new head.
+  ring->head.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+size_t telemetry_ring_pop(telemetry_ring_t* ring, telemetry_packet_t* out, size_t max) {
+  uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+  uint32_t head = ring->head.load(std::memory_order_acquire);
+  size_t n = head - tail;
+  if (n > max) n = max;
+  for (size_t i = 0; i < n; i++) out[i] = ring->slots[(tail + i) & ring->mask];
+  // Hand the slots back to the producer only after they were copied out.
+  ring->tail.store(tail + static_cast<uint32_t>(n), std::memory_order_release);
+  return n;
+}
+
+uint32_t telemetry_ring_take_dropped(telemetry_ring_t* ring) {
+  return ring->dropped.exchange(0, std::memory_order_relaxed);
+}
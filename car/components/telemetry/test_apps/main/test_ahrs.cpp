@@ -0,0 +1,89 @@
+#include "ahrs.hpp"
+#include "unity.h"
+#include <math.h>
+
+static const vector3_t kNoRotation = {0.0f, 0.0f, 0.0f};
+static const vector3_t kNoMagnetometer = {0.0f, 0.0f, 0.0f};
+
+TEST_CASE("ahrs_level", "[ahrs]") {
+  ahrs_t ahrs;
+  ahrs_init(&ahrs, 0.1f);
+  vector3_t accel = {0.0f, 0.0f, 1.0f};
+  for (int i = 0; i < 100; i++) ahrs_update(&ahrs, kNoRotation, accel, kNoMagnetometer, 0.01f);
+  orientation_t o = ahrs_orientation(&ahrs);
+  TEST_ASSERT_FLOAT_WITHIN(0.1f, 0.0f, o.roll);
+  TEST_ASSERT_FLOAT_WITHIN(0.1f, 0.0f, o.pitch);
+  TEST_ASSERT_FLOAT_WITHIN(0.1f, 0.0f, o.yaw);
+}
+
+TEST_CASE("ahrs_converges_to_roll", "[ahrs]") {
+  ahrs_t ahrs;
+  ahrs_init(&ahrs, 0.1f);
+  vector3_t accel = {0.0f, 0.5f, 0.866f};  // 30 degrees about X
+  for (int i = 0; i < 3000; i++) ahrs_update(&ahrs, kNoRotation, accel, kNoMagnetometer, 0.01f);
+  orientation_t o = ahrs_orientation(&ahrs);
+  TEST_ASSERT_FLOAT_WITHIN(1.0f, 30.0f, o.roll);
+  TEST_ASSERT_FLOAT_WITHIN(1.0f, 0.0f, o.pitch);
+}
+
+TEST_CASE("ahrs_converges_to_pitch", "[ahrs]") {
+  ahrs_t ahrs;
+  ahrs_init(&ahrs, 0.1f);
+  vector3_t accel = {-0.5f, 0.0f, 0.866f};  // 30 degrees about Y
+  for (int i = 0; i < 3000; i++) ahrs_update(&ahrs, kNoRotation, accel, kNoMagnetometer, 0.01f);
+  orientation_t o = ahrs_orientation(&ahrs);
+  TEST_ASSERT_FLOAT_WITHIN(1.0f, 0.0f, o.roll);
+  TEST_ASSERT_FLOAT_WITHIN(1.0f, 30.0f, o.pitch);
+}
+
+TEST_CASE("ahrs_integrates_gyroscope", "[ahrs]") {
+  ahrs_t ahrs;
+  ahrs_init(&ahrs, 0.1f);
+  vector3_t gyro = {0.0f, 0.0f, 90.0f};  // deg/s about Z
+  vector3_t accel = {0.0f, 0.0f, 1.0f};
+  for (int i = 0; i < 100; i++) ahrs_update(&ahrs, gyro, accel, kNoMagnetometer, 0.01f);
+  TEST_ASSERT_FLOAT_WITHIN(1.0f, 90.0f, ahrs_orientation(&ahrs).yaw);
+}
+
+TEST_CASE("ahrs_magnetometer_sets_yaw", "[ahrs]") {
+  ahrs_t ahrs;
+  ahrs_init(&ahrs, 0.1f);
+  vector3_t accel = {0.0f, 0.0f, 1.0f};
+  vector3_t mag = {0.0f, -0.3f, -0.4f};  // North along -Y
+  for (int i = 0; i < 5000; i++) ahrs_update(&ahrs, kNoRotation, accel, mag, 0.01f);
+  orientation_t o = ahrs_orientation(&ahrs);
+  TEST_ASSERT_FLOAT_WITHIN(1.0f, 90.0f, o.yaw);
+  TEST_ASSERT_FLOAT_WITHIN(1.0f, 0.0f, o.roll);
+}
+
+// What the upside-down LSM9DS0 reports for a body-frame vector: the inverse
+// of imu_to_body_frame(), which is its own inverse.
+static vector3_t body_to_sensor_frame(vector3_t body) {
+  vector3_t sensor = {body.x, -body.y, -body.z};
+  return sensor;
+}
+
+TEST_CASE("ahrs_tracks_roll_from_upside_down_sensor", "[ahrs]") {
+  // Roll the car to 30 degrees at 30 deg/s, then hold it there. All three
+  // sensors are rotated into the body frame the way telemetry_task does.
+  ahrs_t ahrs;
+  ahrs_init(&ahrs, 0.1f);
+  const float dt = 0.01f;
+  float roll = 0.0f;
+  for (int i = 0; i < 300; i++) {
+    float rate = i < 100 ? 30.0f : 0.0f;
+    roll += rate * dt;
+    float r = roll * (float)M_PI / 180.0f;
+    vector3_t gyro = {rate, 0.0f, 0.0f};
+    vector3_t accel = {0.0f, sinf(r), cosf(r)};
+    vector3_t mag = {0.3f, 0.4f * sinf(r), 0.4f * cosf(r)};
+    ahrs_update(&ahrs, imu_to_body_frame(body_to_sensor_frame(gyro)),
+                imu_to_body_frame(body_to_sensor_frame(accel)),
+                imu_to_body_frame(body_to_sensor_frame(mag)), dt);
+    // The estimate follows the motion instead of fighting it.
+    TEST_ASSERT_FLOAT_WITHIN(2.0f, roll, ahrs_orientation(&ahrs).roll);
+  }
+  orientation_t o = ahrs_orientation(&ahrs);
+  TEST_ASSERT_FLOAT_WITHIN(1.0f, 30.0f, o.roll);
+  TEST_ASSERT_FLOAT_WITHIN(1.0f, 0.0f, o.pitch);
+}
@@ -1,5 +1,9 @@
 #include "telemetry.hpp"
 #include "unity.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
 #include <math.h>
 
 TEST_CASE("speed", "[pcnt]") { TEST_ASSERT_GREATER_OR_EQUAL_FLOAT(0.0f, get_speed()); }
@@ -23,4 +27,39 @@ TEST_CASE("gyroscope", "[imu]") {
   TEST_ASSERT_FLOAT_WITHIN(5.0f, 0.0f, d.z);
 }
 
-TEST_CASE("distance", "[urm]") { TEST_ASSERT_GREATER_THAN(0, get_distance_ahead()); }
+TEST_CASE("distance", "[urm]") {
+  // Ranging is free-running: give it a few periods to report an echo.
+  vTaskDelay(pdMS_TO_TICKS(3 * CONFIG_TELEMETRY_URM_PERIOD_MS));
+  distance_reading_t reading = read_distance_ahead();
+  TEST_ASSERT_GREATER_THAN(0, reading.distance_cm);
+  TEST_ASSERT_LESS_THAN(3 * CONFIG_TELEMETRY_URM_PERIOD_MS, reading.age_ms);
+}
+
+TEST_CASE("distance_does_not_block", "[urm]") {
+  int64_t start = esp_timer_get_time();
+  get_distance_ahead();
+  TEST_ASSERT_LESS_THAN(1000, esp_timer_get_time() - start);
+}
+
+TEST_CASE("accelerometer_fifo", "[imu]") {
+  // 100 Hz into the FIFO: 100 ms gives about 10 samples in one burst.
+  imu_sample_t drain[32];
+  read_accelerometer_fifo(drain, 32);
+  vTaskDelay(pdMS_TO_TICKS(100));
+  imu_sample_t samples[32];
+  size_t n = read_accelerometer_fifo(samples, 32);
+  TEST_ASSERT_GREATER_OR_EQUAL(8, n);
+  for (size_t i = 1; i < n; i++) {
+    TEST_ASSERT_EQUAL_INT(10000, (int)(samples[i].timestamp_us - samples[i - 1].timestamp_us));
+  }
+}
+
+TEST_CASE("gyroscope_fifo", "[imu]") {
+  imu_sample_t drain[32];
+  read_gyroscope_fifo(drain, 32);
+  vTaskDelay(pdMS_TO_TICKS(100));
+  imu_sample_t samples[32];
+  size_t n = read_gyroscope_fifo(samples, 32);
+  TEST_ASSERT_GREATER_OR_EQUAL(8, n);
+  TEST_ASSERT_FLOAT_WITHIN(5.0f, 0.0f, samples[n - 1].value.x);
+}
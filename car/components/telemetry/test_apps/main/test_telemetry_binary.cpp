@@ -0,0 +1,125 @@
+#include "telemetry_binary.hpp"
+#include "unity.h"
+#include <string.h>
+
+static telemetry_packet_t make_packet(int64_t timestamp_us, float speed) {
+  telemetry_packet_t p = {};
+  p.timestamp_us = timestamp_us;
+  p.rssi = -65;
+  p.speed = speed;
+  p.accelerometer = {0.012f, -0.034f, 0.998f};
+  p.magnetometer = {0.1234f, -0.2f, 0.05f};
+  p.gyroscope = {1.25f, -0.5f, 120.0f};
+  p.distance_ahead = 87;
+  p.distance_ahead_age_ms = 23;
+  p.orientation = {12.34f, -5.67f, 179.99f};
+  return p;
+}
+
+TEST_CASE("binary_header_layout", "[telemetry_binary]") {
+  telemetry_binary_header_t header = {};
+  header.dropped = 0x04030201;
+  telemetry_packet_t p = make_packet(0x0807060504030201LL, 0.0f);
+
+  uint8_t buf[TELEMETRY_BINARY_HEADER_SIZE + TELEMETRY_BINARY_RECORD_MAX_SIZE];
+  size_t len = encode_telemetry_binary(&header, &p, 1, buf, sizeof(buf));
+  TEST_ASSERT_GREATER_THAN(TELEMETRY_BINARY_HEADER_SIZE, len);
+
+  TEST_ASSERT_EQUAL_HEX8(TELEMETRY_BINARY_VERSION, buf[0]);
+  TEST_ASSERT_EQUAL_HEX8(0, buf[1]);
+  const uint8_t count[] = {0x01, 0x00};
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(count, buf + 2, sizeof(count));
+  const uint8_t dropped[] = {0x01, 0x02, 0x03, 0x04};
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(dropped, buf + 4, sizeof(dropped));
+  const uint8_t timestamp[] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08};
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(timestamp, buf + 8, sizeof(timestamp));
+  // First record: timestamp delta 0, rssi -65 as zigzag varint 129.
+  TEST_ASSERT_EQUAL_HEX8(0x00, buf[16]);
+  TEST_ASSERT_EQUAL_HEX8(0x81, buf[17]);
+  TEST_ASSERT_EQUAL_HEX8(0x01, buf[18]);
+}
+
+TEST_CASE("binary_roundtrip", "[telemetry_binary]") {
+  telemetry_packet_t packets[3];
+  for (int i = 0; i < 3; i++) packets[i] = make_packet(1000000 + i * 100000, 1.5f * i);
+  packets[2].distance_ahead = -1;
+
+  telemetry_binary_header_t header = {};
+  header.flags = TELEMETRY_BINARY_FLAG_TRACE_CONTEXT;
+  header.dropped = 7;
+  for (int i = 0; i < 16; i++) header.trace_id[i] = 0xA0 + i;
+  for (int i = 0; i < 8; i++) header.span_id[i] = 0xB0 + i;
+  header.trace_flags = 0x01;
+
+  uint8_t buf[TELEMETRY_BINARY_HEADER_SIZE + TELEMETRY_BINARY_TRACE_CONTEXT_SIZE +
+              3 * TELEMETRY_BINARY_RECORD_MAX_SIZE];
+  size_t len = encode_telemetry_binary(&header, packets, 3, buf, sizeof(buf));
+  TEST_ASSERT_GREATER_THAN(0, len);
+
+  telemetry_binary_header_t decoded_header;
+  telemetry_packet_t decoded[3];
+  size_t count = 0;
+  TEST_ASSERT_TRUE(decode_telemetry_binary(buf, len, &decoded_header, decoded, 3, &count));
+  TEST_ASSERT_EQUAL(3, count);
+  TEST_ASSERT_EQUAL_UINT32(7, decoded_header.dropped);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(header.trace_id, decoded_header.trace_id, 16);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(header.span_id, decoded_header.span_id, 8);
+  TEST_ASSERT_EQUAL_HEX8(0x01, decoded_header.trace_flags);
+
+  for (int i = 0; i < 3; i++) {
+    TEST_ASSERT_EQUAL_INT(1000000 + i * 100000, (int)decoded[i].timestamp_us);
+    TEST_ASSERT_EQUAL_INT(-65, decoded[i].rssi);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 1.5f * i, decoded[i].speed);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.998f, decoded[i].accelerometer.z);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, 0.1234f, decoded[i].magnetometer.x);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 120.0f, decoded[i].gyroscope.z);
+    TEST_ASSERT_EQUAL_INT(23, decoded[i].distance_ahead_age_ms);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 179.99f, decoded[i].orientation.yaw);
+  }
+  TEST_ASSERT_EQUAL_INT(87, decoded[1].distance_ahead);
+  TEST_ASSERT_EQUAL_INT(-1, decoded[2].distance_ahead);
+}
+
+TEST_CASE("binary_deltas_are_compact", "[telemetry_binary]") {
+  // Unchanged fields cost one byte each after the first record.
+  telemetry_packet_t packets[10];
+  for (int i = 0; i < 10; i++) packets[i] = make_packet(i * 100000, 2.0f);
+
+  telemetry_binary_header_t header = {};
+  uint8_t buf[TELEMETRY_BINARY_HEADER_SIZE + 10 * TELEMETRY_BINARY_RECORD_MAX_SIZE];
+  size_t one = encode_telemetry_binary(&header, packets, 1, buf, sizeof(buf));
+  size_t ten = encode_telemetry_binary(&header, packets, 10, buf, sizeof(buf));
+  // 100 ms timestamp delta: 3 bytes, 16 unchanged fields: 1 byte each.
+  TEST_ASSERT_EQUAL(one + 9 * 19, ten);
+}
+
+TEST_CASE("binary_saturates_fixed_point", "[telemetry_binary]") {
+  telemetry_packet_t p = {};
+  p.gyroscope.x = 1000.0f;  // Beyond int16 at 0.01 deg/s
+  p.gyroscope.y = -1000.0f;
+
+  telemetry_binary_header_t header = {};
+  uint8_t buf[TELEMETRY_BINARY_HEADER_SIZE + TELEMETRY_BINARY_RECORD_MAX_SIZE];
+  size_t len = encode_telemetry_binary(&header, &p, 1, buf, sizeof(buf));
+
+  telemetry_packet_t decoded;
+  size_t count = 0;
+  TEST_ASSERT_TRUE(decode_telemetry_binary(buf, len, &header, &decoded, 1, &count));
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 327.67f, decoded.gyroscope.x);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, -327.68f, decoded.gyroscope.y);
+}
+
+TEST_CASE("binary_rejects_malformed", "[telemetry_binary]") {
+  telemetry_packet_t p = make_packet(0, 1.0f);
+  telemetry_binary_header_t header = {};
+  uint8_t buf[TELEMETRY_BINARY_HEADER_SIZE + TELEMETRY_BINARY_RECORD_MAX_SIZE];
+  size_t len = encode_telemetry_binary(&header, &p, 1, buf, sizeof(buf));
+
+  telemetry_packet_t decoded;
+  size_t count = 0;
+  TEST_ASSERT_FALSE(decode_telemetry_binary(buf, len - 1, &header, &decoded, 1, &count));
+  TEST_ASSERT_FALSE(decode_telemetry_binary(buf, len, &header, &decoded, 0, &count));
+  buf[0] = TELEMETRY_BINARY_VERSION + 1;
+  TEST_ASSERT_FALSE(decode_telemetry_binary(buf, len, &header, &decoded, 1, &count));
+  TEST_ASSERT_EQUAL(0, encode_telemetry_binary(&header, &p, 1, buf, TELEMETRY_BINARY_HEADER_SIZE));
+}
@@ -1,18 +1,20 @@
 #include "telemetry_types.hpp"
 #include "unity.h"
+#include <math.h>
+#include <string.h>
 
 TEST_CASE("json_schema_completeness", "[telemetry_json]") {
-  telemetry_packet_t p = {
-      "2024-01-15T10:30:00Z", -65, 2.5f, {0.01f, 0.02f, 1.0f}, {0.1f, -0.2f, 0.05f},
-      {0.5f, -0.3f, 0.1f},    100};
+  telemetry_packet_t p = {1500000, -65, 2.5f, {0.01f, 0.02f, 1.0f}, {0.1f, -0.2f, 0.05f},
+                          {0.5f, -0.3f, 0.1f}, 100};
 
   cJSON* j = convert_telemetry_packet_to_json(p);
   TEST_ASSERT_NOT_NULL(j);
 
-  TEST_ASSERT_TRUE(cJSON_IsString(cJSON_GetObjectItem(j, "timestamp")));
+  TEST_ASSERT_TRUE(cJSON_IsNumber(cJSON_GetObjectItem(j, "timestamp_us")));
   TEST_ASSERT_TRUE(cJSON_IsNumber(cJSON_GetObjectItem(j, "rssi")));
   TEST_ASSERT_TRUE(cJSON_IsNumber(cJSON_GetObjectItem(j, "speed")));
   TEST_ASSERT_TRUE(cJSON_IsNumber(cJSON_GetObjectItem(j, "distance_ahead")));
+  TEST_ASSERT_TRUE(cJSON_IsNumber(cJSON_GetObjectItem(j, "distance_ahead_age_ms")));
 
   const char* vector_keys[] = {"accelerometer", "magnetometer", "gyroscope"};
   for (int i = 0; i < 3; i++) {
@@ -23,17 +25,24 @@ TEST_CASE("json_schema_completeness", "[telemetry_json]") {
     TEST_ASSERT_TRUE(cJSON_IsNumber(cJSON_GetObjectItem(obj, "z")));
   }
 
+  const cJSON* orientation = cJSON_GetObjectItem(j, "orientation");
+  TEST_ASSERT_NOT_NULL(orientation);
+  TEST_ASSERT_TRUE(cJSON_IsNumber(cJSON_GetObjectItem(orientation, "roll")));
+  TEST_ASSERT_TRUE(cJSON_IsNumber(cJSON_GetObjectItem(orientation, "pitch")));
+  TEST_ASSERT_TRUE(cJSON_IsNumber(cJSON_GetObjectItem(orientation, "yaw")));
+
   cJSON_Delete(j);
 }
 
 TEST_CASE("json_value_roundtrip", "[telemetry_json]") {
-  telemetry_packet_t p = {"2024-01-15T10:30:00Z", -65, 0.0f, {1.0f, 2.0f, 3.0f}, {}, {}, 100};
+  // Past INT_MAX microseconds (~36 minutes of uptime) to catch truncation.
+  telemetry_packet_t p = {86400000000LL, -65, 0.0f, {1.0f, 2.0f, 3.0f}, {}, {}, 100};
 
   cJSON* j = convert_telemetry_packet_to_json(p);
   TEST_ASSERT_NOT_NULL(j);
 
-  TEST_ASSERT_EQUAL_STRING("2024-01-15T10:30:00Z",
-                           cJSON_GetStringValue(cJSON_GetObjectItem(j, "timestamp")));
+  TEST_ASSERT_TRUE(86400000000LL ==
+                   (int64_t)cJSON_GetNumberValue(cJSON_GetObjectItem(j, "timestamp_us")));
   TEST_ASSERT_EQUAL_INT(-65, (int)cJSON_GetNumberValue(cJSON_GetObjectItem(j, "rssi")));
   TEST_ASSERT_EQUAL_INT(100, (int)cJSON_GetNumberValue(cJSON_GetObjectItem(j, "distance_ahead")));
 
@@ -47,3 +56,81 @@ TEST_CASE("json_value_roundtrip", "[telemetry_json]") {
 
   cJSON_Delete(j);
 }
+
+TEST_CASE("json_batch", "[telemetry_json]") {
+  telemetry_packet_t packets[2] = {};
+  packets[0].rssi = -60;
+  packets[1].rssi = -61;
+
+  cJSON* j = convert_telemetry_batch_to_json(packets, 2, 3);
+  TEST_ASSERT_NOT_NULL(j);
+
+  const cJSON* array = cJSON_GetObjectItem(j, "packets");
+  TEST_ASSERT_TRUE(cJSON_IsArray(array));
+  TEST_ASSERT_EQUAL_INT(2, cJSON_GetArraySize(array));
+  TEST_ASSERT_EQUAL_INT(
+      -61, (int)cJSON_GetNumberValue(cJSON_GetObjectItem(cJSON_GetArrayItem(array, 1), "rssi")));
+  TEST_ASSERT_EQUAL_INT(3, (int)cJSON_GetNumberValue(cJSON_GetObjectItem(j, "dropped")));
+
+  cJSON_Delete(j);
+}
+
+static void assert_writer_matches_cjson(const telemetry_packet_t& p, const char* traceparent) {
+  cJSON* j = convert_telemetry_packet_to_json(p);
+  if (traceparent) cJSON_AddStringToObject(j, "traceparent", traceparent);
+  char* expected = cJSON_PrintUnformatted(j);
+
+  char buf[TELEMETRY_JSON_PACKET_MAX_SIZE + TELEMETRY_JSON_TRACE_CONTEXT_MAX_SIZE];
+  size_t len = write_telemetry_packet_json(p, traceparent, NULL, buf, sizeof(buf));
+  TEST_ASSERT_EQUAL(strlen(expected), len);
+  TEST_ASSERT_EQUAL_STRING(expected, buf);
+
+  cJSON_free(expected);
+  cJSON_Delete(j);
+}
+
+TEST_CASE("json_writer_matches_cjson", "[telemetry_json]") {
+  telemetry_packet_t p = {86400123456LL,
+                          -65,
+                          2.5f,
+                          {0.01f, 0.02f, 1.0f},
+                          {0.1f, -0.2f, 0.05f},
+                          {0.5f, -0.3f, 0.1f},
+                          100,
+                          12,
+                          {1.5f, -2.25f, 179.99f}};
+  assert_writer_matches_cjson(p, NULL);
+  assert_writer_matches_cjson(p, "00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01");
+
+  telemetry_packet_t odd = {};
+  odd.speed = -0.0f;
+  odd.accelerometer = {1e-30f, -3.4e38f, 123456789.0f};
+  odd.magnetometer = {0.333333343f, 2147483648.0f, -2147483648.0f};
+  odd.gyroscope = {NAN, INFINITY, -1.0f};
+  odd.distance_ahead = -1;
+  odd.distance_ahead_age_ms = -1;
+  assert_writer_matches_cjson(odd, NULL);
+}
+
+TEST_CASE("json_batch_writer_matches_cjson", "[telemetry_json]") {
+  telemetry_packet_t packets[2] = {};
+  packets[0].rssi = -60;
+  packets[0].speed = 0.1f;
+  packets[1].rssi = -61;
+  packets[1].orientation = {0.5f, -7.125f, 33.3f};
+
+  cJSON* j = convert_telemetry_batch_to_json(packets, 2, 4);
+  char* expected = cJSON_PrintUnformatted(j);
+  char buf[2 * TELEMETRY_JSON_PACKET_MAX_SIZE];
+  size_t len = write_telemetry_batch_json(packets, 2, 4, NULL, NULL, buf, sizeof(buf));
+  TEST_ASSERT_EQUAL(strlen(expected), len);
+  TEST_ASSERT_EQUAL_STRING(expected, buf);
+  cJSON_free(expected);
+  cJSON_Delete(j);
+}
+
+TEST_CASE("json_writer_reports_overflow", "[telemetry_json]") {
+  telemetry_packet_t p = {};
+  char buf[64];
+  TEST_ASSERT_EQUAL(0, write_telemetry_packet_json(p, NULL, NULL, buf, sizeof(buf)));
+}
@@ -0,0 +1,73 @@
+#include "telemetry_ring.hpp"
+#include "unity.h"
+
+static telemetry_packet_t packet_with_rssi(int rssi) {
+  telemetry_packet_t p = {};
+  p.rssi = rssi;
+  return p;
+}
+
+TEST_CASE("ring_capacity_rounds_up", "[telemetry_ring]") {
+  telemetry_ring_t* ring = telemetry_ring_create(5);
+  TEST_ASSERT_NOT_NULL(ring);
+  TEST_ASSERT_EQUAL(8, telemetry_ring_capacity(ring));
+  telemetry_ring_delete(ring);
+}
+
+TEST_CASE("ring_pops_in_order", "[telemetry_ring]") {
+  telemetry_ring_t* ring = telemetry_ring_create(4);
+  for (int i = 0; i < 3; i++) {
+    telemetry_packet_t p = packet_with_rssi(-50 - i);
+    TEST_ASSERT_TRUE(telemetry_ring_push(ring, &p));
+  }
+
+  telemetry_packet_t out[4] = {};
+  TEST_ASSERT_EQUAL(3, telemetry_ring_pop(ring, out, 4));
+  TEST_ASSERT_EQUAL_INT(-50, out[0].rssi);
+  TEST_ASSERT_EQUAL_INT(-51, out[1].rssi);
+  TEST_ASSERT_EQUAL_INT(-52, out[2].rssi);
+  TEST_ASSERT_EQUAL(0, telemetry_ring_pop(ring, out, 4));
+  telemetry_ring_delete(ring);
+}
+
+TEST_CASE("ring_pop_respects_max", "[telemetry_ring]") {
+  telemetry_ring_t* ring = telemetry_ring_create(4);
+  for (int i = 0; i < 3; i++) {
+    telemetry_packet_t p = packet_with_rssi(i);
+    telemetry_ring_push(ring, &p);
+  }
+
+  telemetry_packet_t out[2] = {};
+  TEST_ASSERT_EQUAL(2, telemetry_ring_pop(ring, out, 2));
+  TEST_ASSERT_EQUAL(1, telemetry_ring_pop(ring, out, 2));
+  TEST_ASSERT_EQUAL_INT(2, out[0].rssi);
+  telemetry_ring_delete(ring);
+}
+
+TEST_CASE("ring_full_drops_newest", "[telemetry_ring]") {
+  telemetry_ring_t* ring = telemetry_ring_create(4);
+  for (int i = 0; i < 6; i++) {
+    telemetry_packet_t p = packet_with_rssi(i);
+    TEST_ASSERT_EQUAL(i < 4, telemetry_ring_push(ring, &p));
+  }
+  TEST_ASSERT_EQUAL_UINT32(2, telemetry_ring_take_dropped(ring));
+  TEST_ASSERT_EQUAL_UINT32(0, telemetry_ring_take_dropped(ring));
+
+  telemetry_packet_t out[4] = {};
+  TEST_ASSERT_EQUAL(4, telemetry_ring_pop(ring, out, 4));
+  TEST_ASSERT_EQUAL_INT(0, out[0].rssi);
+  TEST_ASSERT_EQUAL_INT(3, out[3].rssi);
+  telemetry_ring_delete(ring);
+}
+
+TEST_CASE("ring_wraps_around", "[telemetry_ring]") {
+  telemetry_ring_t* ring = telemetry_ring_create(4);
+  telemetry_packet_t out[4] = {};
+  for (int i = 0; i < 10; i++) {
+    telemetry_packet_t p = packet_with_rssi(i);
+    TEST_ASSERT_TRUE(telemetry_ring_push(ring, &p));
+    TEST_ASSERT_EQUAL(1, telemetry_ring_pop(ring, out, 4));
+    TEST_ASSERT_EQUAL_INT(i, out[0].rssi);
+  }
+  telemetry_ring_delete(ring);
+}
@@ -0,0 +1,390 @@
+#include "export_buffer.hpp"
+#include "esp_event.h"
+#include "esp_heap_caps.h"
+#include "esp_http_client.h"
+#include "esp_log.h"
+#include "esp_netif_types.h"
+#include "esp_timer.h"
+#include "esp_wifi_types.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <new>
+
+#ifdef CONFIG_ESP_OPENTELEMETRY_EXPORT_BUFFER_ENABLED
+#include "opentelemetry/exporters/otlp/otlp_recordable.h"
+#include "opentelemetry/exporters/otlp/otlp_recordable_utils.h"
+#ifdef CONFIG_ESP_OPENTELEMETRY_METRICS_ENABLED
+#include "opentelemetry/exporters/otlp/otlp_metric_utils.h"
+#endif
+
+// clang-format off
+#include "opentelemetry/exporters/otlp/protobuf_include_prefix.h"
+#include "opentelemetry/proto/collector/trace/v1/trace_service.pb.h"
+#ifdef CONFIG_ESP_OPENTELEMETRY_METRICS_ENABLED
+#include "opentelemetry/proto/collector/metrics/v1/metrics_service.pb.h"
+#endif
+#include "opentelemetry/exporters/otlp/protobuf_include_suffix.h"
+// clang-format on
+#endif  // CONFIG_ESP_OPENTELEMETRY_EXPORT_BUFFER_ENABLED
+
+struct RecordHeader {
+  uint32_t size;
+  uint32_t signal;
+};
+
+struct export_buffer {
+  uint8_t* data;
+  size_t capacity;
+  // Records are stored back to back from head and wrap around the end of
+  // data; used counts headers and payloads.
+  size_t head;
+  size_t used;
+  size_t batches;
+  // Id of the record at head; every record gets the next one.
+  uint32_t head_id;
+  uint32_t dropped;
+  uint32_t drained;
+  SemaphoreHandle_t mutex;
+};
+
+static void ring_write(export_buffer_t* buffer, size_t offset, const void* src, size_t size) {
+  size_t first = std::min(size, buffer->capacity - offset);
+  memcpy(buffer->data + offset, src, first);
+  memcpy(buffer->data, static_cast<const uint8_t*>(src) + first, size - first);
+}
+
+static void ring_read(const export_buffer_t* buffer, size_t offset, void* dst, size_t size) {
+  size_t first = std::min(size, buffer->capacity - offset);
+  memcpy(dst, buffer->data + offset, first);
+  memcpy(static_cast<uint8_t*>(dst) + first, buffer->data, size - first);
+}
+
+// Caller holds the mutex.
+static void ring_remove_head(export_buffer_t* buffer) {
+  RecordHeader header;
+  ring_read(buffer, buffer->head, &header, sizeof(header));
+  size_t record = sizeof(header) + header.size;
+  buffer->head = (buffer->head + record) % buffer->capacity;
+  buffer->used -= record;
+  buffer->batches--;
+  buffer->head_id++;
+}
+
+export_buffer_t* export_buffer_create(size_t capacity) {
+  if (capacity < 4 * sizeof(RecordHeader)) return NULL;
+  void* mem = heap_caps_malloc(sizeof(export_buffer_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  if (!mem) return NULL;
+  export_buffer_t* buffer = new (mem) export_buffer_t();
+  buffer->data = static_cast<uint8_t*>(heap_caps_malloc_prefer(
+      capacity, 2, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT, MALLOC_CAP_DEFAULT));
+  buffer->mutex = xSemaphoreCreateMutex();
+  if (!buffer->data || !buffer->mutex) {
+    export_buffer_delete(buffer);
+    return NULL;
+  }
+  buffer->capacity = capacity;
+  return buffer;
+}
+
+void export_buffer_delete(export_buffer_t* buffer) {
+  if (!buffer) return;
+  if (buffer->mutex) vSemaphoreDelete(buffer->mutex);
+  heap_caps_free(buffer->data);
+  buffer->~export_buffer();
+  heap_caps_free(buffer);
+}
+
+bool export_buffer_push(export_buffer_t* buffer, export_signal_t signal, const void* data,
+                        size_t size) {
+  size_t record = sizeof(RecordHeader) + size;
+  xSemaphoreTake(buffer->mutex, portMAX_DELAY);
+  if (size > buffer->capacity / 4) {
+    buffer->dropped++;
+    xSemaphoreGive(buffer->mutex);
+    return false;
+  }
+  while (buffer->capacity - buffer->used < record) {
+    ring_remove_head(buffer);
+    buffer->dropped++;
+  }
+  RecordHeader header = {static_cast<uint32_t>(size), static_cast<uint32_t>(signal)};
+  size_t tail = (buffer->head + buffer->used) % buffer->capacity;
+  ring_write(buffer, tail, &header, sizeof(header));
+  ring_write(buffer, (tail + sizeof(header)) % buffer->capacity, data, size);
+  buffer->used += record;
+  buffer->batches++;
+  xSemaphoreGive(buffer->mutex);
+  return true;
+}
+
+bool export_buffer_peek(export_buffer_t* buffer, export_signal_t* signal, std::string* out,
+                        uint32_t* id) {
+  xSemaphoreTake(buffer->mutex, portMAX_DELAY);
+  if (buffer->batches == 0) {
+    xSemaphoreGive(buffer->mutex);
+    return false;
+  }
+  RecordHeader header;
+  ring_read(buffer, buffer->head, &header, sizeof(header));
+  out->resize(header.size);
+  ring_read(buffer, (buffer->head + sizeof(header)) % buffer->capacity, &(*out)[0], header.size);
+  *signal = static_cast<export_signal_t>(header.signal);
+  *id = buffer->head_id;
+  xSemaphoreGive(buffer->mutex);
+  return true;
+}
+
+void export_buffer_pop(export_buffer_t* buffer, uint32_t id) {
+  xSemaphoreTake(buffer->mutex, portMAX_DELAY);
+  if (buffer->batches > 0 && buffer->head_id == id) {
+    ring_remove_head(buffer);
+    buffer->drained++;
+  }
+  xSemaphoreGive(buffer->mutex);
+}
+
+export_buffer_stats_t export_buffer_stats(export_buffer_t* buffer) {
+  export_buffer_stats_t stats = {};
+  if (!buffer) return stats;
+  xSemaphoreTake(buffer->mutex, portMAX_DELAY);
+  stats.capacity = buffer->capacity;
+  stats.used = buffer->used;
+  stats.batches = buffer->batches;
+  stats.dropped = buffer->dropped;
+  stats.drained = buffer->drained;
+  xSemaphoreGive(buffer->mutex);
+  return stats;
+}
+
+#ifdef CONFIG_ESP_OPENTELEMETRY_EXPORT_BUFFER_ENABLED
+static const char* TAG = "export_buffer";
+
+namespace trace_sdk = opentelemetry::sdk::trace;
+namespace otlp = opentelemetry::exporter::otlp;
+using opentelemetry::sdk::common::ExportResult;
+
+enum class PostResult { kSent, kRejected, kFailed };
+
+// One keep-alive connection to an OTLP/HTTP endpoint, plus the exponential
+// backoff of the exporter that owns it.
+class OtlpPoster {
+ public:
+  explicit OtlpPoster(const std::string& url) : url_(url) {
+    esp_http_client_config_t config = {};
+    config.url = url_.c_str();
+    config.method = HTTP_METHOD_POST;
+    config.timeout_ms = kTimeoutMs;
+    config.keep_alive_enable = true;
+    client_ = esp_http_client_init(&config);
+    if (client_) esp_http_client_set_header(client_, "Content-Type", "application/x-protobuf");
+  }
+
+  ~OtlpPoster() {
+    if (client_) esp_http_client_cleanup(client_);
+  }
+
+  PostResult Post(const std::string& body) {
+    if (!client_) return PostResult::kFailed;
+    esp_http_client_set_post_field(client_, body.data(), static_cast<int>(body.size()));
+    esp_err_t err = esp_http_client_perform(client_);
+    int status = err == ESP_OK ? esp_http_client_get_status_code(client_) : 0;
+    if (status >= 200 && status < 300) return PostResult::kSent;
+    // Reconnect on the next post rather than reuse a broken connection.
+    esp_http_client_close(client_);
+    // The collector will not accept this batch however often it is retried.
+    if (status >= 400 && status < 500 && status != 408 && status != 429) {
+      ESP_LOGW(TAG, "%s rejected a batch with HTTP %d", url_.c_str(), status);
+      return PostResult::kRejected;
+    }
+    return PostResult::kFailed;
+  }
+
+  // Doubles the wait before the next post after each consecutive failure.
+  bool BackingOff(int64_t now) const { return now < retry_at_us_; }
+  void Succeeded() { failures_ = 0; }
+  void Failed(int64_t now) {
+    int64_t delay_ms = CONFIG_ESP_OPENTELEMETRY_EXPORT_BACKOFF_INITIAL_MS;
+    for (uint32_t i = 0; i < failures_ && delay_ms < CONFIG_ESP_OPENTELEMETRY_EXPORT_BACKOFF_MAX_MS;
+         i++) {
+      delay_ms *= 2;
+    }
+    delay_ms = std::min<int64_t>(delay_ms, CONFIG_ESP_OPENTELEMETRY_EXPORT_BACKOFF_MAX_MS);
+    failures_++;
+    retry_at_us_ = now + delay_ms * 1000;
+    ESP_LOGW(TAG, "Export to %s failed %u time(s), buffering for %lld ms", url_.c_str(),
+             static_cast<unsigned>(failures_), static_cast<long long>(delay_ms));
+  }
+
+ private:
+  // Short enough that an outage the IP events have not caught up with yet
+  // costs the export thread seconds, not the SDK's 10 s default.
+  static constexpr int kTimeoutMs = 2000;
+
+  std::string url_;
+  esp_http_client_handle_t client_ = nullptr;
+  uint32_t failures_ = 0;
+  int64_t retry_at_us_ = 0;
+};
+
+namespace {
+
+static export_buffer_t* s_buffer = nullptr;
+static std::string s_urls[2];
+// app_main waits for an IP address before setting up telemetry export.
+static std::atomic<bool> s_online{true};
+static TaskHandle_t s_drain_task = nullptr;
+
+static constexpr uint32_t kDrainStackSize = 8192;
+
+static void drain_task(void*) {
+  std::unique_ptr<OtlpPoster> posters[2];
+  std::string body;
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    export_signal_t signal;
+    uint32_t id;
+    while (s_online.load(std::memory_order_relaxed) &&
+           export_buffer_peek(s_buffer, &signal, &body, &id)) {
+      if (!posters[signal]) posters[signal].reset(new OtlpPoster(s_urls[signal]));
+      // Leave the batch in place; the next IP_EVENT_STA_GOT_IP or successful
+      // export wakes this task again.
+      if (posters[signal]->Post(body) == PostResult::kFailed) break;
+      export_buffer_pop(s_buffer, id);
+      // Rate limited, so the backlog does not compete with live exports and
+      // the video stream on the freshly reconnected link.
+      vTaskDelay(pdMS_TO_TICKS(CONFIG_ESP_OPENTELEMETRY_EXPORT_BUFFER_DRAIN_INTERVAL_MS));
+    }
+    std::string().swap(body);
+  }
+}
+
+static void on_connectivity_event(void*, esp_event_base_t event_base, int32_t event_id, void*) {
+  if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
+    s_online.store(true, std::memory_order_relaxed);
+    xTaskNotifyGive(s_drain_task);
+  } else {
+    s_online.store(false, std::memory_order_relaxed);
+  }
+}
+
+static void wake_drain_task() {
+  if (s_drain_task && export_buffer_stats(s_buffer).batches > 0) xTaskNotifyGive(s_drain_task);
+}
+
+// Posts a batch unless the station is offline or the poster is backing off,
+// and buffers it when it is not sent.
+static ExportResult post_or_buffer(OtlpPoster& poster, export_signal_t signal,
+                                   const std::string& body) {
+  int64_t now = esp_timer_get_time();
+  if (s_online.load(std::memory_order_relaxed) && !poster.BackingOff(now)) {
+    PostResult result = poster.Post(body);
+    if (result == PostResult::kSent) {
+      poster.Succeeded();
+      wake_drain_task();
+      return ExportResult::kSuccess;
+    }
+    if (result == PostResult::kRejected) return ExportResult::kFailure;
+    poster.Failed(now);
+  }
+  if (!s_buffer || !export_buffer_push(s_buffer, signal, body.data(), body.size())) {
+    return ExportResult::kFailure;
+  }
+  return ExportResult::kSuccess;
+}
+
+}  // namespace
+
+bool offline_export_init(export_signal_t signal, const std::string& url) {
+  s_urls[signal] = url;
+  if (s_buffer) return true;
+
+  export_buffer_t* buffer =
+      export_buffer_create(CONFIG_ESP_OPENTELEMETRY_EXPORT_BUFFER_SIZE_KB * 1024);
+  StackType_t* stack = static_cast<StackType_t*>(
+      heap_caps_malloc(kDrainStackSize, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+  StaticTask_t* tcb = static_cast<StaticTask_t*>(
+      heap_caps_malloc(sizeof(StaticTask_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+  if (!buffer || !stack || !tcb) {
+    ESP_LOGE(TAG, "Failed to allocate the %u KB export buffer",
+             static_cast<unsigned>(CONFIG_ESP_OPENTELEMETRY_EXPORT_BUFFER_SIZE_KB));
+    export_buffer_delete(buffer);
+    heap_caps_free(stack);
+    heap_caps_free(tcb);
+    return false;
+  }
+  s_buffer = buffer;
+  s_drain_task = xTaskCreateStaticPinnedToCore(drain_task, "otlp_drain",
+                                               kDrainStackSize / sizeof(StackType_t), nullptr, 1,
+                                               stack, tcb, tskNO_AFFINITY);
+
+  ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP,
+                                             &on_connectivity_event, nullptr));
+  ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_LOST_IP,
+                                             &on_connectivity_event, nullptr));
+  ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED,
+                                             &on_connectivity_event, nullptr));
+  return true;
+}
+
+export_buffer_stats_t offline_export_stats() { return export_buffer_stats(s_buffer); }
+
+BufferedSpanExporter::BufferedSpanExporter(const std::string& url)
+    : poster_(new OtlpPoster(url)) {}
+
+BufferedSpanExporter::~BufferedSpanExporter() = default;
+
+std::unique_ptr<trace_sdk::Recordable> BufferedSpanExporter::MakeRecordable() noexcept {
+  return std::unique_ptr<trace_sdk::Recordable>(new otlp::OtlpRecordable);
+}
+
+ExportResult BufferedSpanExporter::Export(
+    const opentelemetry::nostd::span<std::unique_ptr<trace_sdk::Recordable>>& spans) noexcept {
+  if (spans.empty()) return ExportResult::kSuccess;
+  std::string body;
+  {
+    opentelemetry::proto::collector::trace::v1::ExportTraceServiceRequest request;
+    otlp::OtlpRecordableUtils::PopulateRequest(spans, &request);
+    if (!request.SerializeToString(&body)) return ExportResult::kFailure;
+  }
+  return post_or_buffer(*poster_, EXPORT_SIGNAL_TRACES, body);
+}
+
+bool BufferedSpanExporter::ForceFlush(std::chrono::microseconds) noexcept { return true; }
+
+bool BufferedSpanExporter::Shutdown(std::chrono::microseconds) noexcept { return true; }
+
+#ifdef CONFIG_ESP_OPENTELEMETRY_METRICS_ENABLED
+BufferedMetricExporter::BufferedMetricExporter(const std::string& url)
+    : poster_(new OtlpPoster(url)) {}
+
+BufferedMetricExporter::~BufferedMetricExporter() = default;
+
+ExportResult BufferedMetricExporter::Export(
+    const opentelemetry::sdk::metrics::ResourceMetrics& data) noexcept {
+  std::string body;
+  {
+    opentelemetry::proto::collector::metrics::v1::ExportMetricsServiceRequest request;
+    otlp::OtlpMetricUtils::PopulateRequest(data, &request);
+    if (!request.SerializeToString(&body)) return ExportResult::kFailure;
+  }
+  return post_or_buffer(*poster_, EXPORT_SIGNAL_METRICS, body);
+}
+
+// Cumulative points stay correct when a buffered batch arrives late or
+// after a newer one, as the OTLP exporter's default does.
+opentelemetry::sdk::metrics::AggregationTemporality
+BufferedMetricExporter::GetAggregationTemporality(
+    opentelemetry::sdk::metrics::InstrumentType) const noexcept {
+  return opentelemetry::sdk::metrics::AggregationTemporality::kCumulative;
+}
+
+bool BufferedMetricExporter::ForceFlush(std::chrono::microseconds) noexcept { return true; }
+
+bool BufferedMetricExporter::Shutdown(std::chrono::microseconds) noexcept { return true; }
+#endif  // CONFIG_ESP_OPENTELEMETRY_METRICS_ENABLED
+#endif  // CONFIG_ESP_OPENTELEMETRY_EXPORT_BUFFER_ENABLED
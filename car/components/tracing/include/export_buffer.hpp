@@ -0,0 +1,106 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "sdkconfig.h"
+
+#include "opentelemetry/sdk/common/exporter_utils.h"
+#include "opentelemetry/sdk/trace/exporter.h"
+#include "opentelemetry/sdk/trace/recordable.h"
+#if defined(CONFIG_ESP_OPENTELEMETRY_EXPORT_BUFFER_ENABLED) && \
+    defined(CONFIG_ESP_OPENTELEMETRY_METRICS_ENABLED)
+#include "opentelemetry/sdk/metrics/push_metric_exporter.h"
+#endif
+
+// Bounded FIFO of serialized OTLP request bodies in PSRAM. Batches that
+// could not be exported while the car was out of Wi-Fi range wait here and
+// are posted again once it reconnects. When full, the oldest batches are
+// evicted and counted in dropped.
+typedef enum {
+  EXPORT_SIGNAL_TRACES = 0,
+  EXPORT_SIGNAL_METRICS = 1,
+} export_signal_t;
+
+typedef struct export_buffer export_buffer_t;
+
+typedef struct {
+  size_t capacity;
+  size_t used;
+  size_t batches;
+  uint32_t dropped;
+  uint32_t drained;
+} export_buffer_stats_t;
+
+export_buffer_t* export_buffer_create(size_t capacity);
+void export_buffer_delete(export_buffer_t* buffer);
+
+// Appends a batch, evicting the oldest ones to make room. Returns false
+// (and counts the batch as dropped) if it is larger than a quarter of the
+// capacity, so one batch never flushes out the rest.
+bool export_buffer_push(export_buffer_t* buffer, export_signal_t signal, const void* data,
+                        size_t size);
+// Copies out the oldest batch without removing it. id identifies it for
+// export_buffer_pop(). Returns false if the buffer is empty.
+bool export_buffer_peek(export_buffer_t* buffer, export_signal_t* signal, std::string* out,
+                        uint32_t* id);
+// Removes the oldest batch after it was sent, unless it was evicted in the
+// meantime, and counts it as drained.
+void export_buffer_pop(export_buffer_t* buffer, uint32_t id);
+export_buffer_stats_t export_buffer_stats(export_buffer_t* buffer);
+
+#ifdef CONFIG_ESP_OPENTELEMETRY_EXPORT_BUFFER_ENABLED
+// Creates the shared buffer on the first call, follows the station's IP
+// state and starts the task that drains the buffer, one batch per
+// CONFIG_ESP_OPENTELEMETRY_EXPORT_BUFFER_DRAIN_INTERVAL_MS, after
+// IP_EVENT_STA_GOT_IP. url is where the drain task posts signal's batches.
+bool offline_export_init(export_signal_t signal, const std::string& url);
+export_buffer_stats_t offline_export_stats();
+
+class OtlpPoster;
+
+// OTLP/HTTP protobuf exporters that post with esp_http_client while the
+// station has an IP address. When it has none, after a failed post and
+// during the exponential backoff that follows one, the serialized batch goes
+// into the shared buffer instead, without waiting for an HTTP timeout.
+class BufferedSpanExporter : public opentelemetry::sdk::trace::SpanExporter {
+ public:
+  explicit BufferedSpanExporter(const std::string& url);
+  ~BufferedSpanExporter() override;
+
+  std::unique_ptr<opentelemetry::sdk::trace::Recordable> MakeRecordable() noexcept override;
+  opentelemetry::sdk::common::ExportResult Export(
+      const opentelemetry::nostd::span<std::unique_ptr<opentelemetry::sdk::trace::Recordable>>&
+          spans) noexcept override;
+  bool ForceFlush(std::chrono::microseconds timeout =
+                      (std::chrono::microseconds::max)()) noexcept override;
+  bool Shutdown(std::chrono::microseconds timeout =
+                    (std::chrono::microseconds::max)()) noexcept override;
+
+ private:
+  std::unique_ptr<OtlpPoster> poster_;
+};
+
+#ifdef CONFIG_ESP_OPENTELEMETRY_METRICS_ENABLED
+class BufferedMetricExporter : public opentelemetry::sdk::metrics::PushMetricExporter {
+ public:
+  explicit BufferedMetricExporter(const std::string& url);
+  ~BufferedMetricExporter() override;
+
+  opentelemetry::sdk::common::ExportResult Export(
+      const opentelemetry::sdk::metrics::ResourceMetrics& data) noexcept override;
+  opentelemetry::sdk::metrics::AggregationTemporality GetAggregationTemporality(
+      opentelemetry::sdk::metrics::InstrumentType instrument_type) const noexcept override;
+  bool ForceFlush(std::chrono::microseconds timeout =
+                      (std::chrono::microseconds::max)()) noexcept override;
+  bool Shutdown(std::chrono::microseconds timeout =
+                    (std::chrono::microseconds::max)()) noexcept override;
+
+ private:
+  std::unique_ptr<OtlpPoster> poster_;
+};
+#endif  // CONFIG_ESP_OPENTELEMETRY_METRICS_ENABLED
+#endif  // CONFIG_ESP_OPENTELEMETRY_EXPORT_BUFFER_ENABLED
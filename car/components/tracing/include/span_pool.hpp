@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "opentelemetry/sdk/common/exporter_utils.h"
+#include "opentelemetry/sdk/trace/exporter.h"
+#include "opentelemetry/sdk/trace/recordable.h"
+
+// Span records in fixed slots preallocated in PSRAM. A record keeps the
+// span's name, status description and attributes in a small arena inside its
+// slot instead of heap-allocated containers, so a span waiting in the batch
+// queue holds no heap memory. When every slot is in use a record is
+// allocated from the heap instead and counted in exhausted; attributes that
+// do not fit (or are arrays) are dropped and counted in attributes_dropped.
+typedef struct {
+  size_t capacity;
+  size_t in_use;
+  size_t peak;
+  uint32_t exhausted;
+  uint32_t attributes_dropped;
+} span_pool_stats_t;
+
+// Allocates capacity slots on the first call. Returns false if the slots
+// could not be allocated; records then always come from the heap.
+bool span_pool_init(size_t capacity);
+span_pool_stats_t span_pool_stats();
+
+// Hands out pooled records and, at export time on the exporting thread,
+// replays each into the wrapped exporter's own recordable (the OTLP protobuf
+// span), returning the slot to the pool before the batch goes out. Must be
+// the exporter of every processor the records are handed to.
+class PooledSpanExporter : public opentelemetry::sdk::trace::SpanExporter {
+ public:
+  explicit PooledSpanExporter(std::unique_ptr<opentelemetry::sdk::trace::SpanExporter> exporter);
+
+  std::unique_ptr<opentelemetry::sdk::trace::Recordable> MakeRecordable() noexcept override;
+  opentelemetry::sdk::common::ExportResult Export(
+      const opentelemetry::nostd::span<std::unique_ptr<opentelemetry::sdk::trace::Recordable>>&
+          spans) noexcept override;
+  bool ForceFlush(std::chrono::microseconds timeout =
+                      (std::chrono::microseconds::max)()) noexcept override;
+  bool Shutdown(std::chrono::microseconds timeout =
+                    (std::chrono::microseconds::max)()) noexcept override;
+
+ private:
+  std::unique_ptr<opentelemetry::sdk::trace::SpanExporter> exporter_;
+  // Reused between exports; only touched by the exporting thread.
+  std::vector<std::unique_ptr<opentelemetry::sdk::trace::Recordable>> batch_;
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stddef.h>
+#include "opentelemetry/context/context.h"
+#include <cJSON.h>
+
+// W3C trace context propagation through the global propagator. Depends on the
+// OpenTelemetry API headers and cJSON only, so host builds can compile
+// trace_propagation.cpp on its own.
+void tracing_inject(cJSON& obj);
+// Writes the current trace context into caller-provided buffers instead of a
+// cJSON tree. A header that is absent or does not fit is left empty.
+void tracing_inject(char* traceparent, size_t traceparent_size, char* tracestate,
+                    size_t tracestate_size);
+opentelemetry::context::Context tracing_extract(const cJSON& obj);
+opentelemetry::context::Context tracing_extract(const char* traceparent, const char* tracestate);
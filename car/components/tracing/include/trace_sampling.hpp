@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "freertos/FreeRTOS.h"
+#include "opentelemetry/sdk/trace/processor.h"
+#include "opentelemetry/sdk/trace/recordable.h"
+#include "opentelemetry/sdk/trace/sampler.h"
+#include "opentelemetry/sdk/trace/samplers/trace_id_ratio.h"
+
+// Head sampler for the car's spans, evaluated in this order:
+// - a span whose parent was not sampled is not sampled either, so a trace is
+//   kept or dropped as a whole;
+// - a span with a rate limit (see AddRateLimit) is sampled at most per_second
+//   times a second, with a burst of one second's worth;
+// - a root span is sampled with probability ratio (by trace id);
+// - anything else is sampled.
+// A span that is not sampled is dropped, or with record_unsampled recorded
+// without the sampled flag so TailSamplingProcessor can still keep it.
+class RateLimitingSampler : public opentelemetry::sdk::trace::Sampler {
+ public:
+  using Clock = int64_t (*)();
+
+  // now_us defaults to esp_timer_get_time.
+  RateLimitingSampler(double ratio, bool record_unsampled, Clock now_us = nullptr);
+
+  // Returns false when the name is empty or the table is full.
+  bool AddRateLimit(const char* name, uint32_t per_second);
+  // Adds every "name=per_second" entry of a comma-separated list, e.g.
+  // "ws.stream.send=2,ws.telemetry.send=1". Returns the number added;
+  // malformed entries are skipped.
+  size_t AddRateLimits(const char* spec);
+
+  opentelemetry::sdk::trace::SamplingResult ShouldSample(
+      const opentelemetry::trace::SpanContext& parent_context,
+      opentelemetry::trace::TraceId trace_id, opentelemetry::nostd::string_view name,
+      opentelemetry::trace::SpanKind span_kind,
+      const opentelemetry::common::KeyValueIterable& attributes,
+      const opentelemetry::trace::SpanContextKeyValueIterable& links) noexcept override;
+
+  opentelemetry::nostd::string_view GetDescription() const noexcept override {
+    return "RateLimitingSampler";
+  }
+
+ private:
+  static constexpr size_t kMaxRateLimits = 8;
+
+  struct RateLimit {
+    std::string name;
+    int64_t cost_us;
+    int64_t credit_us;
+    int64_t last_us;
+  };
+
+  bool TakeToken(opentelemetry::nostd::string_view name);
+
+  opentelemetry::sdk::trace::TraceIdRatioBasedSampler ratio_sampler_;
+  opentelemetry::sdk::trace::Decision unsampled_;
+  Clock now_us_;
+  RateLimit rate_limits_[kMaxRateLimits];
+  size_t rate_limit_count_ = 0;
+  portMUX_TYPE lock_ = portMUX_INITIALIZER_UNLOCKED;
+};
+
+// Tail sampling in front of the exporting processor. Sampled spans pass
+// straight through. A span recorded without the sampled flag is kept anyway
+// when it ends with an error status or lasted at least slow_threshold;
+// otherwise it waits in a ring of buffer_size (at most 32) spans. Keeping a
+// span also keeps its buffered descendants, which usually ended before it, so
+// a slow command or frame is exported with the spans that explain it. The
+// oldest buffered span is discarded to make room. The recordables it wraps
+// around the next processor's come from open_spans slots in PSRAM, allocated
+// by the first processor, rather than from the heap.
+class TailSamplingProcessor : public opentelemetry::sdk::trace::SpanProcessor {
+ public:
+  TailSamplingProcessor(std::unique_ptr<opentelemetry::sdk::trace::SpanProcessor> next,
+                        std::chrono::microseconds slow_threshold, size_t buffer_size,
+                        size_t open_spans);
+
+  std::unique_ptr<opentelemetry::sdk::trace::Recordable> MakeRecordable() noexcept override;
+  void OnStart(opentelemetry::sdk::trace::Recordable& span,
+               const opentelemetry::trace::SpanContext& parent_context) noexcept override;
+  void OnEnd(std::unique_ptr<opentelemetry::sdk::trace::Recordable>&& span) noexcept override;
+  bool ForceFlush(std::chrono::microseconds timeout =
+                      (std::chrono::microseconds::max)()) noexcept override;
+  bool Shutdown(std::chrono::microseconds timeout =
+                    (std::chrono::microseconds::max)()) noexcept override;
+
+  // Unsampled spans kept by the tail rules, and discarded from the ring.
+  uint32_t kept() const { return kept_.load(std::memory_order_relaxed); }
+  uint32_t discarded() const { return discarded_.load(std::memory_order_relaxed); }
+  // Wrappers allocated from the heap because every slot was in use, across
+  // all processors.
+  static uint32_t records_exhausted();
+
+ private:
+  struct Buffered {
+    opentelemetry::trace::SpanId span_id;
+    opentelemetry::trace::SpanId parent_span_id;
+    std::unique_ptr<opentelemetry::sdk::trace::Recordable> span;
+  };
+
+  std::unique_ptr<opentelemetry::sdk::trace::SpanProcessor> next_;
+  std::chrono::nanoseconds slow_threshold_;
+  std::vector<Buffered> buffer_;
+  size_t buffer_next_ = 0;
+  std::atomic<uint32_t> kept_{0};
+  std::atomic<uint32_t> discarded_{0};
+  portMUX_TYPE lock_ = portMUX_INITIALIZER_UNLOCKED;
+};
@@ -7,6 +7,7 @@
 #ifdef CONFIG_ESP_OPENTELEMETRY_METRICS_ENABLED
 
 #include "esp_http_client_transport.hpp"
+#include "export_buffer.hpp"
 #include "opentelemetry/nostd/shared_ptr.h"
 #include "opentelemetry/nostd/variant.h"
 #include "opentelemetry/exporters/otlp/otlp_http_metric_exporter_factory.h"
@@ -19,6 +20,7 @@
 #include "opentelemetry/sdk/metrics/view/view_registry_factory.h"
 #include "opentelemetry/sdk/resource/resource.h"
 #include <chrono>
+#include <memory>
 #include <string>
 
 #endif  // CONFIG_ESP_OPENTELEMETRY_METRICS_ENABLED
@@ -45,10 +47,18 @@ void metrics_setup() {
   if (*metrics_base == '\0') metrics_base = CONFIG_ESP_OPENTELEMETRY_EXPORTER_OTLP_ENDPOINT;
   std::string url = std::string(metrics_base) + "/v1/metrics";
 
-  opentelemetry::exporter::otlp::OtlpHttpMetricExporterOptions opts;
-  opts.url = url;
-  auto exporter = opentelemetry::exporter::otlp::OtlpHttpMetricExporterFactory::Create(
-      opts, esp_opentelemetry::MakeEspHttpClient());
+  std::unique_ptr<opentelemetry::sdk::metrics::PushMetricExporter> exporter;
+#ifdef CONFIG_ESP_OPENTELEMETRY_EXPORT_BUFFER_ENABLED
+  if (offline_export_init(EXPORT_SIGNAL_METRICS, url)) {
+    exporter.reset(new BufferedMetricExporter(url));
+  }
+#endif
+  if (!exporter) {
+    opentelemetry::exporter::otlp::OtlpHttpMetricExporterOptions opts;
+    opts.url = url;
+    exporter = opentelemetry::exporter::otlp::OtlpHttpMetricExporterFactory::Create(
+        opts, esp_opentelemetry::MakeEspHttpClient());
+  }
 
   opentelemetry::sdk::metrics::PeriodicExportingMetricReaderOptions reader_opts;
   reader_opts.export_interval_millis =
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "freertos/FreeRTOS.h"
+
+// Fixed-size slots preallocated in PSRAM for the objects of one class, handed
+// out by that class's operator new and delete. Before Init, and when every
+// slot is in use, objects are allocated from the heap instead and counted in
+// exhausted. Objects are never larger than a slot.
+class SlotPool {
+ public:
+  struct Stats {
+    size_t capacity;
+    size_t in_use;
+    size_t peak;
+    uint32_t exhausted;
+  };
+
+  // Allocates capacity slots large enough for object_size bytes on the first
+  // call. Returns false if capacity is 0 or over UINT16_MAX, or if the slots
+  // could not be allocated.
+  bool Init(size_t capacity, size_t object_size);
+  bool initialized() const { return slots_ != nullptr; }
+  size_t slot_size() const { return slot_size_; }
+
+  void* Allocate(size_t size) noexcept;
+  void Free(void* p) noexcept;
+  Stats stats();
+
+ private:
+  uint8_t* slots_ = nullptr;
+  size_t slot_size_ = 0;
+  size_t capacity_ = 0;
+  uint16_t* free_ = nullptr;  // stack of free slot indices
+  size_t free_count_ = 0;
+  size_t peak_ = 0;
+  portMUX_TYPE lock_ = portMUX_INITIALIZER_UNLOCKED;
+  std::atomic<uint32_t> exhausted_{0};
+};
@@ -0,0 +1,68 @@
+#include "slot_pool.hpp"
+#include "esp_heap_caps.h"
+
+bool SlotPool::Init(size_t capacity, size_t object_size) {
+  if (slots_) return true;
+  if (capacity == 0 || capacity > UINT16_MAX) return false;
+  size_t slot_size = (object_size + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) *
+                     alignof(std::max_align_t);
+  uint8_t* slots = static_cast<uint8_t*>(
+      heap_caps_aligned_alloc(alignof(std::max_align_t), capacity * slot_size,
+                              MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+  uint16_t* free_list = static_cast<uint16_t*>(
+      heap_caps_malloc(capacity * sizeof(uint16_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+  if (!slots || !free_list) {
+    heap_caps_free(slots);
+    heap_caps_free(free_list);
+    return false;
+  }
+  for (size_t i = 0; i < capacity; i++) {
+    free_list[i] = static_cast<uint16_t>(capacity - 1 - i);
+  }
+  taskENTER_CRITICAL(&lock_);
+  free_ = free_list;
+  free_count_ = capacity;
+  capacity_ = capacity;
+  slot_size_ = slot_size;
+  slots_ = slots;
+  taskEXIT_CRITICAL(&lock_);
+  return true;
+}
+
+void* SlotPool::Allocate(size_t size) noexcept {
+  void* p = nullptr;
+  if (slots_ && size <= slot_size_) {
+    taskENTER_CRITICAL(&lock_);
+    if (free_count_ > 0) {
+      p = slots_ + static_cast<size_t>(free_[--free_count_]) * slot_size_;
+      size_t in_use = capacity_ - free_count_;
+      if (in_use > peak_) peak_ = in_use;
+    }
+    taskEXIT_CRITICAL(&lock_);
+    if (p) return p;
+  }
+  exhausted_.fetch_add(1, std::memory_order_relaxed);
+  return heap_caps_malloc_prefer(size, 2, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT, MALLOC_CAP_DEFAULT);
+}
+
+void SlotPool::Free(void* p) noexcept {
+  uint8_t* slot = static_cast<uint8_t*>(p);
+  if (slots_ && slot >= slots_ && slot < slots_ + capacity_ * slot_size_) {
+    taskENTER_CRITICAL(&lock_);
+    free_[free_count_++] = static_cast<uint16_t>((slot - slots_) / slot_size_);
+    taskEXIT_CRITICAL(&lock_);
+    return;
+  }
+  heap_caps_free(p);
+}
+
+SlotPool::Stats SlotPool::stats() {
+  Stats stats = {};
+  taskENTER_CRITICAL(&lock_);
+  stats.capacity = capacity_;
+  stats.in_use = capacity_ - free_count_;
+  stats.peak = peak_;
+  taskEXIT_CRITICAL(&lock_);
+  stats.exhausted = exhausted_.load(std::memory_order_relaxed);
+  return stats;
+}
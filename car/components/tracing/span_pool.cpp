@@ -0,0 +1,288 @@
+#include "span_pool.hpp"
+#include "slot_pool.hpp"
+#include "esp_log.h"
+
+#include "opentelemetry/nostd/variant.h"
+#include "opentelemetry/trace/span_context.h"
+
+#include <atomic>
+#include <cstring>
+#include <new>
+
+static const char* TAG = "span_pool";
+
+namespace trace_sdk = opentelemetry::sdk::trace;
+
+namespace {
+
+static SlotPool s_pool;
+static std::atomic<uint32_t> s_attributes_dropped{0};
+
+// A span record that lives entirely in its pool slot. Strings are copied
+// into arena_ and referenced by offset; the SDK's resource and
+// instrumentation scope outlive every span, so only pointers are kept.
+class PooledSpanRecordable : public trace_sdk::Recordable {
+ public:
+  static void* operator new(size_t size) noexcept { return s_pool.Allocate(size); }
+  static void operator delete(void* p) noexcept { s_pool.Free(p); }
+
+  using trace_sdk::Recordable::AddEvent;
+  using trace_sdk::Recordable::AddLink;
+
+  void SetIdentity(const opentelemetry::trace::SpanContext& span_context,
+                   opentelemetry::trace::SpanId parent_span_id) noexcept override {
+    span_context_ = span_context;
+    parent_span_id_ = parent_span_id;
+  }
+
+  void SetAttribute(opentelemetry::nostd::string_view key,
+                    const opentelemetry::common::AttributeValue& value) noexcept override {
+    Attribute* attribute = nullptr;
+    for (size_t i = 0; i < attribute_count_; i++) {
+      if (View(attributes_[i].key) == key) {
+        attribute = &attributes_[i];
+        break;
+      }
+    }
+    if (!attribute) {
+      if (attribute_count_ == kMaxAttributes || !Copy(key, &attributes_[attribute_count_].key)) {
+        s_attributes_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      attribute = &attributes_[attribute_count_];
+    }
+    if (!opentelemetry::nostd::visit(ValueCopier{this, attribute}, value)) {
+      s_attributes_dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    if (attribute == &attributes_[attribute_count_]) attribute_count_++;
+  }
+
+  // The car's spans carry no events or links.
+  void AddEvent(opentelemetry::nostd::string_view, opentelemetry::common::SystemTimestamp,
+                const opentelemetry::common::KeyValueIterable&) noexcept override {}
+  void AddLink(const opentelemetry::trace::SpanContext&,
+               const opentelemetry::common::KeyValueIterable&) noexcept override {}
+
+  void SetStatus(opentelemetry::trace::StatusCode code,
+                 opentelemetry::nostd::string_view description) noexcept override {
+    status_ = code;
+    if (!Copy(description, &description_)) description_ = {};
+  }
+
+  void SetName(opentelemetry::nostd::string_view name) noexcept override {
+    if (!Copy(name, &name_)) name_ = {};
+  }
+
+  void SetTraceFlags(opentelemetry::trace::TraceFlags flags) noexcept override {
+    trace_flags_ = flags;
+    has_trace_flags_ = true;
+  }
+
+  void SetSpanKind(opentelemetry::trace::SpanKind span_kind) noexcept override {
+    span_kind_ = span_kind;
+  }
+
+  void SetResource(const opentelemetry::sdk::resource::Resource& resource) noexcept override {
+    resource_ = &resource;
+  }
+
+  void SetStartTime(opentelemetry::common::SystemTimestamp start_time) noexcept override {
+    start_time_ = start_time;
+  }
+
+  void SetDuration(std::chrono::nanoseconds duration) noexcept override { duration_ = duration; }
+
+  void SetInstrumentationScope(const opentelemetry::sdk::instrumentationscope::InstrumentationScope&
+                                   instrumentation_scope) noexcept override {
+    scope_ = &instrumentation_scope;
+  }
+
+  void ReplayInto(trace_sdk::Recordable& out) const {
+    out.SetIdentity(span_context_, parent_span_id_);
+    if (has_trace_flags_) out.SetTraceFlags(trace_flags_);
+    out.SetName(View(name_));
+    out.SetSpanKind(span_kind_);
+    if (resource_) out.SetResource(*resource_);
+    if (scope_) out.SetInstrumentationScope(*scope_);
+    out.SetStartTime(start_time_);
+    out.SetDuration(duration_);
+    if (status_ != opentelemetry::trace::StatusCode::kUnset) {
+      out.SetStatus(status_, View(description_));
+    }
+    for (size_t i = 0; i < attribute_count_; i++) {
+      const Attribute& a = attributes_[i];
+      opentelemetry::nostd::string_view key = View(a.key);
+      switch (a.kind) {
+        case Kind::kBool:
+          out.SetAttribute(key, a.b);
+          break;
+        case Kind::kInt32:
+          out.SetAttribute(key, static_cast<int32_t>(a.i));
+          break;
+        case Kind::kInt64:
+          out.SetAttribute(key, a.i);
+          break;
+        case Kind::kUInt32:
+          out.SetAttribute(key, static_cast<uint32_t>(a.u));
+          break;
+        case Kind::kUInt64:
+          out.SetAttribute(key, a.u);
+          break;
+        case Kind::kDouble:
+          out.SetAttribute(key, a.d);
+          break;
+        case Kind::kString:
+          out.SetAttribute(key, View(a.s));
+          break;
+      }
+    }
+  }
+
+ private:
+  static constexpr size_t kMaxAttributes = 12;
+  static constexpr size_t kArenaSize = 256;
+
+  struct Text {
+    uint16_t offset;
+    uint16_t length;
+  };
+
+  enum class Kind : uint8_t { kBool, kInt32, kInt64, kUInt32, kUInt64, kDouble, kString };
+
+  struct Attribute {
+    Text key;
+    Kind kind;
+    union {
+      bool b;
+      int64_t i;
+      uint64_t u;
+      double d;
+      Text s;
+    };
+  };
+
+  // Copies scalar and string values; arrays are not recorded.
+  struct ValueCopier {
+    PooledSpanRecordable* record;
+    Attribute* attribute;
+
+    bool operator()(bool v) { return Set(Kind::kBool, &attribute->b, v); }
+    bool operator()(int32_t v) { return Set(Kind::kInt32, &attribute->i, int64_t{v}); }
+    bool operator()(int64_t v) { return Set(Kind::kInt64, &attribute->i, v); }
+    bool operator()(uint32_t v) { return Set(Kind::kUInt32, &attribute->u, uint64_t{v}); }
+    bool operator()(uint64_t v) { return Set(Kind::kUInt64, &attribute->u, v); }
+    bool operator()(double v) { return Set(Kind::kDouble, &attribute->d, v); }
+    bool operator()(const char* v) {
+      return (*this)(opentelemetry::nostd::string_view(v ? v : ""));
+    }
+    bool operator()(opentelemetry::nostd::string_view v) {
+      Text text;
+      if (!record->Copy(v, &text)) return false;
+      attribute->kind = Kind::kString;
+      attribute->s = text;
+      return true;
+    }
+    template <typename T>
+    bool operator()(const T&) {
+      return false;
+    }
+
+    template <typename T>
+    bool Set(Kind kind, T* field, T value) {
+      attribute->kind = kind;
+      *field = value;
+      return true;
+    }
+  };
+
+  // Appends to the arena. An overwritten attribute's old value stays in the
+  // arena: the car sets few attributes and rarely twice.
+  bool Copy(opentelemetry::nostd::string_view s, Text* out) {
+    if (s.size() > kArenaSize - arena_used_) return false;
+    memcpy(arena_ + arena_used_, s.data(), s.size());
+    out->offset = static_cast<uint16_t>(arena_used_);
+    out->length = static_cast<uint16_t>(s.size());
+    arena_used_ += s.size();
+    return true;
+  }
+
+  opentelemetry::nostd::string_view View(Text text) const {
+    return opentelemetry::nostd::string_view(arena_ + text.offset, text.length);
+  }
+
+  opentelemetry::trace::SpanContext span_context_ = opentelemetry::trace::SpanContext::GetInvalid();
+  opentelemetry::trace::SpanId parent_span_id_;
+  opentelemetry::trace::TraceFlags trace_flags_;
+  bool has_trace_flags_ = false;
+  opentelemetry::trace::SpanKind span_kind_ = opentelemetry::trace::SpanKind::kInternal;
+  opentelemetry::trace::StatusCode status_ = opentelemetry::trace::StatusCode::kUnset;
+  const opentelemetry::sdk::resource::Resource* resource_ = nullptr;
+  const opentelemetry::sdk::instrumentationscope::InstrumentationScope* scope_ = nullptr;
+  opentelemetry::common::SystemTimestamp start_time_;
+  std::chrono::nanoseconds duration_{0};
+  Text name_ = {};
+  Text description_ = {};
+  Attribute attributes_[kMaxAttributes];
+  size_t attribute_count_ = 0;
+  size_t arena_used_ = 0;
+  char arena_[kArenaSize];
+};
+
+}  // namespace
+
+bool span_pool_init(size_t capacity) {
+  if (s_pool.initialized()) return true;
+  if (!s_pool.Init(capacity, sizeof(PooledSpanRecordable))) {
+    ESP_LOGE(TAG, "Failed to allocate %u span slots", static_cast<unsigned>(capacity));
+    return false;
+  }
+  ESP_LOGI(TAG, "%u span slots of %u bytes in PSRAM", static_cast<unsigned>(capacity),
+           static_cast<unsigned>(s_pool.slot_size()));
+  return true;
+}
+
+span_pool_stats_t span_pool_stats() {
+  SlotPool::Stats pool = s_pool.stats();
+  span_pool_stats_t stats = {};
+  stats.capacity = pool.capacity;
+  stats.in_use = pool.in_use;
+  stats.peak = pool.peak;
+  stats.exhausted = pool.exhausted;
+  stats.attributes_dropped = s_attributes_dropped.load(std::memory_order_relaxed);
+  return stats;
+}
+
+PooledSpanExporter::PooledSpanExporter(std::unique_ptr<trace_sdk::SpanExporter> exporter)
+    : exporter_(std::move(exporter)) {}
+
+std::unique_ptr<trace_sdk::Recordable> PooledSpanExporter::MakeRecordable() noexcept {
+  return std::unique_ptr<trace_sdk::Recordable>(new PooledSpanRecordable);
+}
+
+opentelemetry::sdk::common::ExportResult PooledSpanExporter::Export(
+    const opentelemetry::nostd::span<std::unique_ptr<trace_sdk::Recordable>>& spans) noexcept {
+  batch_.clear();
+  batch_.reserve(spans.size());
+  for (auto& span : spans) {
+    if (!span) continue;
+    std::unique_ptr<trace_sdk::Recordable> out = exporter_->MakeRecordable();
+    if (!out) continue;
+    static_cast<const PooledSpanRecordable&>(*span).ReplayInto(*out);
+    span.reset();
+    batch_.push_back(std::move(out));
+  }
+  auto result = exporter_->Export(
+      opentelemetry::nostd::span<std::unique_ptr<trace_sdk::Recordable>>(batch_.data(),
+                                                                         batch_.size()));
+  batch_.clear();
+  return result;
+}
+
+bool PooledSpanExporter::ForceFlush(std::chrono::microseconds timeout) noexcept {
+  return exporter_->ForceFlush(timeout);
+}
+
+bool PooledSpanExporter::Shutdown(std::chrono::microseconds timeout) noexcept {
+  return exporter_->Shutdown(timeout);
+}
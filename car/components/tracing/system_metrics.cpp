@@ -15,6 +15,12 @@
 #include "opentelemetry/metrics/provider.h"
 #include "opentelemetry/nostd/shared_ptr.h"
 #include "opentelemetry/nostd/variant.h"
+#ifdef CONFIG_ESP_OPENTELEMETRY_TRACING_SPAN_POOL_ENABLED
+#include "span_pool.hpp"
+#endif
+#ifdef CONFIG_ESP_OPENTELEMETRY_EXPORT_BUFFER_ENABLED
+#include "export_buffer.hpp"
+#endif
 #include <array>
 #include <cassert>
 
@@ -137,10 +143,32 @@ static void cb_task_priority(opentelemetry::metrics::ObserverResult obs, void*)
                         s_task_stats[i].core);
 }
 #endif  // CONFIG_ESP_OPENTELEMETRY_METRICS_TASK_STATS_ENABLED
+#ifdef CONFIG_ESP_OPENTELEMETRY_TRACING_SPAN_POOL_ENABLED
+static void cb_span_pool_in_use(opentelemetry::metrics::ObserverResult obs, void*) {
+  observe_int64(obs, static_cast<int64_t>(span_pool_stats().in_use));
+}
+static void cb_span_pool_exhausted(opentelemetry::metrics::ObserverResult obs, void*) {
+  observe_int64(obs, static_cast<int64_t>(span_pool_stats().exhausted));
+}
+static void cb_span_pool_attributes_dropped(opentelemetry::metrics::ObserverResult obs, void*) {
+  observe_int64(obs, static_cast<int64_t>(span_pool_stats().attributes_dropped));
+}
+#endif  // CONFIG_ESP_OPENTELEMETRY_TRACING_SPAN_POOL_ENABLED
+#ifdef CONFIG_ESP_OPENTELEMETRY_EXPORT_BUFFER_ENABLED
+static void cb_export_buffer_used(opentelemetry::metrics::ObserverResult obs, void*) {
+  observe_int64(obs, static_cast<int64_t>(offline_export_stats().used));
+}
+static void cb_export_buffer_dropped(opentelemetry::metrics::ObserverResult obs, void*) {
+  observe_int64(obs, static_cast<int64_t>(offline_export_stats().dropped));
+}
+static void cb_export_buffer_drained(opentelemetry::metrics::ObserverResult obs, void*) {
+  observe_int64(obs, static_cast<int64_t>(offline_export_stats().drained));
+}
+#endif  // CONFIG_ESP_OPENTELEMETRY_EXPORT_BUFFER_ENABLED
 
 // Base instruments (free heap, min free heap, internal free heap, free psram,
 // uptime, temperature) plus whichever of the two debug-only, opt-in groups
-// below are enabled.
+// below and the span pool's and export buffer's instruments are enabled.
 static constexpr size_t kBaseInstruments = 6;
 #ifdef CONFIG_ESP_OPENTELEMETRY_METRICS_LARGEST_FREE_BLOCK_ENABLED
 static constexpr size_t kLargestFreeBlockInstruments = 1;
@@ -152,8 +180,19 @@ static constexpr size_t kTaskStatsInstruments = 2;
 #else
 static constexpr size_t kTaskStatsInstruments = 0;
 #endif
-static constexpr size_t kNumInstruments =
-    kBaseInstruments + kLargestFreeBlockInstruments + kTaskStatsInstruments;
+#ifdef CONFIG_ESP_OPENTELEMETRY_TRACING_SPAN_POOL_ENABLED
+static constexpr size_t kSpanPoolInstruments = 3;
+#else
+static constexpr size_t kSpanPoolInstruments = 0;
+#endif
+#ifdef CONFIG_ESP_OPENTELEMETRY_EXPORT_BUFFER_ENABLED
+static constexpr size_t kExportBufferInstruments = 3;
+#else
+static constexpr size_t kExportBufferInstruments = 0;
+#endif
+static constexpr size_t kNumInstruments = kBaseInstruments + kLargestFreeBlockInstruments +
+                                          kTaskStatsInstruments + kSpanPoolInstruments +
+                                          kExportBufferInstruments;
 static opentelemetry::nostd::shared_ptr<metrics_api::ObservableInstrument>
     s_instruments[kNumInstruments];
 
@@ -220,6 +259,46 @@ void system_metrics_setup() {
   idx++;
 #endif
 
+#ifdef CONFIG_ESP_OPENTELEMETRY_TRACING_SPAN_POOL_ENABLED
+  s_instruments[idx] = meter->CreateInt64ObservableGauge(
+      "dust_mite.tracing.span_pool.in_use", "Span records held in the PSRAM pool", "{span}");
+  s_instruments[idx]->AddCallback(cb_span_pool_in_use, nullptr);
+  idx++;
+
+  s_instruments[idx] = meter->CreateInt64ObservableCounter(
+      "dust_mite.tracing.span_pool.exhausted",
+      "Span records allocated from the heap because the pool was full", "{span}");
+  s_instruments[idx]->AddCallback(cb_span_pool_exhausted, nullptr);
+  idx++;
+
+  s_instruments[idx] = meter->CreateInt64ObservableCounter(
+      "dust_mite.tracing.span_pool.attributes_dropped",
+      "Span attributes not recorded because they were arrays or did not fit the record",
+      "{attribute}");
+  s_instruments[idx]->AddCallback(cb_span_pool_attributes_dropped, nullptr);
+  idx++;
+#endif
+
+#ifdef CONFIG_ESP_OPENTELEMETRY_EXPORT_BUFFER_ENABLED
+  s_instruments[idx] = meter->CreateInt64ObservableGauge(
+      "dust_mite.tracing.export_buffer.used_bytes",
+      "Serialized batches waiting in the offline export buffer", "By");
+  s_instruments[idx]->AddCallback(cb_export_buffer_used, nullptr);
+  idx++;
+
+  s_instruments[idx] = meter->CreateInt64ObservableCounter(
+      "dust_mite.tracing.export_buffer.dropped",
+      "Batches evicted from or too large for the offline export buffer", "{batch}");
+  s_instruments[idx]->AddCallback(cb_export_buffer_dropped, nullptr);
+  idx++;
+
+  s_instruments[idx] = meter->CreateInt64ObservableCounter(
+      "dust_mite.tracing.export_buffer.drained",
+      "Buffered batches posted after reconnecting", "{batch}");
+  s_instruments[idx]->AddCallback(cb_export_buffer_drained, nullptr);
+  idx++;
+#endif
+
   assert(idx == kNumInstruments);
 #endif
 }
@@ -0,0 +1,88 @@
+#include "export_buffer.hpp"
+#include "unity.h"
+#include <string>
+
+static bool push(export_buffer_t* buffer, export_signal_t signal, char fill, size_t size) {
+  std::string body(size, fill);
+  return export_buffer_push(buffer, signal, body.data(), body.size());
+}
+
+TEST_CASE("export buffer drains batches in order", "[export_buffer]") {
+  export_buffer_t* buffer = export_buffer_create(1024);
+  TEST_ASSERT_NOT_NULL(buffer);
+  TEST_ASSERT_TRUE(push(buffer, EXPORT_SIGNAL_TRACES, 'a', 100));
+  TEST_ASSERT_TRUE(push(buffer, EXPORT_SIGNAL_METRICS, 'b', 50));
+
+  export_signal_t signal;
+  std::string body;
+  uint32_t id;
+  TEST_ASSERT_TRUE(export_buffer_peek(buffer, &signal, &body, &id));
+  TEST_ASSERT_EQUAL(EXPORT_SIGNAL_TRACES, signal);
+  TEST_ASSERT_TRUE(body == std::string(100, 'a'));
+  // Peeking again returns the same batch until it is popped.
+  TEST_ASSERT_TRUE(export_buffer_peek(buffer, &signal, &body, &id));
+  TEST_ASSERT_TRUE(body == std::string(100, 'a'));
+  export_buffer_pop(buffer, id);
+
+  TEST_ASSERT_TRUE(export_buffer_peek(buffer, &signal, &body, &id));
+  TEST_ASSERT_EQUAL(EXPORT_SIGNAL_METRICS, signal);
+  TEST_ASSERT_TRUE(body == std::string(50, 'b'));
+  export_buffer_pop(buffer, id);
+  TEST_ASSERT_FALSE(export_buffer_peek(buffer, &signal, &body, &id));
+
+  export_buffer_stats_t stats = export_buffer_stats(buffer);
+  TEST_ASSERT_EQUAL(0, stats.used);
+  TEST_ASSERT_EQUAL(2, stats.drained);
+  TEST_ASSERT_EQUAL(0, stats.dropped);
+  export_buffer_delete(buffer);
+}
+
+TEST_CASE("export buffer evicts the oldest batches when full", "[export_buffer]") {
+  export_buffer_t* buffer = export_buffer_create(1024);
+  // Each batch takes a little more than 200 bytes, so four fit, the fifth
+  // evicts the first and wraps around the end of the buffer.
+  for (int i = 0; i < 8; i++) {
+    TEST_ASSERT_TRUE(push(buffer, EXPORT_SIGNAL_TRACES, 'a' + i, 200));
+  }
+  export_buffer_stats_t stats = export_buffer_stats(buffer);
+  TEST_ASSERT_EQUAL(4, stats.batches);
+  TEST_ASSERT_EQUAL(4, stats.dropped);
+
+  export_signal_t signal;
+  std::string body;
+  uint32_t id;
+  for (int i = 4; i < 8; i++) {
+    TEST_ASSERT_TRUE(export_buffer_peek(buffer, &signal, &body, &id));
+    TEST_ASSERT_TRUE(body == std::string(200, 'a' + i));
+    export_buffer_pop(buffer, id);
+  }
+  export_buffer_delete(buffer);
+}
+
+TEST_CASE("export buffer keeps a batch evicted while it was sent", "[export_buffer]") {
+  export_buffer_t* buffer = export_buffer_create(1024);
+  for (int i = 0; i < 4; i++) push(buffer, EXPORT_SIGNAL_METRICS, 'a' + i, 200);
+
+  export_signal_t signal;
+  std::string body;
+  uint32_t id;
+  TEST_ASSERT_TRUE(export_buffer_peek(buffer, &signal, &body, &id));
+  // A new batch evicts the one being sent; popping it must not remove the
+  // batch that is now the oldest.
+  push(buffer, EXPORT_SIGNAL_METRICS, 'e', 200);
+  export_buffer_pop(buffer, id);
+  TEST_ASSERT_TRUE(export_buffer_peek(buffer, &signal, &body, &id));
+  TEST_ASSERT_TRUE(body == std::string(200, 'b'));
+  TEST_ASSERT_EQUAL(0, export_buffer_stats(buffer).drained);
+  export_buffer_delete(buffer);
+}
+
+TEST_CASE("export buffer rejects a batch over a quarter of its size", "[export_buffer]") {
+  export_buffer_t* buffer = export_buffer_create(1024);
+  TEST_ASSERT_TRUE(push(buffer, EXPORT_SIGNAL_TRACES, 'a', 100));
+  TEST_ASSERT_FALSE(push(buffer, EXPORT_SIGNAL_TRACES, 'b', 257));
+  export_buffer_stats_t stats = export_buffer_stats(buffer);
+  TEST_ASSERT_EQUAL(1, stats.batches);
+  TEST_ASSERT_EQUAL(1, stats.dropped);
+  export_buffer_delete(buffer);
+}
@@ -0,0 +1,97 @@
+#include "span_pool.hpp"
+#include "unity.h"
+#include <string>
+#include <vector>
+
+#include "opentelemetry/sdk/trace/simple_processor.h"
+#include "opentelemetry/sdk/trace/span_data.h"
+#include "opentelemetry/sdk/trace/tracer_provider.h"
+
+namespace trace_api = opentelemetry::trace;
+namespace trace_sdk = opentelemetry::sdk::trace;
+
+static constexpr size_t kPoolSize = 4;
+
+// Keeps the spans that reach the wrapped exporter.
+class CollectingExporter : public trace_sdk::SpanExporter {
+ public:
+  explicit CollectingExporter(std::vector<std::unique_ptr<trace_sdk::SpanData>>* spans)
+      : spans_(spans) {}
+
+  std::unique_ptr<trace_sdk::Recordable> MakeRecordable() noexcept override {
+    return std::unique_ptr<trace_sdk::Recordable>(new trace_sdk::SpanData);
+  }
+  opentelemetry::sdk::common::ExportResult Export(
+      const opentelemetry::nostd::span<std::unique_ptr<trace_sdk::Recordable>>& spans) noexcept
+      override {
+    for (auto& span : spans) {
+      spans_->emplace_back(static_cast<trace_sdk::SpanData*>(span.release()));
+    }
+    return opentelemetry::sdk::common::ExportResult::kSuccess;
+  }
+  bool Shutdown(std::chrono::microseconds) noexcept override { return true; }
+
+ private:
+  std::vector<std::unique_ptr<trace_sdk::SpanData>>* spans_;
+};
+
+static std::unique_ptr<trace_sdk::TracerProvider> make_provider(
+    std::vector<std::unique_ptr<trace_sdk::SpanData>>* spans) {
+  TEST_ASSERT_TRUE(span_pool_init(kPoolSize));
+  std::unique_ptr<trace_sdk::SpanExporter> exporter(new PooledSpanExporter(
+      std::unique_ptr<trace_sdk::SpanExporter>(new CollectingExporter(spans))));
+  std::unique_ptr<trace_sdk::SpanProcessor> processor(
+      new trace_sdk::SimpleSpanProcessor(std::move(exporter)));
+  return std::unique_ptr<trace_sdk::TracerProvider>(
+      new trace_sdk::TracerProvider(std::move(processor)));
+}
+
+TEST_CASE("span pool record replays into the exporter", "[span_pool]") {
+  std::vector<std::unique_ptr<trace_sdk::SpanData>> spans;
+  auto provider = make_provider(&spans);
+  auto tracer = provider->GetTracer("test");
+  size_t in_use = span_pool_stats().in_use;
+
+  auto span = tracer->StartSpan(
+      "ws.stream.send", {{"ws.url", "/stream"}, {"ws.frame.size", static_cast<int64_t>(1234)}});
+  span->SetAttribute("ws.message.size", static_cast<int64_t>(1664));
+  span->SetAttribute("ws.frame.size", static_cast<int64_t>(4321));
+  span->SetStatus(trace_api::StatusCode::kError, "ws send failed");
+  TEST_ASSERT_EQUAL(in_use + 1, span_pool_stats().in_use);
+  span->End();
+  TEST_ASSERT_EQUAL(in_use, span_pool_stats().in_use);
+
+  TEST_ASSERT_EQUAL(1, spans.size());
+  const trace_sdk::SpanData& data = *spans[0];
+  TEST_ASSERT_EQUAL_STRING("ws.stream.send", std::string(data.GetName()).c_str());
+  TEST_ASSERT_TRUE(data.GetStatus() == trace_api::StatusCode::kError);
+  TEST_ASSERT_EQUAL_STRING("ws send failed", std::string(data.GetDescription()).c_str());
+  TEST_ASSERT_TRUE(data.GetSpanId() == span->GetContext().span_id());
+  const auto& attributes = data.GetAttributes();
+  TEST_ASSERT_EQUAL(3, attributes.size());
+  TEST_ASSERT_EQUAL_STRING("/stream",
+                           opentelemetry::nostd::get<std::string>(attributes.at("ws.url")).c_str());
+  TEST_ASSERT_TRUE(opentelemetry::nostd::get<int64_t>(attributes.at("ws.frame.size")) == 4321);
+  TEST_ASSERT_TRUE(opentelemetry::nostd::get<int64_t>(attributes.at("ws.message.size")) == 1664);
+}
+
+TEST_CASE("span pool falls back to the heap when exhausted", "[span_pool]") {
+  std::vector<std::unique_ptr<trace_sdk::SpanData>> spans;
+  auto provider = make_provider(&spans);
+  auto tracer = provider->GetTracer("test");
+  span_pool_stats_t before = span_pool_stats();
+  TEST_ASSERT_EQUAL(kPoolSize, before.capacity);
+
+  std::vector<opentelemetry::nostd::shared_ptr<trace_api::Span>> open;
+  for (size_t i = before.in_use; i < kPoolSize + 1; i++) {
+    open.push_back(tracer->StartSpan("ws.telemetry.send"));
+  }
+  span_pool_stats_t full = span_pool_stats();
+  TEST_ASSERT_EQUAL(kPoolSize, full.in_use);
+  TEST_ASSERT_EQUAL(kPoolSize, full.peak);
+  TEST_ASSERT_EQUAL(before.exhausted + 1, full.exhausted);
+
+  for (auto& span : open) span->End();
+  TEST_ASSERT_EQUAL(before.in_use, span_pool_stats().in_use);
+  TEST_ASSERT_EQUAL(open.size(), spans.size());
+}
@@ -0,0 +1,174 @@
+#include "trace_sampling.hpp"
+#include "unity.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "opentelemetry/sdk/resource/resource.h"
+#include "opentelemetry/sdk/trace/span_data.h"
+#include "opentelemetry/sdk/trace/tracer_provider.h"
+#include "opentelemetry/trace/span_startoptions.h"
+
+namespace trace_api = opentelemetry::trace;
+namespace trace_sdk = opentelemetry::sdk::trace;
+
+static int64_t s_now_us = 0;
+static int64_t fake_now_us() { return s_now_us; }
+
+// Collects the names of the spans that reach the exporting processor.
+class CollectingProcessor : public trace_sdk::SpanProcessor {
+ public:
+  explicit CollectingProcessor(std::vector<std::string>* names) : names_(names) {}
+
+  std::unique_ptr<trace_sdk::Recordable> MakeRecordable() noexcept override {
+    return std::unique_ptr<trace_sdk::Recordable>(new trace_sdk::SpanData);
+  }
+  void OnStart(trace_sdk::Recordable&, const trace_api::SpanContext&) noexcept override {}
+  void OnEnd(std::unique_ptr<trace_sdk::Recordable>&& span) noexcept override {
+    auto* data = static_cast<trace_sdk::SpanData*>(span.get());
+    opentelemetry::nostd::string_view name = data->GetName();
+    names_->push_back(std::string(name.data(), name.size()));
+  }
+  bool ForceFlush(std::chrono::microseconds) noexcept override { return true; }
+  bool Shutdown(std::chrono::microseconds) noexcept override { return true; }
+
+ private:
+  std::vector<std::string>* names_;
+};
+
+static std::unique_ptr<trace_sdk::TracerProvider> make_provider(
+    std::unique_ptr<trace_sdk::SpanProcessor> processor,
+    std::unique_ptr<RateLimitingSampler> sampler) {
+  return std::unique_ptr<trace_sdk::TracerProvider>(
+      new trace_sdk::TracerProvider(std::move(processor),
+                                    opentelemetry::sdk::resource::Resource::Create({}),
+                                    std::move(sampler)));
+}
+
+static void end_after(opentelemetry::nostd::shared_ptr<trace_api::Span> span,
+                      std::chrono::steady_clock::time_point start, std::chrono::milliseconds ms) {
+  trace_api::EndSpanOptions end_opts;
+  end_opts.end_steady_time = opentelemetry::common::SteadyTimestamp(start + ms);
+  span->End(end_opts);
+}
+
+TEST_CASE("rate limited span sampled at most per second", "[trace_sampling]") {
+  s_now_us = 0;
+  std::unique_ptr<RateLimitingSampler> sampler(new RateLimitingSampler(1.0, false, fake_now_us));
+  TEST_ASSERT_EQUAL(1, sampler->AddRateLimits("ws.stream.send=2,malformed,=1,other=x"));
+  std::vector<std::string> names;
+  auto provider = make_provider(
+      std::unique_ptr<trace_sdk::SpanProcessor>(new CollectingProcessor(&names)),
+      std::move(sampler));
+  auto tracer = provider->GetTracer("test");
+
+  // A burst of one second's worth, then one span per 500 ms.
+  TEST_ASSERT_TRUE(tracer->StartSpan("ws.stream.send")->GetContext().IsSampled());
+  TEST_ASSERT_TRUE(tracer->StartSpan("ws.stream.send")->GetContext().IsSampled());
+  TEST_ASSERT_FALSE(tracer->StartSpan("ws.stream.send")->GetContext().IsSampled());
+  s_now_us = 499999;
+  TEST_ASSERT_FALSE(tracer->StartSpan("ws.stream.send")->GetContext().IsSampled());
+  s_now_us = 500000;
+  TEST_ASSERT_TRUE(tracer->StartSpan("ws.stream.send")->GetContext().IsSampled());
+  TEST_ASSERT_TRUE(tracer->StartSpan("ws.command.receive")->GetContext().IsSampled());
+}
+
+TEST_CASE("child of unsampled parent is not sampled", "[trace_sampling]") {
+  std::vector<std::string> names;
+  auto provider = make_provider(
+      std::unique_ptr<trace_sdk::SpanProcessor>(new CollectingProcessor(&names)),
+      std::unique_ptr<RateLimitingSampler>(new RateLimitingSampler(0.0, true, fake_now_us)));
+  auto tracer = provider->GetTracer("test");
+
+  auto parent = tracer->StartSpan("ws.stream.connection");
+  TEST_ASSERT_TRUE(parent->IsRecording());
+  TEST_ASSERT_FALSE(parent->GetContext().IsSampled());
+
+  trace_api::StartSpanOptions opts;
+  opts.parent = parent->GetContext();
+  auto child = tracer->StartSpan("ws.stream.send", opts);
+  TEST_ASSERT_FALSE(child->GetContext().IsSampled());
+  child->End();
+  parent->End();
+}
+
+TEST_CASE("rate limit applies to children of a sampled parent", "[trace_sampling]") {
+  s_now_us = 0;
+  std::unique_ptr<RateLimitingSampler> sampler(new RateLimitingSampler(1.0, false, fake_now_us));
+  sampler->AddRateLimit("ws.stream.send", 1);
+  std::vector<std::string> names;
+  auto provider = make_provider(
+      std::unique_ptr<trace_sdk::SpanProcessor>(new CollectingProcessor(&names)),
+      std::move(sampler));
+  auto tracer = provider->GetTracer("test");
+
+  auto parent = tracer->StartSpan("ws.stream.connection");
+  TEST_ASSERT_TRUE(parent->GetContext().IsSampled());
+  trace_api::StartSpanOptions opts;
+  opts.parent = parent->GetContext();
+  TEST_ASSERT_TRUE(tracer->StartSpan("ws.stream.send", opts)->GetContext().IsSampled());
+  TEST_ASSERT_FALSE(tracer->StartSpan("ws.stream.send", opts)->GetContext().IsSampled());
+  parent->End();
+}
+
+TEST_CASE("tail sampling keeps slow span with its children", "[trace_sampling]") {
+  s_now_us = 0;
+  std::vector<std::string> names;
+  std::unique_ptr<RateLimitingSampler> sampler(new RateLimitingSampler(1.0, true, fake_now_us));
+  sampler->AddRateLimit("frame", 0);
+  auto* tail = new TailSamplingProcessor(
+      std::unique_ptr<trace_sdk::SpanProcessor>(new CollectingProcessor(&names)),
+      std::chrono::milliseconds(50), 4, 8);
+  auto provider =
+      make_provider(std::unique_ptr<trace_sdk::SpanProcessor>(tail), std::move(sampler));
+  auto tracer = provider->GetTracer("test");
+  uint32_t exhausted = TailSamplingProcessor::records_exhausted();
+
+  auto start = std::chrono::steady_clock::now();
+  trace_api::StartSpanOptions frame_opts;
+  frame_opts.start_steady_time = opentelemetry::common::SteadyTimestamp(start);
+  auto fast = tracer->StartSpan("frame", frame_opts);
+  end_after(fast, start, std::chrono::milliseconds(10));
+  TEST_ASSERT_EQUAL(0, names.size());
+
+  auto slow = tracer->StartSpan("frame", frame_opts);
+  trace_api::StartSpanOptions child_opts;
+  child_opts.parent = slow->GetContext();
+  child_opts.start_steady_time = opentelemetry::common::SteadyTimestamp(start);
+  auto child = tracer->StartSpan("encode", child_opts);
+  TEST_ASSERT_FALSE(child->GetContext().IsSampled());
+  end_after(child, start, std::chrono::milliseconds(5));
+  end_after(slow, start, std::chrono::milliseconds(60));
+
+  // The fast frame is not a descendant and stays buffered.
+  TEST_ASSERT_EQUAL(2, names.size());
+  TEST_ASSERT_EQUAL_STRING("encode", names[0].c_str());
+  TEST_ASSERT_EQUAL_STRING("frame", names[1].c_str());
+  TEST_ASSERT_EQUAL(2, tail->kept());
+  // Two spans open at once fit in the slots: no wrapper came from the heap.
+  TEST_ASSERT_EQUAL(exhausted, TailSamplingProcessor::records_exhausted());
+}
+
+TEST_CASE("tail sampling keeps errored span and discards the oldest", "[trace_sampling]") {
+  s_now_us = 0;
+  std::vector<std::string> names;
+  std::unique_ptr<RateLimitingSampler> sampler(new RateLimitingSampler(1.0, true, fake_now_us));
+  sampler->AddRateLimit("ws.telemetry.send", 0);
+  auto* tail = new TailSamplingProcessor(
+      std::unique_ptr<trace_sdk::SpanProcessor>(new CollectingProcessor(&names)),
+      std::chrono::milliseconds(50), 1, 8);
+  auto provider =
+      make_provider(std::unique_ptr<trace_sdk::SpanProcessor>(tail), std::move(sampler));
+  auto tracer = provider->GetTracer("test");
+
+  tracer->StartSpan("ws.telemetry.send")->End();
+  tracer->StartSpan("ws.telemetry.send")->End();
+  TEST_ASSERT_EQUAL(0, names.size());
+  TEST_ASSERT_EQUAL(1, tail->discarded());
+
+  auto failed = tracer->StartSpan("ws.telemetry.send");
+  failed->SetStatus(trace_api::StatusCode::kError, "ws send failed");
+  failed->End();
+  TEST_ASSERT_EQUAL(1, names.size());
+  TEST_ASSERT_EQUAL(1, tail->kept());
+}
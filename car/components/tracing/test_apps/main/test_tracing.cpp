@@ -79,6 +79,24 @@ TEST_CASE("extract non-string traceparent value", "[tracing]") {
   TEST_ASSERT_FALSE(sc.IsValid());
 }
 
+TEST_CASE("extract traceparent string", "[tracing]") {
+  opentelemetry::context::Context ctx = tracing_extract(traceparent, "");
+
+  opentelemetry::trace::SpanContext sc = opentelemetry::trace::GetSpan(ctx)->GetContext();
+  TEST_ASSERT_TRUE(sc.IsValid());
+
+  char span_buf[17] = {};
+  sc.span_id().ToLowerBase16({span_buf, 16});
+  TEST_ASSERT_EQUAL_STRING("00f067aa0ba902b7", span_buf);
+}
+
+TEST_CASE("extract empty traceparent string", "[tracing]") {
+  opentelemetry::context::Context ctx = tracing_extract("", "");
+
+  opentelemetry::trace::SpanContext sc = opentelemetry::trace::GetSpan(ctx)->GetContext();
+  TEST_ASSERT_FALSE(sc.IsValid());
+}
+
 TEST_CASE("inject with no active span", "[tracing]") {
   cJSON* obj = cJSON_CreateObject();
   tracing_inject(*obj);
@@ -137,3 +155,29 @@ TEST_CASE("inject extract roundtrip", "[tracing]") {
 
   cJSON_Delete(out);
 }
+
+TEST_CASE("inject into buffers", "[tracing]") {
+  cJSON* in = cJSON_CreateObject();
+  cJSON_AddStringToObject(in, "traceparent", traceparent);
+  opentelemetry::context::Context ctx = tracing_extract(*in);
+  cJSON_Delete(in);
+  opentelemetry::nostd::unique_ptr<opentelemetry::context::Token> token =
+      opentelemetry::context::RuntimeContext::Attach(ctx);
+
+  char tp[56];
+  char ts[64];
+  tracing_inject(tp, sizeof(tp), ts, sizeof(ts));
+  TEST_ASSERT_EQUAL_STRING(traceparent, tp);
+  TEST_ASSERT_EQUAL_STRING("", ts);
+
+  // A buffer without room for the terminator stays empty.
+  char short_tp[55];
+  tracing_inject(short_tp, sizeof(short_tp), nullptr, 0);
+  TEST_ASSERT_EQUAL_STRING("", short_tp);
+}
+
+TEST_CASE("inject into buffers with no active span", "[tracing]") {
+  char tp[56] = "stale";
+  tracing_inject(tp, sizeof(tp), nullptr, 0);
+  TEST_ASSERT_EQUAL_STRING("", tp);
+}
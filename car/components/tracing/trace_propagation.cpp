@@ -0,0 +1,146 @@
+#include "trace_propagation.hpp"
+
+#include "opentelemetry/context/runtime_context.h"
+#include "opentelemetry/context/propagation/global_propagator.h"
+
+#include <string>
+#include <string.h>
+
+namespace {
+
+class CJsonCarrier : public opentelemetry::context::propagation::TextMapCarrier {
+ public:
+  explicit CJsonCarrier(cJSON& obj) : obj_(obj) {}
+
+  [[nodiscard]] opentelemetry::nostd::string_view Get(
+      opentelemetry::nostd::string_view key) const noexcept override {
+    std::string k(key.data(), key.size());
+    const cJSON* item = cJSON_GetObjectItemCaseSensitive(&obj_, k.c_str());
+    if (item == nullptr || !cJSON_IsString(item) || item->valuestring == nullptr) {
+      return {};
+    }
+    return {item->valuestring};
+  }
+
+  void Set(opentelemetry::nostd::string_view key,
+           opentelemetry::nostd::string_view value) noexcept override {
+    std::string k(key.data(), key.size());
+    std::string v(value.data(), value.size());
+    cJSON_DeleteItemFromObjectCaseSensitive(&obj_, k.c_str());
+    cJSON_AddStringToObject(&obj_, k.c_str(), v.c_str());
+  }
+
+ private:
+  cJSON& obj_;
+};
+
+// Read-only carrier over trace context strings that were already pulled out of
+// a message (see parse_command_message), so extraction needs no JSON tree.
+class TraceContextCarrier : public opentelemetry::context::propagation::TextMapCarrier {
+ public:
+  TraceContextCarrier(const char* traceparent, const char* tracestate)
+      : traceparent_(traceparent ? traceparent : ""), tracestate_(tracestate ? tracestate : "") {}
+
+  [[nodiscard]] opentelemetry::nostd::string_view Get(
+      opentelemetry::nostd::string_view key) const noexcept override {
+    if (key == "traceparent") return traceparent_;
+    if (key == "tracestate") return tracestate_;
+    return {};
+  }
+
+  void Set(opentelemetry::nostd::string_view, opentelemetry::nostd::string_view) noexcept override {
+  }
+
+ private:
+  const char* traceparent_;
+  const char* tracestate_;
+};
+
+// Write-only carrier into fixed buffers, for senders that format their
+// messages without cJSON.
+class BufferCarrier : public opentelemetry::context::propagation::TextMapCarrier {
+ public:
+  BufferCarrier(char* traceparent, size_t traceparent_size, char* tracestate,
+                size_t tracestate_size)
+      : traceparent_(traceparent),
+        traceparent_size_(traceparent_size),
+        tracestate_(tracestate),
+        tracestate_size_(tracestate_size) {}
+
+  [[nodiscard]] opentelemetry::nostd::string_view Get(
+      opentelemetry::nostd::string_view) const noexcept override {
+    return {};
+  }
+
+  void Set(opentelemetry::nostd::string_view key,
+           opentelemetry::nostd::string_view value) noexcept override {
+    if (key == "traceparent") {
+      copy(traceparent_, traceparent_size_, value);
+    } else if (key == "tracestate") {
+      copy(tracestate_, tracestate_size_, value);
+    }
+  }
+
+ private:
+  static void copy(char* out, size_t size, opentelemetry::nostd::string_view value) {
+    if (!out || value.size() >= size) return;
+    memcpy(out, value.data(), value.size());
+    out[value.size()] = '\0';
+  }
+
+  char* traceparent_;
+  size_t traceparent_size_;
+  char* tracestate_;
+  size_t tracestate_size_;
+};
+
+}  // namespace
+
+void tracing_inject(cJSON& obj) {
+  auto propagator =
+      opentelemetry::context::propagation::GlobalTextMapPropagator::GetGlobalPropagator();
+  if (!propagator) {
+    return;
+  }
+  CJsonCarrier carrier(obj);
+  auto ctx = opentelemetry::context::RuntimeContext::GetCurrent();
+  propagator->Inject(carrier, ctx);
+}
+
+void tracing_inject(char* traceparent, size_t traceparent_size, char* tracestate,
+                    size_t tracestate_size) {
+  if (traceparent && traceparent_size > 0) traceparent[0] = '\0';
+  if (tracestate && tracestate_size > 0) tracestate[0] = '\0';
+  auto propagator =
+      opentelemetry::context::propagation::GlobalTextMapPropagator::GetGlobalPropagator();
+  if (!propagator) {
+    return;
+  }
+  BufferCarrier carrier(traceparent, traceparent_size, tracestate, tracestate_size);
+  auto ctx = opentelemetry::context::RuntimeContext::GetCurrent();
+  propagator->Inject(carrier, ctx);
+}
+
+opentelemetry::context::Context tracing_extract(const cJSON& obj) {
+  auto current = opentelemetry::context::RuntimeContext::GetCurrent();
+  auto propagator =
+      opentelemetry::context::propagation::GlobalTextMapPropagator::GetGlobalPropagator();
+  if (!propagator) {
+    return current;
+  }
+  // cJSON APIs do not take const - the carrier only reads, but we need a
+  // non-const reference for cJSON_GetObjectItemCaseSensitive.
+  CJsonCarrier carrier(const_cast<cJSON&>(obj));
+  return propagator->Extract(carrier, current);
+}
+
+opentelemetry::context::Context tracing_extract(const char* traceparent, const char* tracestate) {
+  auto current = opentelemetry::context::RuntimeContext::GetCurrent();
+  auto propagator =
+      opentelemetry::context::propagation::GlobalTextMapPropagator::GetGlobalPropagator();
+  if (!propagator || !traceparent || traceparent[0] == '\0') {
+    return current;
+  }
+  TraceContextCarrier carrier(traceparent, tracestate);
+  return propagator->Extract(carrier, current);
+}
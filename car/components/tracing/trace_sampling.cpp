@@ -0,0 +1,283 @@
+#include "trace_sampling.hpp"
+#include "slot_pool.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include <cstdlib>
+#include <cstring>
+
+static const char* TAG = "trace_sampling";
+
+namespace trace_sdk = opentelemetry::sdk::trace;
+
+namespace {
+
+// Slots for TailSamplingRecordable, shared by every processor and allocated
+// by the first one in PSRAM. A wrapper lives from MakeRecordable() until
+// OnEnd(), so open_spans slots replace one heap allocation per span. Slots
+// that run out fall back to the heap and are counted as exhausted.
+static SlotPool s_record_pool;
+
+// Forwards everything to the exporting processor's recordable and remembers
+// what TailSamplingProcessor decides on, since Recordable has no getters.
+class TailSamplingRecordable : public trace_sdk::Recordable {
+ public:
+  static void* operator new(size_t size) noexcept { return s_record_pool.Allocate(size); }
+  static void operator delete(void* p) noexcept { s_record_pool.Free(p); }
+
+  explicit TailSamplingRecordable(std::unique_ptr<trace_sdk::Recordable> inner)
+      : inner_(std::move(inner)) {}
+
+  using trace_sdk::Recordable::AddEvent;
+  using trace_sdk::Recordable::AddLink;
+
+  void SetIdentity(const opentelemetry::trace::SpanContext& span_context,
+                   opentelemetry::trace::SpanId parent_span_id) noexcept override {
+    sampled_ = span_context.IsSampled();
+    span_id_ = span_context.span_id();
+    parent_span_id_ = parent_span_id;
+    inner_->SetIdentity(span_context, parent_span_id);
+  }
+
+  void SetAttribute(opentelemetry::nostd::string_view key,
+                    const opentelemetry::common::AttributeValue& value) noexcept override {
+    inner_->SetAttribute(key, value);
+  }
+
+  void AddEvent(opentelemetry::nostd::string_view name,
+                opentelemetry::common::SystemTimestamp timestamp,
+                const opentelemetry::common::KeyValueIterable& attributes) noexcept override {
+    inner_->AddEvent(name, timestamp, attributes);
+  }
+
+  void AddLink(const opentelemetry::trace::SpanContext& span_context,
+               const opentelemetry::common::KeyValueIterable& attributes) noexcept override {
+    inner_->AddLink(span_context, attributes);
+  }
+
+  void SetStatus(opentelemetry::trace::StatusCode code,
+                 opentelemetry::nostd::string_view description) noexcept override {
+    error_ = code == opentelemetry::trace::StatusCode::kError;
+    inner_->SetStatus(code, description);
+  }
+
+  void SetName(opentelemetry::nostd::string_view name) noexcept override { inner_->SetName(name); }
+
+  void SetTraceFlags(opentelemetry::trace::TraceFlags flags) noexcept override {
+    inner_->SetTraceFlags(flags);
+  }
+
+  void SetSpanKind(opentelemetry::trace::SpanKind span_kind) noexcept override {
+    inner_->SetSpanKind(span_kind);
+  }
+
+  void SetResource(const opentelemetry::sdk::resource::Resource& resource) noexcept override {
+    inner_->SetResource(resource);
+  }
+
+  void SetStartTime(opentelemetry::common::SystemTimestamp start_time) noexcept override {
+    inner_->SetStartTime(start_time);
+  }
+
+  void SetDuration(std::chrono::nanoseconds duration) noexcept override {
+    duration_ = duration;
+    inner_->SetDuration(duration);
+  }
+
+  void SetInstrumentationScope(const opentelemetry::sdk::instrumentationscope::InstrumentationScope&
+                                   instrumentation_scope) noexcept override {
+    inner_->SetInstrumentationScope(instrumentation_scope);
+  }
+
+  trace_sdk::Recordable& inner() { return *inner_; }
+  std::unique_ptr<trace_sdk::Recordable> release() { return std::move(inner_); }
+
+  bool sampled() const { return sampled_; }
+  bool error() const { return error_; }
+  std::chrono::nanoseconds duration() const { return duration_; }
+  opentelemetry::trace::SpanId span_id() const { return span_id_; }
+  opentelemetry::trace::SpanId parent_span_id() const { return parent_span_id_; }
+
+ private:
+  std::unique_ptr<trace_sdk::Recordable> inner_;
+  bool sampled_ = false;
+  bool error_ = false;
+  std::chrono::nanoseconds duration_{0};
+  opentelemetry::trace::SpanId span_id_;
+  opentelemetry::trace::SpanId parent_span_id_;
+};
+
+// Bounds the descendant search below; the ring is small by design.
+static constexpr size_t kMaxBufferSize = 32;
+
+static void record_pool_init(size_t capacity) {
+  if (s_record_pool.initialized() || capacity == 0) return;
+  if (!s_record_pool.Init(capacity, sizeof(TailSamplingRecordable))) {
+    ESP_LOGE(TAG, "Failed to allocate %u tail sampling slots", static_cast<unsigned>(capacity));
+  }
+}
+
+}  // namespace
+
+RateLimitingSampler::RateLimitingSampler(double ratio, bool record_unsampled, Clock now_us)
+    : ratio_sampler_(ratio),
+      unsampled_(record_unsampled ? trace_sdk::Decision::RECORD_ONLY : trace_sdk::Decision::DROP),
+      now_us_(now_us ? now_us : esp_timer_get_time) {}
+
+bool RateLimitingSampler::AddRateLimit(const char* name, uint32_t per_second) {
+  if (!name || name[0] == '\0' || rate_limit_count_ >= kMaxRateLimits) return false;
+  RateLimit& limit = rate_limits_[rate_limit_count_++];
+  limit.name = name;
+  // Token bucket in microseconds of credit: a span costs 1 s / per_second and
+  // the bucket holds one second, i.e. a burst of per_second spans.
+  limit.cost_us = per_second > 0 ? 1000000 / per_second : INT64_MAX;
+  limit.credit_us = 1000000;
+  limit.last_us = now_us_();
+  return true;
+}
+
+size_t RateLimitingSampler::AddRateLimits(const char* spec) {
+  size_t added = 0;
+  while (spec && *spec) {
+    const char* end = strchr(spec, ',');
+    size_t len = end ? static_cast<size_t>(end - spec) : strlen(spec);
+    const char* eq = static_cast<const char*>(memchr(spec, '=', len));
+    if (eq && eq > spec) {
+      char* rate_end = nullptr;
+      unsigned long per_second = strtoul(eq + 1, &rate_end, 10);
+      if (rate_end != eq + 1 && rate_end == spec + len &&
+          AddRateLimit(std::string(spec, eq - spec).c_str(), per_second)) {
+        added++;
+      }
+    }
+    spec = end ? end + 1 : nullptr;
+  }
+  return added;
+}
+
+bool RateLimitingSampler::TakeToken(opentelemetry::nostd::string_view name) {
+  for (size_t i = 0; i < rate_limit_count_; i++) {
+    RateLimit& limit = rate_limits_[i];
+    if (limit.name.size() != name.size() ||
+        memcmp(limit.name.data(), name.data(), name.size()) != 0) {
+      continue;
+    }
+    int64_t now = now_us_();
+    bool taken = false;
+    taskENTER_CRITICAL(&lock_);
+    limit.credit_us += now - limit.last_us;
+    if (limit.credit_us > 1000000) limit.credit_us = 1000000;
+    limit.last_us = now;
+    if (limit.credit_us >= limit.cost_us) {
+      limit.credit_us -= limit.cost_us;
+      taken = true;
+    }
+    taskEXIT_CRITICAL(&lock_);
+    return taken;
+  }
+  return true;
+}
+
+trace_sdk::SamplingResult RateLimitingSampler::ShouldSample(
+    const opentelemetry::trace::SpanContext& parent_context,
+    opentelemetry::trace::TraceId trace_id, opentelemetry::nostd::string_view name,
+    opentelemetry::trace::SpanKind span_kind,
+    const opentelemetry::common::KeyValueIterable& attributes,
+    const opentelemetry::trace::SpanContextKeyValueIterable& links) noexcept {
+  bool sampled = false;
+  if (parent_context.IsValid()) {
+    sampled = parent_context.IsSampled();
+  } else {
+    sampled = ratio_sampler_.ShouldSample(parent_context, trace_id, name, span_kind, attributes,
+                                          links)
+                  .decision == trace_sdk::Decision::RECORD_AND_SAMPLE;
+  }
+  // Only spend a token on a span that would otherwise be sampled.
+  if (sampled) sampled = TakeToken(name);
+  return {sampled ? trace_sdk::Decision::RECORD_AND_SAMPLE : unsampled_, nullptr,
+          parent_context.trace_state()};
+}
+
+TailSamplingProcessor::TailSamplingProcessor(std::unique_ptr<trace_sdk::SpanProcessor> next,
+                                             std::chrono::microseconds slow_threshold,
+                                             size_t buffer_size, size_t open_spans)
+    : next_(std::move(next)),
+      slow_threshold_(slow_threshold),
+      buffer_(buffer_size < kMaxBufferSize ? buffer_size : kMaxBufferSize) {
+  record_pool_init(open_spans);
+}
+
+uint32_t TailSamplingProcessor::records_exhausted() {
+  return s_record_pool.stats().exhausted;
+}
+
+std::unique_ptr<trace_sdk::Recordable> TailSamplingProcessor::MakeRecordable() noexcept {
+  return std::unique_ptr<trace_sdk::Recordable>(
+      new TailSamplingRecordable(next_->MakeRecordable()));
+}
+
+void TailSamplingProcessor::OnStart(
+    trace_sdk::Recordable& span, const opentelemetry::trace::SpanContext& parent_context) noexcept {
+  next_->OnStart(static_cast<TailSamplingRecordable&>(span).inner(), parent_context);
+}
+
+void TailSamplingProcessor::OnEnd(std::unique_ptr<trace_sdk::Recordable>&& span) noexcept {
+  auto* recordable = static_cast<TailSamplingRecordable*>(span.get());
+  if (recordable->sampled()) {
+    next_->OnEnd(recordable->release());
+    return;
+  }
+
+  if (!recordable->error() && recordable->duration() < slow_threshold_) {
+    std::unique_ptr<trace_sdk::Recordable> evicted;
+    if (!buffer_.empty()) {
+      taskENTER_CRITICAL(&lock_);
+      Buffered& slot = buffer_[buffer_next_];
+      buffer_next_ = (buffer_next_ + 1) % buffer_.size();
+      evicted = std::move(slot.span);
+      slot.span_id = recordable->span_id();
+      slot.parent_span_id = recordable->parent_span_id();
+      slot.span = recordable->release();
+      taskEXIT_CRITICAL(&lock_);
+    }
+    // Freed outside the critical section.
+    if (evicted || buffer_.empty()) discarded_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  // Collect the buffered descendants breadth first: children end before
+  // their parent, so they are already in the ring if they fit.
+  opentelemetry::trace::SpanId ids[kMaxBufferSize + 1];
+  std::unique_ptr<trace_sdk::Recordable> descendants[kMaxBufferSize];
+  size_t id_count = 0;
+  size_t descendant_count = 0;
+  ids[id_count++] = recordable->span_id();
+  taskENTER_CRITICAL(&lock_);
+  for (size_t i = 0; i < id_count; i++) {
+    for (auto& slot : buffer_) {
+      if (!slot.span || slot.parent_span_id != ids[i]) continue;
+      ids[id_count++] = slot.span_id;
+      descendants[descendant_count++] = std::move(slot.span);
+    }
+  }
+  taskEXIT_CRITICAL(&lock_);
+
+  for (size_t i = 0; i < descendant_count; i++) {
+    next_->OnEnd(std::move(descendants[i]));
+  }
+  next_->OnEnd(recordable->release());
+  kept_.fetch_add(1 + descendant_count, std::memory_order_relaxed);
+}
+
+bool TailSamplingProcessor::ForceFlush(std::chrono::microseconds timeout) noexcept {
+  return next_->ForceFlush(timeout);
+}
+
+bool TailSamplingProcessor::Shutdown(std::chrono::microseconds timeout) noexcept {
+  std::vector<Buffered> buffered(buffer_.size());
+  taskENTER_CRITICAL(&lock_);
+  buffered.swap(buffer_);
+  buffer_next_ = 0;
+  taskEXIT_CRITICAL(&lock_);
+  return next_->Shutdown(timeout);
+}
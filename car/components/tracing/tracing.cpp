@@ -3,39 +3,100 @@
 #include "esp_heap_caps.h"
 #include "sdkconfig.h"
 
-#include "opentelemetry/context/runtime_context.h"
-#include "opentelemetry/context/propagation/global_propagator.h"
-#include "opentelemetry/trace/propagation/http_trace_context.h"
-
 #include <string>
 
+// esp_opentelemetry_setup() takes neither a sampler nor a span exporter, so
+// any of these features needs a tracer provider of our own.
+#if defined(CONFIG_ESP_OPENTELEMETRY_TRACING_SAMPLING_ENABLED) ||  \
+    defined(CONFIG_ESP_OPENTELEMETRY_TRACING_SPAN_POOL_ENABLED) || \
+    defined(CONFIG_ESP_OPENTELEMETRY_EXPORT_BUFFER_ENABLED)
+#define TRACING_OWN_TRACER_PROVIDER
+#endif
+
+#ifdef TRACING_OWN_TRACER_PROVIDER
+
+#include "export_buffer.hpp"
+#include "span_pool.hpp"
+#include "trace_sampling.hpp"
+#include "esp_http_client_transport.hpp"
+#include "opentelemetry/exporters/otlp/otlp_http_exporter_factory.h"
+#include "opentelemetry/exporters/otlp/otlp_http_exporter_options.h"
+#include "opentelemetry/sdk/resource/resource.h"
+#include "opentelemetry/sdk/trace/batch_span_processor_factory.h"
+#include "opentelemetry/sdk/trace/batch_span_processor_options.h"
+#include "opentelemetry/sdk/trace/provider.h"
+#include "opentelemetry/sdk/trace/samplers/always_on.h"
+#include "opentelemetry/sdk/trace/tracer_provider_factory.h"
+#include "opentelemetry/trace/provider.h"
+#include <chrono>
+#include <memory>
+
+#endif  // TRACING_OWN_TRACER_PROVIDER
+
 namespace {
 
-class CJsonCarrier : public opentelemetry::context::propagation::TextMapCarrier {
- public:
-  explicit CJsonCarrier(cJSON& obj) : obj_(obj) {}
+#ifdef TRACING_OWN_TRACER_PROVIDER
+// Replaces the global provider built by esp_opentelemetry_setup() with an
+// equivalent OTLP/HTTP + BatchSpanProcessor pipeline, optionally buffering
+// batches across Wi-Fi outages (BufferedSpanExporter), with span records in
+// a PSRAM pool (PooledSpanExporter) and behind RateLimitingSampler and
+// TailSamplingProcessor. esp_opentelemetry_tracer() resolves through the
+// global provider; the replaced one is destroyed with its export thread once
+// nothing holds it.
+void install_tracer_provider() {
+  namespace trace_sdk = opentelemetry::sdk::trace;
 
-  [[nodiscard]] opentelemetry::nostd::string_view Get(
-      opentelemetry::nostd::string_view key) const noexcept override {
-    std::string k(key.data(), key.size());
-    const cJSON* item = cJSON_GetObjectItemCaseSensitive(&obj_, k.c_str());
-    if (item == nullptr || !cJSON_IsString(item) || item->valuestring == nullptr) {
-      return {};
-    }
-    return {item->valuestring};
+  std::string url = std::string(CONFIG_ESP_OPENTELEMETRY_EXPORTER_OTLP_ENDPOINT) + "/v1/traces";
+  std::unique_ptr<trace_sdk::SpanExporter> exporter;
+#ifdef CONFIG_ESP_OPENTELEMETRY_EXPORT_BUFFER_ENABLED
+  if (offline_export_init(EXPORT_SIGNAL_TRACES, url)) {
+    exporter.reset(new BufferedSpanExporter(url));
   }
-
-  void Set(opentelemetry::nostd::string_view key,
-           opentelemetry::nostd::string_view value) noexcept override {
-    std::string k(key.data(), key.size());
-    std::string v(value.data(), value.size());
-    cJSON_DeleteItemFromObjectCaseSensitive(&obj_, k.c_str());
-    cJSON_AddStringToObject(&obj_, k.c_str(), v.c_str());
+#endif
+  if (!exporter) {
+    opentelemetry::exporter::otlp::OtlpHttpExporterOptions opts;
+    opts.url = url;
+    exporter = opentelemetry::exporter::otlp::OtlpHttpExporterFactory::Create(
+        opts, esp_opentelemetry::MakeEspHttpClient());
+  }
+  trace_sdk::BatchSpanProcessorOptions batch_opts;
+#ifdef CONFIG_ESP_OPENTELEMETRY_TRACING_SPAN_POOL_ENABLED
+  if (span_pool_init(CONFIG_ESP_OPENTELEMETRY_TRACING_SPAN_POOL_SIZE)) {
+    exporter.reset(new PooledSpanExporter(std::move(exporter)));
+    // Bound the queue by the pool, so a backlog drops spans in the
+    // BatchSpanProcessor instead of spilling records onto the heap.
+    batch_opts.max_queue_size = CONFIG_ESP_OPENTELEMETRY_TRACING_SPAN_POOL_SIZE;
+    batch_opts.max_export_batch_size = CONFIG_ESP_OPENTELEMETRY_TRACING_SPAN_POOL_SIZE / 2;
   }
+#endif
+  std::unique_ptr<trace_sdk::SpanProcessor> processor =
+      trace_sdk::BatchSpanProcessorFactory::Create(std::move(exporter), batch_opts);
+
+#ifndef CONFIG_ESP_OPENTELEMETRY_TRACING_SAMPLING_ENABLED
+  std::unique_ptr<trace_sdk::Sampler> sampler(new trace_sdk::AlwaysOnSampler);
+#else
+#ifdef CONFIG_ESP_OPENTELEMETRY_TRACING_TAIL_SAMPLING_ENABLED
+  processor.reset(new TailSamplingProcessor(
+      std::move(processor),
+      std::chrono::milliseconds(CONFIG_ESP_OPENTELEMETRY_TRACING_TAIL_SAMPLING_SLOW_MS),
+      CONFIG_ESP_OPENTELEMETRY_TRACING_TAIL_SAMPLING_BUFFER_SIZE,
+      CONFIG_ESP_OPENTELEMETRY_TRACING_TAIL_SAMPLING_OPEN_SPANS));
+  const bool record_unsampled = true;
+#else
+  const bool record_unsampled = false;
+#endif
+  std::unique_ptr<RateLimitingSampler> sampler(new RateLimitingSampler(
+      CONFIG_ESP_OPENTELEMETRY_TRACING_SAMPLING_RATIO_PERCENT / 100.0, record_unsampled));
+  sampler->AddRateLimits(CONFIG_ESP_OPENTELEMETRY_TRACING_SAMPLING_RATE_LIMITS);
+#endif
 
- private:
-  cJSON& obj_;
-};
+  auto resource = opentelemetry::sdk::resource::Resource::Create(
+      {{"service.name", CONFIG_ESP_OPENTELEMETRY_SERVICE_NAME}});
+  std::shared_ptr<opentelemetry::trace::TracerProvider> api_provider =
+      trace_sdk::TracerProviderFactory::Create(std::move(processor), resource, std::move(sampler));
+  trace_sdk::Provider::SetTracerProvider(api_provider);
+}
+#endif  // TRACING_OWN_TRACER_PROVIDER
 
 }  // namespace
 
@@ -52,32 +113,13 @@ void tracing_setup() {
 
   esp_opentelemetry_setup(CONFIG_ESP_OPENTELEMETRY_SERVICE_NAME);
 
+#ifdef TRACING_OWN_TRACER_PROVIDER
+  // Still inside the PSRAM pthread configuration for the new export thread.
+  install_tracer_provider();
+#endif
+
 #ifdef CONFIG_ESP_OPENTELEMETRY_TRACING_ENABLED
   esp_pthread_cfg_t default_cfg = esp_pthread_get_default_config();
   esp_pthread_set_cfg(&default_cfg);
 #endif
 }
-
-void tracing_inject(cJSON& obj) {
-  auto propagator =
-      opentelemetry::context::propagation::GlobalTextMapPropagator::GetGlobalPropagator();
-  if (!propagator) {
-    return;
-  }
-  CJsonCarrier carrier(obj);
-  auto ctx = opentelemetry::context::RuntimeContext::GetCurrent();
-  propagator->Inject(carrier, ctx);
-}
-
-opentelemetry::context::Context tracing_extract(const cJSON& obj) {
-  auto current = opentelemetry::context::RuntimeContext::GetCurrent();
-  auto propagator =
-      opentelemetry::context::propagation::GlobalTextMapPropagator::GetGlobalPropagator();
-  if (!propagator) {
-    return current;
-  }
-  // cJSON APIs do not take const - the carrier only reads, but we need a
-  // non-const reference for cJSON_GetObjectItemCaseSensitive.
-  CJsonCarrier carrier(const_cast<cJSON&>(obj));
-  return propagator->Extract(carrier, current);
-}
@@ -1,15 +1,371 @@
 #include "web_server.hpp"
 #include "motor.hpp"
-#include <cJSON.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
 
-bool parse_command_packet(const char* json, command_packet_t* out) {
+// Single-pass reader for command messages. It validates the JSON object while
+// walking it once, never allocates, and copies out only the fields of the
+// command schema; everything else is skipped.
+
+#define COMMAND_JSON_MAX_DEPTH 8
+
+typedef struct {
+  const char* p;
+  const char* end;
+} json_cursor_t;
+
+static void skip_whitespace(json_cursor_t* c) {
+  while (c->p < c->end && (*c->p == ' ' || *c->p == '\t' || *c->p == '\n' || *c->p == '\r')) {
+    c->p++;
+  }
+}
+
+static bool is_digit(char ch) { return ch >= '0' && ch <= '9'; }
+
+static bool is_hex_digit(char ch) {
+  return is_digit(ch) || (ch >= 'a' && ch <= 'f') || (ch >= 'A' && ch <= 'F');
+}
+
+// Command keys match case-insensitively, as cJSON_GetObjectItem did.
+static bool key_equals(const char* key, const char* name) {
+  for (; *key && *name; key++, name++) {
+    if (tolower(static_cast<unsigned char>(*key)) != tolower(static_cast<unsigned char>(*name))) {
+      return false;
+    }
+  }
+  return *key == *name;
+}
+
+// Reads a string token. Up to out_size - 1 unescaped bytes are copied to out
+// (if non-null); *len receives the full unescaped length so callers can tell
+// whether the copy was complete. Works on a local copy of the cursor: writes
+// through out may alias it, which would force a reload per byte.
+static bool read_string(json_cursor_t* c, char* out, size_t out_size, size_t* len) {
+  const char* p = c->p;
+  const char* end = c->end;
+  if (p >= end || *p != '"') return false;
+  p++;
+  size_t n = 0;
+  while (p < end) {
+    char ch = *p++;
+    if (ch == '"') {
+      if (out && out_size > 0) out[n < out_size ? n : out_size - 1] = '\0';
+      if (len) *len = n;
+      c->p = p;
+      return true;
+    }
+    if (static_cast<unsigned char>(ch) < 0x20) return false;
+    if (ch == '\\') {
+      if (p >= end) return false;
+      char esc = *p++;
+      switch (esc) {
+        case '"':
+        case '\\':
+        case '/':
+          ch = esc;
+          break;
+        case 'b':
+          ch = '\b';
+          break;
+        case 'f':
+          ch = '\f';
+          break;
+        case 'n':
+          ch = '\n';
+          break;
+        case 'r':
+          ch = '\r';
+          break;
+        case 't':
+          ch = '\t';
+          break;
+        case 'u':
+          // Validated but not decoded: no field of the command schema needs it.
+          for (int i = 0; i < 4; i++) {
+            if (p >= end || !is_hex_digit(*p)) return false;
+            p++;
+          }
+          ch = '?';
+          break;
+        default:
+          return false;
+      }
+    }
+    if (out && n + 1 < out_size) out[n] = ch;
+    n++;
+  }
+  return false;
+}
+
+static bool read_number(json_cursor_t* c, double* out) {
+  const char* start = c->p;
+  const char* p = c->p;
+  bool negative = p < c->end && *p == '-';
+  if (negative) p++;
+  if (p >= c->end || !is_digit(*p)) return false;
+  // Commands carry small integers: take those without going through strtod.
+  double integer = 0;
+  while (p < c->end && is_digit(*p)) integer = integer * 10 + (*p++ - '0');
+  if (p >= c->end || (*p != '.' && *p != 'e' && *p != 'E')) {
+    *out = negative ? -integer : integer;
+    c->p = p;
+    return true;
+  }
+  if (*p == '.') {
+    p++;
+    if (p >= c->end || !is_digit(*p)) return false;
+    while (p < c->end && is_digit(*p)) p++;
+  }
+  if (p < c->end && (*p == 'e' || *p == 'E')) {
+    p++;
+    if (p < c->end && (*p == '+' || *p == '-')) p++;
+    if (p >= c->end || !is_digit(*p)) return false;
+    while (p < c->end && is_digit(*p)) p++;
+  }
+  // strtod needs a terminated string; command numbers are short.
+  char number[32];
+  size_t len = static_cast<size_t>(p - start);
+  if (len >= sizeof(number)) return false;
+  memcpy(number, start, len);
+  number[len] = '\0';
+  *out = strtod(number, NULL);
+  c->p = p;
+  return true;
+}
+
+static bool read_literal(json_cursor_t* c, const char* literal) {
+  size_t len = strlen(literal);
+  if (static_cast<size_t>(c->end - c->p) < len || memcmp(c->p, literal, len) != 0) return false;
+  c->p += len;
+  return true;
+}
+
+static bool skip_value(json_cursor_t* c, int depth);
+
+static bool skip_container(json_cursor_t* c, int depth, char close, bool object) {
+  if (depth > COMMAND_JSON_MAX_DEPTH) return false;
+  c->p++;
+  skip_whitespace(c);
+  if (c->p < c->end && *c->p == close) {
+    c->p++;
+    return true;
+  }
+  while (true) {
+    if (object) {
+      if (!read_string(c, NULL, 0, NULL)) return false;
+      skip_whitespace(c);
+      if (c->p >= c->end || *c->p != ':') return false;
+      c->p++;
+      skip_whitespace(c);
+    }
+    if (!skip_value(c, depth + 1)) return false;
+    skip_whitespace(c);
+    if (c->p >= c->end) return false;
+    if (*c->p == close) {
+      c->p++;
+      return true;
+    }
+    if (*c->p != ',') return false;
+    c->p++;
+    skip_whitespace(c);
+  }
+}
+
+static bool skip_value(json_cursor_t* c, int depth) {
+  if (c->p >= c->end) return false;
+  double number;
+  switch (*c->p) {
+    case '"':
+      return read_string(c, NULL, 0, NULL);
+    case '{':
+      return skip_container(c, depth, '}', true);
+    case '[':
+      return skip_container(c, depth, ']', false);
+    case 't':
+      return read_literal(c, "true");
+    case 'f':
+      return read_literal(c, "false");
+    case 'n':
+      return read_literal(c, "null");
+    default:
+      return read_number(c, &number);
+  }
+}
+
+static bool at_number(const json_cursor_t* c) {
+  return c->p < c->end && (*c->p == '-' || is_digit(*c->p));
+}
+
+// Reads the value of a numeric field. Other value types are left for the
+// caller to skip and keep the default.
+static bool read_number_field(json_cursor_t* c, double* out, bool* consumed) {
+  if (!at_number(c)) return true;
+  if (!read_number(c, out)) return false;
+  *consumed = true;
+  return true;
+}
+
+static int8_t saturate_int8(double number) {
+  if (number < INT8_MIN) return INT8_MIN;
+  if (number > INT8_MAX) return INT8_MAX;
+  return static_cast<int8_t>(number);
+}
+
+typedef enum {
+  FIELD_THROTTLE = 0,
+  FIELD_STEERING,
+  FIELD_PAN,
+  FIELD_TILT,
+  FIELD_COUNT,
+} drive_and_look_field_t;
+
+static const char* const kDriveAndLookKeys[FIELD_COUNT] = {"throttle", "steering", "pan", "tilt"};
+
+static int8_t* drive_and_look_field(drive_and_look_t* d, int field) {
+  switch (field) {
+    case FIELD_THROTTLE:
+      return &d->throttle;
+    case FIELD_STEERING:
+      return &d->steering;
+    case FIELD_PAN:
+      return &d->pan;
+    default:
+      return &d->tilt;
+  }
+}
+
+bool parse_command_message(const char* json, size_t len, command_packet_t* out,
+                           command_trace_context_t* trace) {
   if (!json || !out) return false;
-  cJSON* root = cJSON_Parse(json);
-  if (!root) return false;
-  cJSON* cmd_obj = cJSON_GetObjectItem(root, "command");
-  cJSON* val_obj = cJSON_GetObjectItem(root, "value");
-  out->command = cJSON_IsNumber(cmd_obj) ? (char)cJSON_GetNumberValue(cmd_obj) : 0;
-  out->value = cJSON_IsNumber(val_obj) ? (int)cJSON_GetNumberValue(val_obj) : 0;
-  cJSON_Delete(root);
+  json_cursor_t c = {json, json + len};
+  command_packet_t packet = {};
+  // Filled in place: clearing and copying the whole tracestate buffer would
+  // cost more than parsing a typical command.
+  if (trace) {
+    trace->traceparent[0] = '\0';
+    trace->tracestate[0] = '\0';
+  }
+  // Like cJSON_GetObjectItem, the first occurrence of a duplicated key wins.
+  // traceparent and tracestate are case-sensitive, as in the cJSON carrier.
+  bool seen_command = false, seen_value = false, seen_traceparent = false, seen_tracestate = false;
+  bool seen_field[FIELD_COUNT] = {};
+
+  skip_whitespace(&c);
+  if (c.p >= c.end || *c.p != '{') return false;
+  c.p++;
+  skip_whitespace(&c);
+  if (c.p < c.end && *c.p == '}') {
+    *out = packet;
+    return true;
+  }
+  while (true) {
+    char key[16];
+    size_t key_len = 0;
+    if (!read_string(&c, key, sizeof(key), &key_len)) return false;
+    if (key_len >= sizeof(key)) key[0] = '\0';
+    skip_whitespace(&c);
+    if (c.p >= c.end || *c.p != ':') return false;
+    c.p++;
+    skip_whitespace(&c);
+
+    bool consumed = false;
+    double number = 0;
+    int field = 0;
+    while (field < FIELD_COUNT && !key_equals(key, kDriveAndLookKeys[field])) field++;
+    if (!seen_command && key_equals(key, "command")) {
+      seen_command = true;
+      if (!read_number_field(&c, &number, &consumed)) return false;
+      if (consumed) packet.command = (char)number;
+    } else if (!seen_value && key_equals(key, "value")) {
+      seen_value = true;
+      if (!read_number_field(&c, &number, &consumed)) return false;
+      if (consumed) packet.value = (int)number;
+    } else if (field < FIELD_COUNT && !seen_field[field]) {
+      seen_field[field] = true;
+      if (!read_number_field(&c, &number, &consumed)) return false;
+      if (consumed) *drive_and_look_field(&packet.drive_and_look, field) = saturate_int8(number);
+    } else if (trace && !seen_traceparent && strcmp(key, "traceparent") == 0) {
+      seen_traceparent = true;
+      size_t value_len = 0;
+      if (c.p < c.end && *c.p == '"') {
+        if (!read_string(&c, trace->traceparent, sizeof(trace->traceparent), &value_len)) {
+          return false;
+        }
+        if (value_len >= sizeof(trace->traceparent)) trace->traceparent[0] = '\0';
+        consumed = true;
+      }
+    } else if (trace && !seen_tracestate && strcmp(key, "tracestate") == 0) {
+      seen_tracestate = true;
+      size_t value_len = 0;
+      if (c.p < c.end && *c.p == '"') {
+        if (!read_string(&c, trace->tracestate, sizeof(trace->tracestate), &value_len)) {
+          return false;
+        }
+        if (value_len >= sizeof(trace->tracestate)) trace->tracestate[0] = '\0';
+        consumed = true;
+      }
+    }
+    if (!consumed && !skip_value(&c, 1)) return false;
+
+    skip_whitespace(&c);
+    if (c.p >= c.end) return false;
+    if (*c.p == '}') break;
+    if (*c.p != ',') return false;
+    c.p++;
+    skip_whitespace(&c);
+  }
+
+  *out = packet;
+  return true;
+}
+
+bool parse_command_packet(const char* json, command_packet_t* out) {
+  if (!json) return false;
+  return parse_command_message(json, strlen(json), out, NULL);
+}
+
+static uint64_t get_le(const uint8_t* in, size_t size) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < size; i++) {
+    value |= static_cast<uint64_t>(in[i]) << (8 * i);
+  }
+  return value;
+}
+
+bool decode_command_frame(const uint8_t* data, size_t len, command_frame_t* out) {
+  if (!data || !out || len < COMMAND_FRAME_SIZE) return false;
+  uint8_t flags = data[1];
+  bool drive_and_look = data[0] == COMMAND_DRIVE_AND_LOOK;
+  size_t expected = COMMAND_FRAME_SIZE;
+  if (drive_and_look) expected += COMMAND_FRAME_DRIVE_AND_LOOK_SIZE;
+  if (flags & COMMAND_FRAME_FLAG_TRACE_CONTEXT) expected += COMMAND_FRAME_TRACE_CONTEXT_SIZE;
+  if (len != expected) return false;
+
+  out->packet.command = static_cast<char>(data[0]);
+  out->flags = flags;
+  out->packet.value = static_cast<int16_t>(get_le(data + 2, 2));
+  out->sequence = static_cast<uint32_t>(get_le(data + 4, 4));
+  const uint8_t* p = data + COMMAND_FRAME_SIZE;
+  if (drive_and_look) {
+    out->packet.drive_and_look.throttle = static_cast<int8_t>(p[0]);
+    out->packet.drive_and_look.steering = static_cast<int8_t>(p[1]);
+    out->packet.drive_and_look.pan = static_cast<int8_t>(p[2]);
+    out->packet.drive_and_look.tilt = static_cast<int8_t>(p[3]);
+    p += COMMAND_FRAME_DRIVE_AND_LOOK_SIZE;
+  } else {
+    out->packet.drive_and_look = {0, 0, 0, 0};
+  }
+  if (flags & COMMAND_FRAME_FLAG_TRACE_CONTEXT) {
+    memcpy(out->trace_id, p, sizeof(out->trace_id));
+    p += sizeof(out->trace_id);
+    memcpy(out->span_id, p, sizeof(out->span_id));
+    p += sizeof(out->span_id);
+    out->trace_flags = *p;
+  } else {
+    memset(out->trace_id, 0, sizeof(out->trace_id));
+    memset(out->span_id, 0, sizeof(out->span_id));
+    out->trace_flags = 0;
+  }
   return true;
 }
@@ -0,0 +1,119 @@
+// Host micro-benchmark for the command parser: single-pass
+// parse_command_message() against the previous cJSON path, which parsed each
+// message twice (once for command/value, once for the trace context) and
+// copied the payload into a malloc'd buffer first.
+//
+//   idf.py --preview set-target linux build
+//   ./build/command_parser_benchmark.elf
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cJSON.h>
+#include "web_server.hpp"
+
+static size_t s_allocations = 0;
+
+static void* counting_malloc(size_t size) {
+  s_allocations++;
+  return malloc(size);
+}
+
+static bool parse_command_cjson(const char* payload, size_t len, command_packet_t* out,
+                                command_trace_context_t* trace) {
+  char* buf = static_cast<char*>(counting_malloc(len + 1));
+  memcpy(buf, payload, len);
+  buf[len] = '\0';
+
+  cJSON* root = cJSON_Parse(buf);
+  if (!root) {
+    free(buf);
+    return false;
+  }
+  cJSON* cmd_obj = cJSON_GetObjectItem(root, "command");
+  cJSON* val_obj = cJSON_GetObjectItem(root, "value");
+  out->command = cJSON_IsNumber(cmd_obj) ? (char)cJSON_GetNumberValue(cmd_obj) : 0;
+  out->value = cJSON_IsNumber(val_obj) ? (int)cJSON_GetNumberValue(val_obj) : 0;
+  cJSON_Delete(root);
+
+  // Second parse, as root_get_handler did to feed tracing_extract().
+  root = cJSON_Parse(buf);
+  const cJSON* traceparent = cJSON_GetObjectItemCaseSensitive(root, "traceparent");
+  const cJSON* tracestate = cJSON_GetObjectItemCaseSensitive(root, "tracestate");
+  memset(trace, 0, sizeof(*trace));
+  if (cJSON_IsString(traceparent)) {
+    strncpy(trace->traceparent, traceparent->valuestring, sizeof(trace->traceparent) - 1);
+  }
+  if (cJSON_IsString(tracestate)) {
+    strncpy(trace->tracestate, tracestate->valuestring, sizeof(trace->tracestate) - 1);
+  }
+  cJSON_Delete(root);
+  free(buf);
+  return true;
+}
+
+static bool parse_command_fast(const char* payload, size_t len, command_packet_t* out,
+                               command_trace_context_t* trace) {
+  return parse_command_message(payload, len, out, trace);
+}
+
+typedef bool (*parser_t)(const char*, size_t, command_packet_t*, command_trace_context_t*);
+
+static double run(parser_t parser, const char* payload, size_t iterations, size_t* allocations) {
+  size_t len = strlen(payload);
+  command_packet_t packet = {};
+  command_trace_context_t trace = {};
+  s_allocations = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; i++) {
+    parser(payload, len, &packet, &trace);
+  }
+  auto end = std::chrono::steady_clock::now();
+  *allocations = s_allocations;
+  return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+extern "C" void app_main(void) {
+  cJSON_Hooks hooks = {counting_malloc, free};
+  cJSON_InitHooks(&hooks);
+
+  static const struct {
+    const char* name;
+    const char* payload;
+  } kMessages[] = {
+      {"command", "{\"command\":1,\"value\":75}"},
+      {"command+traceparent",
+       "{\"command\":1,\"value\":75,"
+       "\"traceparent\":\"00-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-01\"}"},
+      {"command+trace context",
+       "{\"command\":4,\"value\":-40,"
+       "\"traceparent\":\"00-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-01\","
+       "\"tracestate\":\"rojo=00f067aa0ba902b7,congo=t61rcWkgMzE\"}"},
+  };
+  const size_t iterations = 200000;
+
+  int mismatches = 0;
+  printf("%-24s %12s %12s %10s %10s %8s\n", "message", "cjson ns", "fast ns", "cjson alloc",
+         "fast alloc", "speedup");
+  for (const auto& message : kMessages) {
+    size_t len = strlen(message.payload);
+    command_packet_t a = {}, b = {};
+    command_trace_context_t ta = {}, tb = {};
+    bool ok_a = parse_command_cjson(message.payload, len, &a, &ta);
+    bool ok_b = parse_command_fast(message.payload, len, &b, &tb);
+    if (ok_a != ok_b || a.command != b.command || a.value != b.value ||
+        strcmp(ta.traceparent, tb.traceparent) != 0 || strcmp(ta.tracestate, tb.tracestate) != 0) {
+      printf("MISMATCH: %s\n", message.name);
+      mismatches++;
+    }
+
+    size_t cjson_allocs = 0, fast_allocs = 0;
+    double cjson_ns = run(parse_command_cjson, message.payload, iterations, &cjson_allocs);
+    double fast_ns = run(parse_command_fast, message.payload, iterations, &fast_allocs);
+    printf("%-24s %12.1f %12.1f %10.1f %10.1f %7.1fx\n", message.name, cjson_ns, fast_ns,
+           static_cast<double>(cjson_allocs) / iterations,
+           static_cast<double>(fast_allocs) / iterations, cjson_ns / fast_ns);
+  }
+  exit(mismatches == 0 ? 0 : 1);
+}
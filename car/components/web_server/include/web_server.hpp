@@ -4,15 +4,112 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
+#include <stdint.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
 #include "motor.hpp"
+#include "telemetry_ring.hpp"
 
-void web_server_setup(QueueHandle_t frame_queue, QueueHandle_t command_queue,
-                      QueueHandle_t telemetry_queue);
+void web_server_setup(QueueHandle_t frame_queue, telemetry_ring_t* telemetry_ring);
 
 bool parse_command_packet(const char* json, command_packet_t* out);
 
+// Largest command message accepted on `/`; the handler receives into a fixed
+// buffer of this size.
+#define COMMAND_MESSAGE_MAX_LEN 1024
+
+// W3C trace context carried in a command message. A field is empty when the
+// key is missing, not a string or longer than the buffer.
+typedef struct {
+  char traceparent[56];  // "00-<32 hex>-<16 hex>-<2 hex>"
+  char tracestate[513];  // W3C limit: 512 characters
+} command_trace_context_t;
+
+// Parses {"command": ..., "value": ..., "traceparent": ..., "tracestate": ...}
+// in a single pass without heap allocation. COMMAND_DRIVE_AND_LOOK messages
+// carry "throttle", "steering", "pan" and "tilt" (saturated to int8) instead
+// of "value". Unknown keys are skipped; numeric fields default to 0 when
+// missing or not numbers. trace may be NULL.
+bool parse_command_message(const char* json, size_t len, command_packet_t* out,
+                           command_trace_context_t* trace);
+
+// Binary command frames, accepted on `/` as WebSocket binary messages next to
+// the JSON ones. Little-endian layout: opcode u8 (COMMAND_*), flags u8,
+// value i16, sequence u32. COMMAND_DRIVE_AND_LOOK frames continue with
+// throttle, steering, pan and tilt as i8 each. With
+// COMMAND_FRAME_FLAG_TRACE_CONTEXT set, the frame ends with trace id [16],
+// span id [8] and trace flags u8.
+#define COMMAND_FRAME_SIZE 8
+#define COMMAND_FRAME_DRIVE_AND_LOOK_SIZE 4
+#define COMMAND_FRAME_TRACE_CONTEXT_SIZE 25
+#define COMMAND_FRAME_FLAG_TRACE_CONTEXT 0x01
+
+typedef struct {
+  command_packet_t packet;
+  uint8_t flags;
+  uint32_t sequence;
+  uint8_t trace_id[16];
+  uint8_t span_id[8];
+  uint8_t trace_flags;
+} command_frame_t;
+
+// Returns false if len does not match the size implied by the flags.
+bool decode_command_frame(const uint8_t* data, size_t len, command_frame_t* out);
+
+// /stream wire formats. JSON (the default) sends {"data": "<base64 JPEG>",
+// "timestamp_us": <capture time>, "traceparent": ...} text frames; binary is negotiated with
+// /stream?format=binary and sends one binary frame per JPEG: a fixed
+// little-endian stream_frame_header_t followed by the raw JPEG bytes.
+typedef enum {
+  STREAM_FORMAT_JSON = 0,
+  STREAM_FORMAT_BINARY = 1,
+} stream_format_t;
+
+stream_format_t parse_stream_format(const char* query);
+
+// /telemetry sends one packet per message unless the client connects with
+// /telemetry?batch=1, which sends every packet since the previous message as
+// {"packets": [...], "dropped": ...}. /telemetry?format=binary (parsed with
+// parse_stream_format) sends every packet in the binary encoding of
+// telemetry_binary.hpp instead, batched regardless of batch=.
+bool parse_telemetry_batch(const char* query);
+
+// Clock exchange: a client that connects to `/`, /stream or /telemetry with
+// clock=1 in the query first receives one text message
+// {"clock":{"timestamp_us":<esp_timer now>,"epoch_offset_us":<offset>}}.
+// Every timestamp_us the car sends (telemetry packets, stream frames) is on
+// the same esp_timer clock; adding epoch_offset_us, derived from SNTP, gives
+// microseconds since the Unix epoch. epoch_offset_us is 0 before the first
+// SNTP sync.
+bool parse_clock_sync(const char* query);
+
+// Returns the message length without the terminating NUL, or 0 if out_size
+// is too small.
+size_t format_clock_message(int64_t timestamp_us, int64_t epoch_offset_us, char* out,
+                            size_t out_size);
+
+#define STREAM_FRAME_VERSION 1
+#define STREAM_FRAME_HEADER_SIZE 44
+#define STREAM_FRAME_FLAG_TRACE_CONTEXT 0x01
+
+typedef struct {
+  uint8_t flags;
+  uint8_t trace_flags;
+  uint32_t sequence;
+  // Capture time in microseconds since boot (esp_timer clock).
+  int64_t timestamp_us;
+  uint32_t length;
+  uint8_t trace_id[16];
+  uint8_t span_id[8];
+} stream_frame_header_t;
+
+// Serializes the header as: version u8, header size u8, flags u8, trace flags u8,
+// sequence u32, timestamp_us i64, length u32, trace id [16], span id [8].
+// Returns the number of bytes written, or 0 if out_size is too small.
+size_t encode_stream_frame_header(const stream_frame_header_t* header, uint8_t* out,
+                                  size_t out_size);
+
 #ifdef __cplusplus
 }
 #endif
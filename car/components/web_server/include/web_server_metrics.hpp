@@ -1,4 +1,21 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 void web_server_metrics_setup();
-void web_server_metrics_update();
+void web_server_metrics_update(size_t bytes_copied);
+// reason: "subscriber_busy" (replaced by a newer frame before the subscriber
+// picked it up), "pool_exhausted", "alloc_failed" or "send_failed".
+void web_server_metrics_frame_dropped(const char* reason);
+// Stages of one frame before fan-out, in microseconds on the esp_timer clock:
+// capture start to esp_camera_fb_get() returning, then waiting in the frame
+// queue for the distributor. Recorded once per frame.
+void web_server_metrics_frame_dequeued(int64_t capture_us, int64_t queue_us);
+// Stages of one frame delivered to one subscriber, in microseconds: waiting
+// for the subscriber's sender after fan-out, encoding (base64 or header),
+// writing to the socket, and capture start to the last fragment written.
+// format: "json" or "binary".
+void web_server_metrics_frame_delivered(const char* format, int64_t fanout_us, int64_t encode_us,
+                                        int64_t send_us, int64_t total_us);
+void web_server_metrics_stream_subscribers(int count);
@@ -0,0 +1,60 @@
+#include "web_server.hpp"
+#include "esp_http_server.h"
+#include <cstring>
+#include <inttypes.h>
+#include <stdio.h>
+
+stream_format_t parse_stream_format(const char* query) {
+  if (!query) return STREAM_FORMAT_JSON;
+  char value[16] = {};
+  if (httpd_query_key_value(query, "format", value, sizeof(value)) != ESP_OK) {
+    return STREAM_FORMAT_JSON;
+  }
+  return strcmp(value, "binary") == 0 ? STREAM_FORMAT_BINARY : STREAM_FORMAT_JSON;
+}
+
+static bool parse_query_flag(const char* query, const char* key) {
+  if (!query) return false;
+  char value[8] = {};
+  if (httpd_query_key_value(query, key, value, sizeof(value)) != ESP_OK) return false;
+  return strcmp(value, "1") == 0 || strcmp(value, "true") == 0;
+}
+
+bool parse_telemetry_batch(const char* query) { return parse_query_flag(query, "batch"); }
+
+bool parse_clock_sync(const char* query) { return parse_query_flag(query, "clock"); }
+
+size_t format_clock_message(int64_t timestamp_us, int64_t epoch_offset_us, char* out,
+                            size_t out_size) {
+  if (!out) return 0;
+  int len = snprintf(out, out_size,
+                     "{\"clock\":{\"timestamp_us\":%" PRId64 ",\"epoch_offset_us\":%" PRId64 "}}",
+                     timestamp_us, epoch_offset_us);
+  if (len < 0 || static_cast<size_t>(len) >= out_size) return 0;
+  return static_cast<size_t>(len);
+}
+
+static uint8_t* put_le(uint8_t* out, uint64_t value, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    out[i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+  return out + size;
+}
+
+size_t encode_stream_frame_header(const stream_frame_header_t* header, uint8_t* out,
+                                  size_t out_size) {
+  if (!header || !out || out_size < STREAM_FRAME_HEADER_SIZE) return 0;
+  uint8_t* p = out;
+  *p++ = STREAM_FRAME_VERSION;
+  *p++ = STREAM_FRAME_HEADER_SIZE;
+  *p++ = header->flags;
+  *p++ = header->trace_flags;
+  p = put_le(p, header->sequence, sizeof(header->sequence));
+  p = put_le(p, static_cast<uint64_t>(header->timestamp_us), sizeof(header->timestamp_us));
+  p = put_le(p, header->length, sizeof(header->length));
+  memcpy(p, header->trace_id, sizeof(header->trace_id));
+  p += sizeof(header->trace_id);
+  memcpy(p, header->span_id, sizeof(header->span_id));
+  p += sizeof(header->span_id);
+  return static_cast<size_t>(p - out);
+}
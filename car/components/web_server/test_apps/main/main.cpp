@@ -1,6 +1,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
 #include "web_server.hpp"
+#include "camera.hpp"
 #include "motor.hpp"
 #include "tracing.hpp"
 #include "wifi.hpp"
@@ -14,15 +15,14 @@ extern "C" {
 #endif
 
 extern "C" void app_main(void) {
-  QueueHandle_t command_queue = xQueueCreate(2, sizeof(command_packet_t));
-  QueueHandle_t frame_queue = xQueueCreate(2, sizeof(void*));
-  QueueHandle_t telemetry_queue = xQueueCreate(2, sizeof(telemetry_packet_t));
+  QueueHandle_t frame_queue = xQueueCreate(CAMERA_FRAME_QUEUE_DEPTH, sizeof(camera_frame_t));
+  telemetry_ring_t* telemetry_ring = telemetry_ring_create(CONFIG_TELEMETRY_RING_CAPACITY);
 
 #ifndef CONFIG_WEB_SERVER_TEST_QEMU_MODE
-  motor_setup(command_queue);
+  motor_setup();
   tracing_setup();
   wifi_setup();
-  web_server_setup(frame_queue, command_queue, telemetry_queue);
+  web_server_setup(frame_queue, telemetry_ring);
 #endif
 
   UNITY_BEGIN();
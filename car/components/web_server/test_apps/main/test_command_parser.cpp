@@ -1,5 +1,7 @@
 #include "web_server.hpp"
 #include "unity.h"
+#include <stdio.h>
+#include <string.h>
 
 TEST_CASE("parse_valid_command_and_value", "[web_server]") {
   command_packet_t p = {};
@@ -33,3 +35,140 @@ TEST_CASE("parse_null_input", "[web_server]") {
   command_packet_t p = {};
   TEST_ASSERT_FALSE(parse_command_packet(nullptr, &p));
 }
+
+TEST_CASE("parse_message_extracts_trace_context", "[web_server]") {
+  const char* json =
+      "{\"command\":1,\"value\":70,"
+      "\"traceparent\":\"00-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-01\","
+      "\"tracestate\":\"vendor=value\"}";
+  command_packet_t p = {};
+  command_trace_context_t trace = {};
+  TEST_ASSERT_TRUE(parse_command_message(json, strlen(json), &p, &trace));
+  TEST_ASSERT_EQUAL_INT(1, p.command);
+  TEST_ASSERT_EQUAL_INT(70, p.value);
+  TEST_ASSERT_EQUAL_STRING("00-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-01",
+                           trace.traceparent);
+  TEST_ASSERT_EQUAL_STRING("vendor=value", trace.tracestate);
+}
+
+TEST_CASE("parse_message_without_trace_context", "[web_server]") {
+  const char* json = "{\"command\":3,\"value\":0}";
+  command_packet_t p = {};
+  command_trace_context_t trace = {};
+  TEST_ASSERT_TRUE(parse_command_message(json, strlen(json), &p, &trace));
+  TEST_ASSERT_EQUAL_STRING("", trace.traceparent);
+  TEST_ASSERT_EQUAL_STRING("", trace.tracestate);
+}
+
+TEST_CASE("parse_message_skips_unknown_keys", "[web_server]") {
+  const char* json = "{\"extra\":{\"a\":[1,true,null,\"x\"]},\"command\":4,\"value\":-25.9}";
+  command_packet_t p = {};
+  TEST_ASSERT_TRUE(parse_command_message(json, strlen(json), &p, NULL));
+  TEST_ASSERT_EQUAL_INT(4, p.command);
+  TEST_ASSERT_EQUAL_INT(-25, p.value);
+}
+
+TEST_CASE("parse_message_non_number_fields_default_zero", "[web_server]") {
+  const char* json = "{\"command\":\"3\",\"value\":true}";
+  command_packet_t p = {};
+  TEST_ASSERT_TRUE(parse_command_message(json, strlen(json), &p, NULL));
+  TEST_ASSERT_EQUAL_INT(0, p.command);
+  TEST_ASSERT_EQUAL_INT(0, p.value);
+}
+
+TEST_CASE("parse_message_oversized_traceparent_ignored", "[web_server]") {
+  char json[160];
+  snprintf(json, sizeof(json), "{\"command\":1,\"traceparent\":\"%080d\"}", 0);
+  command_packet_t p = {};
+  command_trace_context_t trace = {};
+  TEST_ASSERT_TRUE(parse_command_message(json, strlen(json), &p, &trace));
+  TEST_ASSERT_EQUAL_INT(1, p.command);
+  TEST_ASSERT_EQUAL_STRING("", trace.traceparent);
+}
+
+TEST_CASE("parse_message_truncated_json", "[web_server]") {
+  const char* json = "{\"command\":1,\"value\":";
+  command_packet_t p = {};
+  TEST_ASSERT_FALSE(parse_command_message(json, strlen(json), &p, NULL));
+}
+
+TEST_CASE("parse_drive_and_look", "[web_server]") {
+  const char* json =
+      "{\"command\":8,\"throttle\":60,\"steering\":-20,\"pan\":-45,\"tilt\":300}";
+  command_packet_t p = {};
+  TEST_ASSERT_TRUE(parse_command_message(json, strlen(json), &p, NULL));
+  TEST_ASSERT_EQUAL_INT(COMMAND_DRIVE_AND_LOOK, p.command);
+  TEST_ASSERT_EQUAL_INT(60, p.drive_and_look.throttle);
+  TEST_ASSERT_EQUAL_INT(-20, p.drive_and_look.steering);
+  TEST_ASSERT_EQUAL_INT(-45, p.drive_and_look.pan);
+  TEST_ASSERT_EQUAL_INT(127, p.drive_and_look.tilt);
+}
+
+TEST_CASE("parse_message_keys_match_like_cjson", "[web_server]") {
+  // cJSON_GetObjectItem semantics: keys are case-insensitive and the first
+  // occurrence of a duplicated key wins.
+  const char* json = "{\"Command\":2,\"VALUE\":10,\"value\":20,\"command\":5}";
+  command_packet_t p = {};
+  TEST_ASSERT_TRUE(parse_command_message(json, strlen(json), &p, NULL));
+  TEST_ASSERT_EQUAL_INT(2, p.command);
+  TEST_ASSERT_EQUAL_INT(10, p.value);
+}
+
+TEST_CASE("parse_message_trace_keys_case_sensitive", "[web_server]") {
+  const char* json =
+      "{\"TraceParent\":\"00-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-01\","
+      "\"tracestate\":\"a=1\",\"tracestate\":\"b=2\"}";
+  command_packet_t p = {};
+  command_trace_context_t trace = {};
+  TEST_ASSERT_TRUE(parse_command_message(json, strlen(json), &p, &trace));
+  TEST_ASSERT_EQUAL_STRING("", trace.traceparent);
+  TEST_ASSERT_EQUAL_STRING("a=1", trace.tracestate);
+}
+
+TEST_CASE("decode_command_frame", "[web_server]") {
+  const uint8_t data[] = {COMMAND_TURN_LEFT, 0x00, 0xd8, 0xff, 0x2a, 0x00, 0x00, 0x01};
+  command_frame_t frame = {};
+  TEST_ASSERT_TRUE(decode_command_frame(data, sizeof(data), &frame));
+  TEST_ASSERT_EQUAL_INT(COMMAND_TURN_LEFT, frame.packet.command);
+  TEST_ASSERT_EQUAL_INT(-40, frame.packet.value);
+  TEST_ASSERT_EQUAL_UINT32(0x0100002a, frame.sequence);
+  TEST_ASSERT_EQUAL_HEX8(0, frame.flags);
+}
+
+TEST_CASE("decode_command_frame_with_trace_context", "[web_server]") {
+  uint8_t data[COMMAND_FRAME_SIZE + COMMAND_FRAME_TRACE_CONTEXT_SIZE] = {
+      COMMAND_ADVANCE, COMMAND_FRAME_FLAG_TRACE_CONTEXT, 50, 0, 7, 0, 0, 0};
+  for (int i = 0; i < 16; i++) data[COMMAND_FRAME_SIZE + i] = 0xa0 + i;
+  for (int i = 0; i < 8; i++) data[COMMAND_FRAME_SIZE + 16 + i] = 0xb0 + i;
+  data[sizeof(data) - 1] = 0x01;
+  command_frame_t frame = {};
+  TEST_ASSERT_TRUE(decode_command_frame(data, sizeof(data), &frame));
+  TEST_ASSERT_EQUAL_INT(50, frame.packet.value);
+  TEST_ASSERT_EQUAL_UINT32(7, frame.sequence);
+  TEST_ASSERT_EQUAL_HEX8(0xa0, frame.trace_id[0]);
+  TEST_ASSERT_EQUAL_HEX8(0xaf, frame.trace_id[15]);
+  TEST_ASSERT_EQUAL_HEX8(0xb0, frame.span_id[0]);
+  TEST_ASSERT_EQUAL_HEX8(0xb7, frame.span_id[7]);
+  TEST_ASSERT_EQUAL_HEX8(0x01, frame.trace_flags);
+}
+
+TEST_CASE("decode_command_frame_size_mismatch", "[web_server]") {
+  const uint8_t short_frame[] = {COMMAND_BRAKE, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00};
+  const uint8_t missing_trace[] = {
+      COMMAND_BRAKE, COMMAND_FRAME_FLAG_TRACE_CONTEXT, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00};
+  command_frame_t frame = {};
+  TEST_ASSERT_FALSE(decode_command_frame(short_frame, sizeof(short_frame), &frame));
+  TEST_ASSERT_FALSE(decode_command_frame(missing_trace, sizeof(missing_trace), &frame));
+}
+
+TEST_CASE("decode_drive_and_look_frame", "[web_server]") {
+  const uint8_t data[] = {COMMAND_DRIVE_AND_LOOK, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00,
+                          0x9c, 0x32, 0x5a, 0xe2};
+  command_frame_t frame = {};
+  TEST_ASSERT_TRUE(decode_command_frame(data, sizeof(data), &frame));
+  TEST_ASSERT_EQUAL_INT(-100, frame.packet.drive_and_look.throttle);
+  TEST_ASSERT_EQUAL_INT(50, frame.packet.drive_and_look.steering);
+  TEST_ASSERT_EQUAL_INT(90, frame.packet.drive_and_look.pan);
+  TEST_ASSERT_EQUAL_INT(-30, frame.packet.drive_and_look.tilt);
+  TEST_ASSERT_FALSE(decode_command_frame(data, COMMAND_FRAME_SIZE, &frame));
+}
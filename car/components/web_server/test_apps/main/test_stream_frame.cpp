@@ -0,0 +1,74 @@
+#include "web_server.hpp"
+#include "unity.h"
+#include <string.h>
+
+TEST_CASE("stream_format_defaults_to_json", "[web_server]") {
+  TEST_ASSERT_EQUAL_INT(STREAM_FORMAT_JSON, parse_stream_format(nullptr));
+  TEST_ASSERT_EQUAL_INT(STREAM_FORMAT_JSON, parse_stream_format(""));
+  TEST_ASSERT_EQUAL_INT(STREAM_FORMAT_JSON, parse_stream_format("format=json"));
+  TEST_ASSERT_EQUAL_INT(STREAM_FORMAT_JSON, parse_stream_format("format=xml"));
+}
+
+TEST_CASE("stream_format_binary", "[web_server]") {
+  TEST_ASSERT_EQUAL_INT(STREAM_FORMAT_BINARY, parse_stream_format("format=binary"));
+  TEST_ASSERT_EQUAL_INT(STREAM_FORMAT_BINARY, parse_stream_format("x=1&format=binary"));
+}
+
+TEST_CASE("telemetry_batch_query", "[web_server]") {
+  TEST_ASSERT_FALSE(parse_telemetry_batch(nullptr));
+  TEST_ASSERT_FALSE(parse_telemetry_batch(""));
+  TEST_ASSERT_FALSE(parse_telemetry_batch("batch=0"));
+  TEST_ASSERT_TRUE(parse_telemetry_batch("batch=1"));
+  TEST_ASSERT_TRUE(parse_telemetry_batch("x=1&batch=true"));
+}
+
+TEST_CASE("clock_sync_query", "[web_server]") {
+  TEST_ASSERT_FALSE(parse_clock_sync(nullptr));
+  TEST_ASSERT_FALSE(parse_clock_sync("batch=1"));
+  TEST_ASSERT_FALSE(parse_clock_sync("clock=0"));
+  TEST_ASSERT_TRUE(parse_clock_sync("clock=1"));
+  TEST_ASSERT_TRUE(parse_clock_sync("format=binary&clock=true"));
+}
+
+TEST_CASE("clock_message_format", "[web_server]") {
+  char buf[96];
+  size_t len = format_clock_message(86400123456LL, 1760000000000000LL, buf, sizeof(buf));
+  TEST_ASSERT_EQUAL_STRING(
+      "{\"clock\":{\"timestamp_us\":86400123456,\"epoch_offset_us\":1760000000000000}}", buf);
+  TEST_ASSERT_EQUAL(strlen(buf), len);
+
+  TEST_ASSERT_EQUAL(0, format_clock_message(1, 0, buf, 16));
+}
+
+TEST_CASE("stream_frame_header_layout", "[web_server]") {
+  stream_frame_header_t h = {};
+  h.flags = STREAM_FRAME_FLAG_TRACE_CONTEXT;
+  h.trace_flags = 0x01;
+  h.sequence = 0x04030201;
+  h.timestamp_us = 0x0807060504030201LL;
+  h.length = 61440;
+  for (int i = 0; i < 16; i++) h.trace_id[i] = 0xA0 + i;
+  for (int i = 0; i < 8; i++) h.span_id[i] = 0xB0 + i;
+
+  uint8_t buf[STREAM_FRAME_HEADER_SIZE] = {};
+  TEST_ASSERT_EQUAL(STREAM_FRAME_HEADER_SIZE, encode_stream_frame_header(&h, buf, sizeof(buf)));
+
+  TEST_ASSERT_EQUAL_HEX8(STREAM_FRAME_VERSION, buf[0]);
+  TEST_ASSERT_EQUAL_HEX8(STREAM_FRAME_HEADER_SIZE, buf[1]);
+  TEST_ASSERT_EQUAL_HEX8(STREAM_FRAME_FLAG_TRACE_CONTEXT, buf[2]);
+  TEST_ASSERT_EQUAL_HEX8(0x01, buf[3]);
+  const uint8_t sequence[] = {0x01, 0x02, 0x03, 0x04};
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(sequence, buf + 4, sizeof(sequence));
+  const uint8_t timestamp[] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08};
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(timestamp, buf + 8, sizeof(timestamp));
+  const uint8_t length[] = {0x00, 0xF0, 0x00, 0x00};
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(length, buf + 16, sizeof(length));
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(h.trace_id, buf + 20, sizeof(h.trace_id));
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(h.span_id, buf + 36, sizeof(h.span_id));
+}
+
+TEST_CASE("stream_frame_header_buffer_too_small", "[web_server]") {
+  stream_frame_header_t h = {};
+  uint8_t buf[STREAM_FRAME_HEADER_SIZE - 1] = {};
+  TEST_ASSERT_EQUAL(0, encode_stream_frame_header(&h, buf, sizeof(buf)));
+}
@@ -5,21 +5,28 @@
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include "freertos/semphr.h"
+#include <inttypes.h>
 #include <stdio.h>
+#include <string.h>
 #include "esp_err.h"
 #include "esp_check.h"
 #include "esp_log.h"
+#include "sdkconfig.h"
 #include "esp_camera.h"
 #include "esp_http_server.h"
 #include "esp_wifi.h"
+#include "esp_timer.h"
 #include "motor.hpp"
 #include "camera.hpp"
+#include "camera_abr.hpp"
 #include "telemetry.hpp"
+#include "telemetry_binary.hpp"
 #include "tracing.hpp"
 #include "web_server_metrics.hpp"
 #include <cJSON.h>
 #include "mbedtls/base64.h"
 #include "opentelemetry/trace/context.h"
+#include "opentelemetry/trace/span_context.h"
 
 static const char* TAG = "web_server";
 
@@ -29,27 +36,140 @@ static const char* TAG = "web_server";
 static httpd_handle_t server = NULL;
 static TaskHandle_t g_server_task_handle = NULL;
 
-static QueueHandle_t g_command_queue = NULL;
+// /stream fans every captured frame out to up to
+// CONFIG_WEB_SERVER_STREAM_MAX_SUBSCRIBERS clients. ws_stream_task takes
+// frames off the camera queue and hands a reference to each subscriber; each
+// subscriber has its own sender task and a single pending slot that the
+// distributor overwrites with the newest frame, so a slow client only drops
+// its own frames and never stalls the camera task or the other clients.
+#define STREAM_STOP_NOTIFICATION_INDEX 0
+#define STREAM_START_NOTIFICATION_INDEX 1
+#define STREAM_FRAME_NOTIFICATION_INDEX 2
+
+// A camera frame shared between subscribers. The buffer goes back to the
+// driver (esp_camera_fb_return) when the last reference is released.
+typedef struct {
+  camera_fb_t* fb;
+  int64_t fb_get_us;    // camera_task got the frame from the driver
+  int64_t dequeued_us;  // ws_stream_task took it off the frame queue
+  int refs;
+} stream_frame_ref_t;
+
+typedef struct {
+  bool in_use;  // claimed by a handshake until the sender task tears it down
+  httpd_req_t* req;
+  int sockfd;
+  stream_format_t format;
+  stream_frame_ref_t* pending;
+  TaskHandle_t task;
+  opentelemetry::nostd::shared_ptr<opentelemetry::trace::Span> connection_span;
+} stream_subscriber_t;
+
+// Each subscriber holds at most one frame in flight plus the shared newest
+// pending frame, and the distributor holds one while fanning it out. The
+// camera allocates a frame buffer for each of these, so the pool only runs out
+// if a frame is leaked.
+#define STREAM_FRAME_POOL_SIZE (CONFIG_WEB_SERVER_STREAM_MAX_SUBSCRIBERS + 2)
 
 static QueueHandle_t g_frame_queue = NULL;
-static QueueHandle_t g_stream_req_queue = NULL;
 static TaskHandle_t g_stream_task_handle = NULL;
-
-static QueueHandle_t g_telemetry_packet_queue = NULL;
+// Guards frame refcounts, the subscriber slots' req/pending/in_use fields and
+// the peak send time.
+static portMUX_TYPE g_stream_lock = portMUX_INITIALIZER_UNLOCKED;
+static stream_frame_ref_t g_stream_frames[STREAM_FRAME_POOL_SIZE];
+static stream_subscriber_t g_stream_subscribers[CONFIG_WEB_SERVER_STREAM_MAX_SUBSCRIBERS];
+static int g_stream_subscriber_count = 0;
+
+// Adaptive bitrate feedback, evaluated by ws_stream_task once per window.
+// Peak send time is raised by every sender and read and reset by the
+// distributor, both under g_stream_lock: a 64-bit value is not written
+// atomically on the ESP32-S3.
+#define STREAM_ABR_WINDOW_US 1000000
+static int64_t g_stream_peak_send_us = 0;
+
+static telemetry_ring_t* g_telemetry_ring = NULL;
+// Packets drained from the ring for one send; sized to the ring and allocated
+// in PSRAM at setup.
+static telemetry_packet_t* g_telemetry_batch = NULL;
+static size_t g_telemetry_batch_size = 0;
+// Messages encoded from g_telemetry_batch; sized for a full batch.
+static uint8_t* g_telemetry_binary = NULL;
+static size_t g_telemetry_binary_size = 0;
+static char* g_telemetry_json = NULL;
+static size_t g_telemetry_json_size = 0;
+// Set per connection from /telemetry?batch=1 and /telemetry?format=binary.
+static bool g_telemetry_batch_mode = false;
+static stream_format_t g_telemetry_format = STREAM_FORMAT_JSON;
 static QueueHandle_t g_telemetry_req_queue = NULL;
 static TaskHandle_t g_telemetry_task_handle = NULL;
 
 // Connection-level spans live across task/queue boundaries, so stash them
 // in file-scope shared_ptrs guarded by the single-producer/single-consumer
-// lifecycle of the stream/telemetry handlers.
-static opentelemetry::nostd::shared_ptr<opentelemetry::trace::Span> g_stream_connection_span;
+// lifecycle of the telemetry handlers. Stream subscribers keep theirs in
+// their slot.
 static opentelemetry::nostd::shared_ptr<opentelemetry::trace::Span> g_telemetry_connection_span;
 
+// Starts the receive span for a decoded command (JSON or binary) and hands the
+// command to the motor mailboxes. sequence is negative for JSON messages,
+// which carry none.
+static void dispatch_command(const command_packet_t* packet,
+                             const opentelemetry::trace::SpanContext& parent, const char* format,
+                             size_t message_size, int64_t sequence) {
+  opentelemetry::trace::StartSpanOptions start_opts;
+  start_opts.kind = opentelemetry::trace::SpanKind::kServer;
+  start_opts.parent = parent;
+  auto span = esp_opentelemetry_tracer()->StartSpan(
+      "ws.command.receive",
+      {{"ws.url", "/"},
+       {"network.protocol.name", "websocket"},
+       {"ws.message.type", "command"},
+       {"ws.message.format", format},
+       {"ws.message.size", static_cast<int64_t>(message_size)},
+       {"command.name", static_cast<int64_t>(packet->command)},
+       {"command.value", static_cast<int64_t>(packet->value)}},
+      start_opts);
+  auto scope = opentelemetry::trace::Scope(span);
+  if (sequence >= 0) span->SetAttribute("command.sequence", sequence);
+  if (packet->command == COMMAND_DRIVE_AND_LOOK) {
+    span->SetAttribute("command.throttle", static_cast<int64_t>(packet->drive_and_look.throttle));
+    span->SetAttribute("command.steering", static_cast<int64_t>(packet->drive_and_look.steering));
+    span->SetAttribute("command.pan", static_cast<int64_t>(packet->drive_and_look.pan));
+    span->SetAttribute("command.tilt", static_cast<int64_t>(packet->drive_and_look.tilt));
+  }
+
+  // Never blocks: a newer command for the same actuator replaces one the
+  // command task has not executed yet.
+  if (!motor_post_command(packet)) {
+    span->SetStatus(opentelemetry::trace::StatusCode::kError, "unknown command");
+  }
+  span->End();
+}
+
+// Answers clock=1 in a handshake query; see parse_clock_sync(). Sent from the
+// handshake, before any other message on the connection.
+static void send_clock_message(httpd_req_t* req) {
+  char message[96];
+  httpd_ws_frame_t ws_pkt = {};
+  ws_pkt.type = HTTPD_WS_TYPE_TEXT;
+  ws_pkt.payload = (uint8_t*)message;
+  ws_pkt.len = format_clock_message(esp_timer_get_time(), get_epoch_offset_us(), message,
+                                    sizeof(message));
+  esp_err_t ret = httpd_ws_send_frame(req, &ws_pkt);
+  if (ret != ESP_OK) {
+    ESP_LOGW(TAG, "Failed to send the clock message: %s", esp_err_to_name(ret));
+  }
+}
+
 static esp_err_t root_get_handler(httpd_req_t* req) {
   esp_err_t ret = ESP_OK;
 
   if (req->method == HTTP_GET) {
     ESP_LOGI(TAG, "Handshake done, the new connection was opened");
+    char query[32] = {};
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        parse_clock_sync(query)) {
+      send_clock_message(req);
+    }
     return ESP_OK;
   }
 
@@ -61,64 +181,70 @@ static esp_err_t root_get_handler(httpd_req_t* req) {
   }
   ESP_LOGI(TAG, "Frame len is %d", ws_pkt.len);
 
-  if (ws_pkt.type != HTTPD_WS_TYPE_TEXT) {
+  if (ws_pkt.type != HTTPD_WS_TYPE_TEXT && ws_pkt.type != HTTPD_WS_TYPE_BINARY) {
     ESP_LOGE(TAG, "Invalid packet type: %d", ws_pkt.type);
     return ESP_FAIL;
   }
 
-  unsigned char* buf = NULL;
-  if (ws_pkt.len > 0) {
-    buf = (unsigned char*)malloc(ws_pkt.len + 1);
-    buf[ws_pkt.len] = '\0';
+  if (ws_pkt.len > COMMAND_MESSAGE_MAX_LEN) {
+    ESP_LOGE(TAG, "Command message too large: %d bytes", ws_pkt.len);
+    return ESP_ERR_INVALID_SIZE;
   }
 
-  ws_pkt.payload = buf;
+  // Received into a fixed stack buffer and parsed in a single pass that also
+  // pulls out the trace context: no heap allocation on the control path.
+  char buf[COMMAND_MESSAGE_MAX_LEN + 1];
+  ws_pkt.payload = (uint8_t*)buf;
   ret = httpd_ws_recv_frame(req, &ws_pkt, ws_pkt.len);
   if (ret != ESP_OK) {
     ESP_LOGE(TAG, "httpd_ws_recv_frame failed with %d", ret);
-    free(buf);
+    return ret;
+  }
+  buf[ws_pkt.len] = '\0';
+  int64_t received_us = esp_timer_get_time();
+
+  if (ws_pkt.type == HTTPD_WS_TYPE_BINARY) {
+    command_frame_t frame = {};
+    if (!decode_command_frame(ws_pkt.payload, ws_pkt.len, &frame)) {
+      ESP_LOGW(TAG, "Invalid binary command frame (%d bytes)", ws_pkt.len);
+      auto span = esp_opentelemetry_tracer()->StartSpan("ws.command.receive");
+      span->SetStatus(opentelemetry::trace::StatusCode::kError, "frame decode failed");
+      span->SetAttribute("ws.message.size", static_cast<int64_t>(ws_pkt.len));
+      span->End();
+      return ret;
+    }
+    ESP_LOGI(TAG, "BINARY={\"command\": %d, \"value\": %d, \"sequence\": %lu}",
+             frame.packet.command, frame.packet.value, (unsigned long)frame.sequence);
+    frame.packet.received_us = received_us;
+    opentelemetry::trace::SpanContext parent = opentelemetry::trace::SpanContext::GetInvalid();
+    if (frame.flags & COMMAND_FRAME_FLAG_TRACE_CONTEXT) {
+      parent = opentelemetry::trace::SpanContext(
+          opentelemetry::trace::TraceId(
+              opentelemetry::nostd::span<const uint8_t, 16>(frame.trace_id)),
+          opentelemetry::trace::SpanId(opentelemetry::nostd::span<const uint8_t, 8>(frame.span_id)),
+          opentelemetry::trace::TraceFlags(frame.trace_flags), true);
+    }
+    dispatch_command(&frame.packet, parent, "binary", ws_pkt.len,
+                     static_cast<int64_t>(frame.sequence));
     return ret;
   }
 
   command_packet_t packet = {};
-  if (parse_command_packet((const char*)ws_pkt.payload, &packet)) {
+  command_trace_context_t trace = {};
+  if (parse_command_message(buf, ws_pkt.len, &packet, &trace)) {
     ESP_LOGI(TAG, "JSON={\"command\": %d, \"value\": %d}", packet.command, packet.value);
-
-    cJSON* root = cJSON_Parse((const char*)ws_pkt.payload);
-    auto parent_ctx = tracing_extract(*root);
-    cJSON_Delete(root);
-
-    opentelemetry::trace::StartSpanOptions start_opts;
-    start_opts.kind = opentelemetry::trace::SpanKind::kServer;
-    start_opts.parent = opentelemetry::trace::GetSpan(parent_ctx)->GetContext();
-    auto span = esp_opentelemetry_tracer()->StartSpan(
-        "ws.command.receive",
-        {{"ws.url", "/"},
-         {"network.protocol.name", "websocket"},
-         {"ws.message.type", "command"},
-         {"ws.message.size", static_cast<int64_t>(ws_pkt.len)},
-         {"command.name", static_cast<int64_t>(packet.command)},
-         {"command.value", static_cast<int64_t>(packet.value)}},
-        start_opts);
-    auto scope = opentelemetry::trace::Scope(span);
-
-    if (xQueueSendToBack(g_command_queue, &packet, portMAX_DELAY) != pdPASS) {
-      ESP_LOGE(TAG, "xQueueSendToBack failed");
-      span->SetStatus(opentelemetry::trace::StatusCode::kError, "queue send failed");
-      span->End();
-      free(buf);
-      return ESP_FAIL;
-    }
-    span->End();
+    packet.received_us = received_us;
+    auto parent_ctx = tracing_extract(trace.traceparent, trace.tracestate);
+    dispatch_command(&packet, opentelemetry::trace::GetSpan(parent_ctx)->GetContext(), "json",
+                     ws_pkt.len, -1);
   } else {
-    ESP_LOGW(TAG, "Failed to parse JSON: %s", ws_pkt.payload);
+    ESP_LOGW(TAG, "Failed to parse JSON: %s", buf);
     auto span = esp_opentelemetry_tracer()->StartSpan("ws.command.receive");
     span->SetStatus(opentelemetry::trace::StatusCode::kError, "json parse failed");
     span->SetAttribute("ws.message.size", static_cast<int64_t>(ws_pkt.len));
     span->End();
   }
 
-  free(buf);
   return ret;
 }
 
@@ -133,32 +259,75 @@ static const httpd_uri_t root = {
     .ws_post_handshake_cb = NULL,
 };
 
+static stream_subscriber_t* find_stream_subscriber(int sockfd) {
+  stream_subscriber_t* found = NULL;
+  taskENTER_CRITICAL(&g_stream_lock);
+  for (auto& sub : g_stream_subscribers) {
+    if (sub.in_use && sub.req != NULL && sub.sockfd == sockfd) {
+      found = &sub;
+      break;
+    }
+  }
+  taskEXIT_CRITICAL(&g_stream_lock);
+  return found;
+}
+
 static esp_err_t stream_handle_handshake(httpd_req_t* req) {
   if (g_server_task_handle == NULL) {
     g_server_task_handle = xTaskGetCurrentTaskHandle();
   }
   ESP_LOGI(TAG, "Handshake done, the new connection was opened");
+  char query[64] = {};
+  bool has_query = httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK;
+  stream_format_t format = parse_stream_format(has_query ? query : NULL);
   opentelemetry::trace::StartSpanOptions stream_opts;
   stream_opts.kind = opentelemetry::trace::SpanKind::kServer;
-  g_stream_connection_span = esp_opentelemetry_tracer()->StartSpan(
-      "ws.stream.connection", {{"ws.url", "/stream"}, {"network.protocol.name", "websocket"}},
+  auto connection_span = esp_opentelemetry_tracer()->StartSpan(
+      "ws.stream.connection",
+      {{"ws.url", "/stream"},
+       {"network.protocol.name", "websocket"},
+       {"ws.stream.format", format == STREAM_FORMAT_BINARY ? "binary" : "json"}},
       stream_opts);
+
+  stream_subscriber_t* sub = NULL;
+  taskENTER_CRITICAL(&g_stream_lock);
+  for (auto& slot : g_stream_subscribers) {
+    if (!slot.in_use) {
+      slot.in_use = true;
+      sub = &slot;
+      break;
+    }
+  }
+  taskEXIT_CRITICAL(&g_stream_lock);
+  if (sub == NULL) {
+    ESP_LOGW(TAG, "Rejecting stream client: %d subscribers already connected",
+             CONFIG_WEB_SERVER_STREAM_MAX_SUBSCRIBERS);
+    connection_span->SetStatus(opentelemetry::trace::StatusCode::kError, "too many subscribers");
+    connection_span->End();
+    return ESP_FAIL;
+  }
+
+  // The sender task is not started yet, so this is the first message.
+  if (parse_clock_sync(has_query ? query : NULL)) send_clock_message(req);
+
   httpd_req_t* copy = NULL;
   esp_err_t ret = httpd_req_async_handler_begin(req, &copy);
   if (ret != ESP_OK) {
     ESP_LOGE(TAG, "httpd_req_async_handler_begin failed: %s", esp_err_to_name(ret));
-    g_stream_connection_span->SetStatus(opentelemetry::trace::StatusCode::kError,
-                                        "async begin failed");
-    g_stream_connection_span->End();
+    connection_span->SetStatus(opentelemetry::trace::StatusCode::kError, "async begin failed");
+    connection_span->End();
+    taskENTER_CRITICAL(&g_stream_lock);
+    sub->in_use = false;
+    taskEXIT_CRITICAL(&g_stream_lock);
     return ret;
   }
-  if (xQueueSendToBack(g_stream_req_queue, &copy, portMAX_DELAY) != pdPASS) {
-    ESP_LOGE(TAG, "xQueueSendToBack(g_stream_req_queue) failed");
-    g_stream_connection_span->SetStatus(opentelemetry::trace::StatusCode::kError,
-                                        "queue send failed");
-    g_stream_connection_span->End();
-    return ESP_FAIL;
-  }
+  sub->sockfd = httpd_req_to_sockfd(req);
+  sub->format = format;
+  sub->connection_span = connection_span;
+  taskENTER_CRITICAL(&g_stream_lock);
+  sub->req = copy;
+  taskEXIT_CRITICAL(&g_stream_lock);
+  xTaskNotifyGiveIndexed(sub->task, STREAM_START_NOTIFICATION_INDEX);
   return ESP_OK;
 }
 
@@ -169,7 +338,8 @@ static esp_err_t stream_handle_websocket_frame(httpd_req_t* req) {
   ret = httpd_ws_recv_frame(req, &ws_pkt, 0);
   if (ret != ESP_OK) {
     ESP_LOGW(TAG, "Failed to receive stream WS frame header: %s", esp_err_to_name(ret));
-    xTaskNotifyGive(g_stream_task_handle);
+    stream_subscriber_t* sub = find_stream_subscriber(httpd_req_to_sockfd(req));
+    if (sub) xTaskNotifyGiveIndexed(sub->task, STREAM_STOP_NOTIFICATION_INDEX);
     return ret;
   }
 
@@ -192,13 +362,18 @@ static esp_err_t stream_handle_websocket_frame(httpd_req_t* req) {
       ws_pkt.type = HTTPD_WS_TYPE_PONG;
     } else if (ws_pkt.type == HTTPD_WS_TYPE_CLOSE) {
       ESP_LOGI(TAG, "Got a WS CLOSE frame, Replying CLOSE");
-      if (g_stream_connection_span) {
-        g_stream_connection_span->SetAttribute("ws.close.code", static_cast<int64_t>(ws_pkt.len));
+      // The subscriber may already be gone if its sender hit a send error;
+      // only wait for a sender that will actually signal back.
+      stream_subscriber_t* sub = find_stream_subscriber(httpd_req_to_sockfd(req));
+      if (sub && sub->connection_span) {
+        sub->connection_span->SetAttribute("ws.close.code", static_cast<int64_t>(ws_pkt.len));
       }
       ws_pkt.len = 0;
       ws_pkt.payload = NULL;
-      xTaskNotifyGive(g_stream_task_handle);
-      ulTaskNotifyTakeIndexed(CAMERA_STOPPED_NOTIFICATION_INDEX, pdTRUE, pdMS_TO_TICKS(2000));
+      if (sub) {
+        xTaskNotifyGiveIndexed(sub->task, STREAM_STOP_NOTIFICATION_INDEX);
+        ulTaskNotifyTakeIndexed(CAMERA_STOPPED_NOTIFICATION_INDEX, pdTRUE, pdMS_TO_TICKS(2000));
+      }
     }
 
     ESP_LOGI(TAG, "Sending control frame from stream handler");
@@ -224,139 +399,326 @@ static esp_err_t stream_get_handler(httpd_req_t* req) {
   return stream_handle_websocket_frame(req);
 }
 
-void ws_stream_task(void* p) {
-  ESP_LOGI(TAG, "Starting stream task");
-  esp_err_t ret = ESP_OK;
-  httpd_req_t* req = NULL;
-  camera_fb_t* frame = NULL;
-  while (true) {
-    if (req == NULL) {
-      ESP_LOGI(TAG, "Waiting for notification to start the stream");
-      if (xQueueReceive(g_stream_req_queue, &req, portMAX_DELAY) != pdPASS) {
-        ESP_LOGE(TAG, "xQueueReceive(g_stream_req_queue) failed");
-        break;
-      }
-      camera_start();
-      ESP_LOGI(TAG, "Stream started");
+// Both stream formats hand frame->buf to the socket without staging the whole
+// frame in heap memory: the message goes out as WebSocket fragments so the
+// camera buffer reference is only released once the last fragment has been
+// written. Only headers and base64 chunks are copied, into a buffer on the
+// sender task's stack.
+#define STREAM_B64_CHUNK_INPUT_SIZE 3072  // multiple of 3: no padding mid-stream
+#define STREAM_B64_CHUNK_SIZE (STREAM_B64_CHUNK_INPUT_SIZE / 3 * 4)
+
+typedef struct {
+  size_t message_size;
+  size_t bytes_copied;
+  int64_t encode_us;  // encoding is interleaved with the socket writes
+} stream_send_stats_t;
+
+static esp_err_t send_stream_fragment(httpd_req_t* req, httpd_ws_type_t type, const uint8_t* data,
+                                      size_t len, bool final, stream_send_stats_t* stats) {
+  httpd_ws_frame_t ws_pkt = {};
+  ws_pkt.type = type;
+  ws_pkt.fragmented = true;
+  ws_pkt.final = final;
+  ws_pkt.payload = const_cast<uint8_t*>(data);
+  ws_pkt.len = len;
+  stats->message_size += len;
+  return httpd_ws_send_frame(req, &ws_pkt);
+}
+
+// The camera driver stamps each frame with the esp_timer clock when its first
+// DMA buffer arrives.
+static int64_t stream_frame_timestamp_us(const camera_fb_t* frame) {
+  return static_cast<int64_t>(frame->timestamp.tv_sec) * 1000000 + frame->timestamp.tv_usec;
+}
+
+// Sends one JPEG frame as a {"data": "<base64>", "timestamp_us": <capture time>}
+// text message; the active send span is injected as the trace context. The
+// base64 text is encoded chunk by chunk into a fixed buffer and sent as
+// continuation fragments.
+static esp_err_t send_stream_frame_json(httpd_req_t* req, const camera_fb_t* frame,
+                                        stream_send_stats_t* stats) {
+  static const char kPrefix[] = "{\"data\":\"";
+  esp_err_t ret = send_stream_fragment(req, HTTPD_WS_TYPE_TEXT, (const uint8_t*)kPrefix,
+                                       sizeof(kPrefix) - 1, false, stats);
+  if (ret != ESP_OK) return ret;
+
+  unsigned char chunk[STREAM_B64_CHUNK_SIZE + 1];
+  for (size_t offset = 0; offset < frame->len; offset += STREAM_B64_CHUNK_INPUT_SIZE) {
+    size_t in_len = frame->len - offset;
+    if (in_len > STREAM_B64_CHUNK_INPUT_SIZE) in_len = STREAM_B64_CHUNK_INPUT_SIZE;
+    size_t out_len = 0;
+    int64_t encode_start = esp_timer_get_time();
+    if (mbedtls_base64_encode(chunk, sizeof(chunk), &out_len, frame->buf + offset, in_len) != 0) {
+      return ESP_FAIL;
     }
+    stats->encode_us += esp_timer_get_time() - encode_start;
+    stats->bytes_copied += out_len;
+    ret = send_stream_fragment(req, HTTPD_WS_TYPE_CONTINUE, chunk, out_len, false, stats);
+    if (ret != ESP_OK) return ret;
+  }
+
+  // Close the "data" string, add the capture time and append the trace
+  // context keys, reusing the object body of a small cJSON carrier:
+  // {"traceparent":...} -> ","traceparent":...}
+  int64_t encode_start = esp_timer_get_time();
+  cJSON* trace_json = cJSON_CreateObject();
+  tracing_inject(*trace_json);
+  char* trace_json_str = cJSON_PrintUnformatted(trace_json);
+  cJSON_Delete(trace_json);
+  if (!trace_json_str) return ESP_ERR_NO_MEM;
+  size_t trace_len = strlen(trace_json_str);
+  size_t suffix_len = snprintf((char*)chunk, sizeof(chunk), "\",\"timestamp_us\":%" PRId64,
+                               stream_frame_timestamp_us(frame));
+  if (trace_len > 2 && suffix_len + trace_len + 1 <= sizeof(chunk)) {
+    chunk[suffix_len++] = ',';
+    memcpy(chunk + suffix_len, trace_json_str + 1, trace_len - 1);
+    suffix_len += trace_len - 1;
+  } else {
+    chunk[suffix_len++] = '}';
+  }
+  cJSON_free(trace_json_str);
+  stats->encode_us += esp_timer_get_time() - encode_start;
+  stats->bytes_copied += suffix_len;
+  return send_stream_fragment(req, HTTPD_WS_TYPE_CONTINUE, chunk, suffix_len, true, stats);
+}
+
+// Sends one JPEG frame as a binary message: stream_frame_header_t followed by
+// the raw JPEG bytes, written straight from the camera frame buffer. The send
+// span's context travels in the header instead of a traceparent string.
+static esp_err_t send_stream_frame_binary(httpd_req_t* req, const camera_fb_t* frame,
+                                          uint32_t sequence,
+                                          const opentelemetry::trace::SpanContext& span_ctx,
+                                          stream_send_stats_t* stats) {
+  int64_t encode_start = esp_timer_get_time();
+  stream_frame_header_t header = {};
+  header.sequence = sequence;
+  header.timestamp_us = stream_frame_timestamp_us(frame);
+  header.length = frame->len;
+  if (span_ctx.IsValid()) {
+    header.flags |= STREAM_FRAME_FLAG_TRACE_CONTEXT;
+    header.trace_flags = span_ctx.trace_flags().flags();
+    span_ctx.trace_id().CopyBytesTo(opentelemetry::nostd::span<uint8_t, 16>(header.trace_id));
+    span_ctx.span_id().CopyBytesTo(opentelemetry::nostd::span<uint8_t, 8>(header.span_id));
+  }
+
+  uint8_t header_buf[STREAM_FRAME_HEADER_SIZE];
+  size_t header_len = encode_stream_frame_header(&header, header_buf, sizeof(header_buf));
+  stats->encode_us += esp_timer_get_time() - encode_start;
+  stats->bytes_copied += header_len;
+  esp_err_t ret =
+      send_stream_fragment(req, HTTPD_WS_TYPE_BINARY, header_buf, header_len, false, stats);
+  if (ret != ESP_OK) return ret;
+  return send_stream_fragment(req, HTTPD_WS_TYPE_CONTINUE, frame->buf, frame->len, true, stats);
+}
+static void stream_frame_release(stream_frame_ref_t* frame) {
+  camera_fb_t* fb = NULL;
+  taskENTER_CRITICAL(&g_stream_lock);
+  if (--frame->refs == 0) {
+    fb = frame->fb;
+    frame->fb = NULL;
+  }
+  taskEXIT_CRITICAL(&g_stream_lock);
+  if (fb) esp_camera_fb_return(fb);
+}
+
+// Sends one frame to one subscriber and records how long it took to get there.
+// pickup_us is when the subscriber's sender took the frame from its slot.
+static esp_err_t stream_send_frame(stream_subscriber_t* sub, const stream_frame_ref_t* ref,
+                                   uint32_t sequence, int64_t pickup_us) {
+  const camera_fb_t* frame = ref->fb;
+  opentelemetry::trace::StartSpanOptions send_opts;
+  send_opts.kind = opentelemetry::trace::SpanKind::kProducer;
+  send_opts.parent = sub->connection_span->GetContext();
+  auto send_span =
+      esp_opentelemetry_tracer()->StartSpan("ws.stream.send",
+                                            {{"ws.url", "/stream"},
+                                             {"network.protocol.name", "websocket"},
+                                             {"ws.message.type", "stream"},
+                                             {"ws.frame.size", static_cast<int64_t>(frame->len)}},
+                                            send_opts);
+  auto send_scope = opentelemetry::trace::Scope(send_span);
+
+  stream_send_stats_t stats = {};
+  esp_err_t ret = ESP_OK;
+  if (sub->format == STREAM_FORMAT_BINARY) {
+    ret = send_stream_frame_binary(sub->req, frame, sequence, send_span->GetContext(), &stats);
+  } else {
+    ret = send_stream_frame_json(sub->req, frame, &stats);
+  }
+  send_span->SetAttribute("ws.message.size", static_cast<int64_t>(stats.message_size));
+  if (ret != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to send stream frame: %s", esp_err_to_name(ret));
+    send_span->SetStatus(opentelemetry::trace::StatusCode::kError,
+                         ret == ESP_ERR_NO_MEM ? "alloc failed" : "ws send failed");
+    send_span->End();
+    web_server_metrics_frame_dropped(ret == ESP_ERR_NO_MEM ? "alloc_failed" : "send_failed");
+    return ret;
+  }
+  send_span->End();
+  int64_t done_us = esp_timer_get_time();
+  web_server_metrics_update(stats.bytes_copied);
+  web_server_metrics_frame_delivered(sub->format == STREAM_FORMAT_BINARY ? "binary" : "json",
+                                     pickup_us - ref->dequeued_us, stats.encode_us,
+                                     done_us - pickup_us - stats.encode_us,
+                                     done_us - stream_frame_timestamp_us(frame));
+  return ESP_OK;
+}
+
+// Releases the subscriber slot once its sender is done with the connection.
+// The camera runs while at least one subscriber is streaming.
+static void stream_subscriber_stop(stream_subscriber_t* sub) {
+  taskENTER_CRITICAL(&g_stream_lock);
+  httpd_req_t* req = sub->req;
+  stream_frame_ref_t* pending = sub->pending;
+  sub->req = NULL;
+  sub->pending = NULL;
+  int remaining = --g_stream_subscriber_count;
+  taskEXIT_CRITICAL(&g_stream_lock);
+
+  if (pending) stream_frame_release(pending);
+  if (httpd_req_async_handler_complete(req) != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to complete async stream req");
+  }
+  if (remaining == 0) camera_stop();
+  web_server_metrics_stream_subscribers(remaining);
+  ESP_LOGI(TAG, "Stream stopped (%d subscribers left)", remaining);
+  if (sub->connection_span) {
+    sub->connection_span->End();
+    sub->connection_span = opentelemetry::nostd::shared_ptr<opentelemetry::trace::Span>{};
+  }
+  taskENTER_CRITICAL(&g_stream_lock);
+  sub->in_use = false;
+  taskEXIT_CRITICAL(&g_stream_lock);
+}
 
+static void ws_stream_sender_task(void* p) {
+  stream_subscriber_t* sub = static_cast<stream_subscriber_t*>(p);
+  while (true) {
+    ulTaskNotifyTakeIndexed(STREAM_START_NOTIFICATION_INDEX, pdTRUE, portMAX_DELAY);
+    taskENTER_CRITICAL(&g_stream_lock);
+    int subscribers = ++g_stream_subscriber_count;
+    taskEXIT_CRITICAL(&g_stream_lock);
+    if (subscribers == 1) camera_start();
+    web_server_metrics_stream_subscribers(subscribers);
+    ESP_LOGI(TAG, "Stream started (%s, %d subscribers)",
+             sub->format == STREAM_FORMAT_BINARY ? "binary" : "json", subscribers);
+
+    uint32_t sequence = 0;
     bool stream_stopped = false;
-    while (xQueueReceive(g_frame_queue, &frame, pdMS_TO_TICKS(100)) != pdPASS) {
-      if (ulTaskNotifyTake(pdTRUE, 0) == 1) {
+    while (true) {
+      uint32_t frame_ready =
+          ulTaskNotifyTakeIndexed(STREAM_FRAME_NOTIFICATION_INDEX, pdTRUE, pdMS_TO_TICKS(100));
+      if (ulTaskNotifyTakeIndexed(STREAM_STOP_NOTIFICATION_INDEX, pdTRUE, 0) == 1) {
         stream_stopped = true;
         break;
       }
+      if (frame_ready == 0) continue;
+
+      taskENTER_CRITICAL(&g_stream_lock);
+      stream_frame_ref_t* frame = sub->pending;
+      sub->pending = NULL;
+      taskEXIT_CRITICAL(&g_stream_lock);
+      if (frame == NULL) continue;
+
+      int64_t send_start = esp_timer_get_time();
+      esp_err_t ret = stream_send_frame(sub, frame, sequence++, send_start);
+      int64_t send_us = esp_timer_get_time() - send_start;
+      taskENTER_CRITICAL(&g_stream_lock);
+      if (send_us > g_stream_peak_send_us) g_stream_peak_send_us = send_us;
+      taskEXIT_CRITICAL(&g_stream_lock);
+      stream_frame_release(frame);
+      // Do NOT notify g_server_task_handle on a send error: no CLOSE handler
+      // is waiting, and a spurious notification would be consumed as a stale
+      // one by the next CLOSE handler, causing it to skip its wait and send on
+      // a dead socket.
+      if (ret != ESP_OK) break;
     }
     if (stream_stopped) {
       // Signal the CLOSE handler before releasing the async handle so it can
       // still send the CLOSE reply while the socket is in a valid async state.
       xTaskNotifyGiveIndexed(g_server_task_handle, CAMERA_STOPPED_NOTIFICATION_INDEX);
-      if (httpd_req_async_handler_complete(req) != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to complete async stream req");
-      }
-      req = NULL;
-      camera_stop();
-      ESP_LOGI(TAG, "Stream stopped");
-      if (g_stream_connection_span) {
-        g_stream_connection_span->End();
-        g_stream_connection_span = opentelemetry::nostd::shared_ptr<opentelemetry::trace::Span>{};
-      }
-      continue;
     }
+    stream_subscriber_stop(sub);
+  }
+}
 
-    if (ulTaskNotifyTake(pdTRUE, 0) == 1) {
-      esp_camera_fb_return(frame);
-      // Signal the CLOSE handler before releasing the async handle so it can
-      // still send the CLOSE reply while the socket is in a valid async state.
-      xTaskNotifyGiveIndexed(g_server_task_handle, CAMERA_STOPPED_NOTIFICATION_INDEX);
-      if (httpd_req_async_handler_complete(req) != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to complete async stream req");
+// Distributes each camera frame to every streaming subscriber. A frame still
+// pending for a subscriber that has not picked it up yet is replaced by the
+// new one (latest frame wins) and counted as dropped. Once per window the
+// send times, drops and RSSI feed the camera's adaptive bitrate controller;
+// with several subscribers the slowest one sets the pace.
+void ws_stream_task(void* p) {
+  ESP_LOGI(TAG, "Starting stream task");
+  camera_frame_t item = {};
+  camera_abr_sample_t abr_sample = {};
+  int64_t abr_window_start = esp_timer_get_time();
+  while (true) {
+    if (xQueueReceive(g_frame_queue, &item, portMAX_DELAY) != pdPASS) {
+      ESP_LOGE(TAG, "xQueueReceive(g_frame_queue) failed");
+      break;
+    }
+    int64_t dequeued_us = esp_timer_get_time();
+    web_server_metrics_frame_dequeued(item.fb_get_us - stream_frame_timestamp_us(item.fb),
+                                      dequeued_us - item.fb_get_us);
+
+    stream_frame_ref_t* frame = NULL;
+    stream_frame_ref_t* replaced[CONFIG_WEB_SERVER_STREAM_MAX_SUBSCRIBERS] = {};
+    TaskHandle_t senders[CONFIG_WEB_SERVER_STREAM_MAX_SUBSCRIBERS] = {};
+    size_t sender_count = 0;
+    taskENTER_CRITICAL(&g_stream_lock);
+    for (auto& slot : g_stream_frames) {
+      if (slot.refs == 0) {
+        frame = &slot;
+        // The distributor holds its own reference until fan-out is done.
+        frame->fb = item.fb;
+        frame->fb_get_us = item.fb_get_us;
+        frame->dequeued_us = dequeued_us;
+        frame->refs = 1;
+        break;
       }
-      req = NULL;
-      camera_stop();
-      ESP_LOGI(TAG, "Stream stopped");
-      if (g_stream_connection_span) {
-        g_stream_connection_span->End();
-        g_stream_connection_span = opentelemetry::nostd::shared_ptr<opentelemetry::trace::Span>{};
+    }
+    if (frame) {
+      for (auto& sub : g_stream_subscribers) {
+        if (!sub.in_use || sub.req == NULL) continue;
+        frame->refs++;
+        replaced[sender_count] = sub.pending;
+        sub.pending = frame;
+        senders[sender_count++] = sub.task;
       }
-      continue;
     }
+    taskEXIT_CRITICAL(&g_stream_lock);
 
-    opentelemetry::trace::StartSpanOptions send_opts;
-    send_opts.kind = opentelemetry::trace::SpanKind::kProducer;
-    send_opts.parent = g_stream_connection_span->GetContext();
-    auto send_span =
-        esp_opentelemetry_tracer()->StartSpan("ws.stream.send",
-                                              {{"ws.url", "/stream"},
-                                               {"network.protocol.name", "websocket"},
-                                               {"ws.message.type", "stream"},
-                                               {"ws.frame.size", static_cast<int64_t>(frame->len)}},
-                                              send_opts);
-    auto send_scope = opentelemetry::trace::Scope(send_span);
-
-    size_t b64_len = 0;
-    mbedtls_base64_encode(NULL, 0, &b64_len, frame->buf, frame->len);
-    char* b64_buf = (char*)heap_caps_malloc(b64_len + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    if (!b64_buf) {
-      ESP_LOGE(TAG, "Failed to allocate base64 buffer");
-      send_span->SetStatus(opentelemetry::trace::StatusCode::kError, "alloc failed");
-      send_span->End();
-      esp_camera_fb_return(frame);
-      if (httpd_req_async_handler_complete(req) != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to complete async stream req");
-      }
-      req = NULL;
-      camera_stop();
-      if (g_stream_connection_span) {
-        g_stream_connection_span->End();
-        g_stream_connection_span = opentelemetry::nostd::shared_ptr<opentelemetry::trace::Span>{};
-      }
-      // No notification: same rationale as the send-error path below.
+    if (frame == NULL) {
+      ESP_LOGW(TAG, "Stream frame pool exhausted, dropping frame");
+      web_server_metrics_frame_dropped("pool_exhausted");
+      esp_camera_fb_return(item.fb);
       continue;
     }
-    mbedtls_base64_encode((unsigned char*)b64_buf, b64_len + 1, &b64_len, frame->buf, frame->len);
-    b64_buf[b64_len] = '\0';
-
-    cJSON* packet_json = cJSON_CreateObject();
-    cJSON_AddStringToObject(packet_json, "data", b64_buf);
-    heap_caps_free(b64_buf);
-    tracing_inject(*packet_json);
-
-    char* packet_json_str = cJSON_PrintUnformatted(packet_json);
-    cJSON_Delete(packet_json);
-
-    httpd_ws_frame_t ws_pkt = {};
-    ws_pkt.type = HTTPD_WS_TYPE_TEXT;
-    ws_pkt.payload = (uint8_t*)packet_json_str;
-    ws_pkt.len = strlen(packet_json_str);
-    send_span->SetAttribute("ws.message.size", static_cast<int64_t>(ws_pkt.len));
-
-    ret = httpd_ws_send_frame(req, &ws_pkt);
-    if (ret != ESP_OK) {
-      ESP_LOGE(TAG, "httpd_ws_send_frame failed: %s", esp_err_to_name(ret));
-      send_span->SetStatus(opentelemetry::trace::StatusCode::kError, "ws send failed");
-      send_span->End();
-      cJSON_free(packet_json_str);
-      esp_camera_fb_return(frame);
-      if (httpd_req_async_handler_complete(req) != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to complete async stream req");
+    for (size_t i = 0; i < sender_count; i++) {
+      if (replaced[i]) {
+        stream_frame_release(replaced[i]);
+        web_server_metrics_frame_dropped("subscriber_busy");
+        abr_sample.dropped++;
       }
-      req = NULL;
-      camera_stop();
-      if (g_stream_connection_span) {
-        g_stream_connection_span->End();
-        g_stream_connection_span = opentelemetry::nostd::shared_ptr<opentelemetry::trace::Span>{};
+      xTaskNotifyGiveIndexed(senders[i], STREAM_FRAME_NOTIFICATION_INDEX);
+    }
+    stream_frame_release(frame);
+
+    abr_sample.frames += sender_count;
+    int64_t now = esp_timer_get_time();
+    if (now - abr_window_start >= STREAM_ABR_WINDOW_US) {
+      // Read and reset together so a send finishing in between is not lost.
+      taskENTER_CRITICAL(&g_stream_lock);
+      abr_sample.peak_send_us = g_stream_peak_send_us;
+      g_stream_peak_send_us = 0;
+      taskEXIT_CRITICAL(&g_stream_lock);
+      if (abr_sample.frames > 0) {
+        abr_sample.rssi_valid = get_rssi(&abr_sample.rssi);
+        camera_abr_update(&abr_sample);
       }
-      // Do NOT notify g_server_task_handle here: no CLOSE handler is waiting,
-      // and a spurious notification would be consumed as a stale one by the next
-      // CLOSE handler, causing it to skip its wait and send on a dead socket.
-      continue;
+      abr_sample = {};
+      abr_window_start = now;
     }
-
-    send_span->End();
-    web_server_metrics_update();
-    cJSON_free(packet_json_str);
-    esp_camera_fb_return(frame);
   }
   ESP_LOGW(TAG, "Stream task stopped");
   vTaskDelete(NULL);
@@ -380,9 +742,20 @@ static esp_err_t telemetry_handle_handshake(httpd_req_t* req) {
   ESP_LOGI(TAG, "Handshake done, the new connection was opened");
   opentelemetry::trace::StartSpanOptions tel_opts;
   tel_opts.kind = opentelemetry::trace::SpanKind::kServer;
+  char query[64] = {};
+  bool has_query = httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK;
+  g_telemetry_batch_mode = parse_telemetry_batch(has_query ? query : NULL);
+  g_telemetry_format = parse_stream_format(has_query ? query : NULL);
   g_telemetry_connection_span = esp_opentelemetry_tracer()->StartSpan(
-      "ws.telemetry.connection", {{"ws.url", "/telemetry"}, {"network.protocol.name", "websocket"}},
+      "ws.telemetry.connection",
+      {{"ws.url", "/telemetry"},
+       {"network.protocol.name", "websocket"},
+       {"telemetry.batch", g_telemetry_batch_mode},
+       {"telemetry.format", g_telemetry_format == STREAM_FORMAT_BINARY ? "binary" : "json"}},
       tel_opts);
+  // Sent before the telemetry task gets the connection, so this is the first
+  // message.
+  if (parse_clock_sync(has_query ? query : NULL)) send_clock_message(req);
   httpd_req_t* copy = NULL;
   esp_err_t ret = httpd_req_async_handler_begin(req, &copy);
   if (ret != ESP_OK) {
@@ -465,10 +838,28 @@ static esp_err_t telemetry_get_handler(httpd_req_t* req) {
   return telemetry_handle_websocket_frame(req);
 }
 
+// Releases the telemetry connection after CLOSE, a send failure or a
+// disconnect, and stops sampling until the next client connects.
+static void telemetry_connection_end(httpd_req_t* req) {
+  if (httpd_req_async_handler_complete(req) != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to complete async telemetry req");
+  }
+  telemetry_stop();
+  ESP_LOGI(TAG, "Telemetry stopped");
+  if (g_telemetry_connection_span) {
+    g_telemetry_connection_span->End();
+    g_telemetry_connection_span = opentelemetry::nostd::shared_ptr<opentelemetry::trace::Span>{};
+  }
+}
+
+// Wakes every CONFIG_WEB_SERVER_TELEMETRY_SEND_PERIOD_MS and drains the
+// telemetry ring: batch clients get every packet published since the previous
+// send in one message, the others only the newest packet.
 void ws_telemetry_task(void* p) {
   ESP_LOGI(TAG, "Starting telemetry WS task");
   esp_err_t ret = ESP_OK;
   httpd_req_t* req = NULL;
+  command_trace_context_t trace = {};
   while (true) {
     if (req == NULL) {
       ESP_LOGI(TAG, "Waiting for notification to start the telemetry");
@@ -476,56 +867,29 @@ void ws_telemetry_task(void* p) {
         ESP_LOGE(TAG, "xQueueReceive(g_telemetry_req_queue) failed");
         break;
       }
+      // Discard what the previous connection left behind.
+      telemetry_ring_pop(g_telemetry_ring, g_telemetry_batch, g_telemetry_batch_size);
+      telemetry_ring_take_dropped(g_telemetry_ring);
       telemetry_start();
       ESP_LOGI(TAG, "Telemetry started");
     }
 
-    telemetry_packet_t packet = {};
-    bool telemetry_stopped = false;
-    while (xQueueReceive(g_telemetry_packet_queue, &packet, pdMS_TO_TICKS(100)) != pdPASS) {
-      if (ulTaskNotifyTake(pdTRUE, 0) == 1) {
-        telemetry_stopped = true;
-        break;
-      }
-    }
-    if (telemetry_stopped) {
+    if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CONFIG_WEB_SERVER_TELEMETRY_SEND_PERIOD_MS)) == 1) {
       // Signal the CLOSE handler before releasing the async handle so it can
       // still send the CLOSE reply while the socket is in a valid async state.
       xTaskNotifyGiveIndexed(g_server_task_handle, TELEMETRY_STOPPED_NOTIFICATION_INDEX);
-      if (httpd_req_async_handler_complete(req) != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to complete async telemetry req");
-      }
+      telemetry_connection_end(req);
       req = NULL;
-      telemetry_stop();
-      ESP_LOGI(TAG, "Telemetry stopped");
-      if (g_telemetry_connection_span) {
-        g_telemetry_connection_span->End();
-        g_telemetry_connection_span =
-            opentelemetry::nostd::shared_ptr<opentelemetry::trace::Span>{};
-      }
       continue;
     }
 
-    if (ulTaskNotifyTake(pdTRUE, 0) == 1) {
-      // Signal the CLOSE handler before releasing the async handle so it can
-      // still send the CLOSE reply while the socket is in a valid async state.
-      xTaskNotifyGiveIndexed(g_server_task_handle, TELEMETRY_STOPPED_NOTIFICATION_INDEX);
-      if (httpd_req_async_handler_complete(req) != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to complete async telemetry req");
-      }
-      req = NULL;
-      telemetry_stop();
-      ESP_LOGI(TAG, "Telemetry stopped");
-      if (g_telemetry_connection_span) {
-        g_telemetry_connection_span->End();
-        g_telemetry_connection_span =
-            opentelemetry::nostd::shared_ptr<opentelemetry::trace::Span>{};
-      }
-      continue;
+    size_t count = telemetry_ring_pop(g_telemetry_ring, g_telemetry_batch, g_telemetry_batch_size);
+    if (count == 0) continue;
+    uint32_t dropped = telemetry_ring_take_dropped(g_telemetry_ring);
+    if (dropped > 0) {
+      ESP_LOGW(TAG, "Telemetry ring overflowed, %u packets dropped", (unsigned)dropped);
     }
 
-    cJSON* packet_json = convert_telemetry_packet_to_json(packet);
-
     opentelemetry::trace::StartSpanOptions send_opts;
     send_opts.kind = opentelemetry::trace::SpanKind::kProducer;
     send_opts.parent = g_telemetry_connection_span->GetContext();
@@ -535,14 +899,47 @@ void ws_telemetry_task(void* p) {
                                                             {"ws.message.type", "telemetry"}},
                                                            send_opts);
     auto send_scope = opentelemetry::trace::Scope(send_span);
-    tracing_inject(*packet_json);
-
-    char* packet_json_str = cJSON_PrintUnformatted(packet_json);
+    send_span->SetAttribute("telemetry.packets", static_cast<int64_t>(count));
+    send_span->SetAttribute("telemetry.dropped", static_cast<int64_t>(dropped));
 
+    // The send span's context travels with the message: in the header of
+    // binary messages, as an injected traceparent in JSON ones.
     httpd_ws_frame_t ws_pkt = {};
-    ws_pkt.type = HTTPD_WS_TYPE_TEXT;
-    ws_pkt.payload = (uint8_t*)packet_json_str;
-    ws_pkt.len = strlen(packet_json_str);
+    if (g_telemetry_format == STREAM_FORMAT_BINARY) {
+      telemetry_binary_header_t header = {};
+      header.dropped = dropped;
+      auto span_ctx = send_span->GetContext();
+      if (span_ctx.IsValid()) {
+        header.flags |= TELEMETRY_BINARY_FLAG_TRACE_CONTEXT;
+        header.trace_flags = span_ctx.trace_flags().flags();
+        span_ctx.trace_id().CopyBytesTo(opentelemetry::nostd::span<uint8_t, 16>(header.trace_id));
+        span_ctx.span_id().CopyBytesTo(opentelemetry::nostd::span<uint8_t, 8>(header.span_id));
+      }
+      ws_pkt.type = HTTPD_WS_TYPE_BINARY;
+      ws_pkt.payload = g_telemetry_binary;
+      ws_pkt.len = encode_telemetry_binary(&header, g_telemetry_batch, count, g_telemetry_binary,
+                                           g_telemetry_binary_size);
+    } else {
+      // Formatted straight into the preallocated buffer: no cJSON tree and no
+      // heap allocation per message.
+      tracing_inject(trace.traceparent, sizeof(trace.traceparent), trace.tracestate,
+                     sizeof(trace.tracestate));
+      ws_pkt.type = HTTPD_WS_TYPE_TEXT;
+      ws_pkt.payload = (uint8_t*)g_telemetry_json;
+      ws_pkt.len = g_telemetry_batch_mode
+                       ? write_telemetry_batch_json(g_telemetry_batch, count, dropped,
+                                                    trace.traceparent, trace.tracestate,
+                                                    g_telemetry_json, g_telemetry_json_size)
+                       : write_telemetry_packet_json(g_telemetry_batch[count - 1],
+                                                     trace.traceparent, trace.tracestate,
+                                                     g_telemetry_json, g_telemetry_json_size);
+    }
+    if (ws_pkt.len == 0) {
+      ESP_LOGE(TAG, "Telemetry message does not fit its buffer");
+      send_span->SetStatus(opentelemetry::trace::StatusCode::kError, "encode failed");
+      send_span->End();
+      continue;
+    }
     send_span->SetAttribute("ws.message.size", static_cast<int64_t>(ws_pkt.len));
 
     ret = httpd_ws_send_frame(req, &ws_pkt);
@@ -550,18 +947,8 @@ void ws_telemetry_task(void* p) {
       ESP_LOGE(TAG, "httpd_ws_send_frame failed with %d", ret);
       send_span->SetStatus(opentelemetry::trace::StatusCode::kError, "ws send failed");
       send_span->End();
-      cJSON_free(packet_json_str);
-      cJSON_Delete(packet_json);
-      if (httpd_req_async_handler_complete(req) != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to complete async telemetry req");
-      }
+      telemetry_connection_end(req);
       req = NULL;
-      telemetry_stop();
-      if (g_telemetry_connection_span) {
-        g_telemetry_connection_span->End();
-        g_telemetry_connection_span =
-            opentelemetry::nostd::shared_ptr<opentelemetry::trace::Span>{};
-      }
       // Do NOT notify g_server_task_handle here: no CLOSE handler is waiting,
       // and a spurious notification would be consumed as a stale one by the next
       // CLOSE handler, causing it to skip its wait and send on a dead socket.
@@ -569,8 +956,6 @@ void ws_telemetry_task(void* p) {
     }
 
     send_span->End();
-    cJSON_free(packet_json_str);
-    cJSON_Delete(packet_json);
   }
   ESP_LOGW(TAG, "Telemetry task stopped");
   vTaskDelete(NULL);
@@ -590,7 +975,9 @@ static const httpd_uri_t telemetry = {
 static httpd_handle_t start_web_server() {
   httpd_config_t config = HTTPD_DEFAULT_CONFIG();
   config.lru_purge_enable = true;
-  config.max_open_sockets = 3;
+  // Control, telemetry and up to CONFIG_WEB_SERVER_STREAM_MAX_SUBSCRIBERS
+  // stream clients; must stay below CONFIG_LWIP_MAX_SOCKETS - 3.
+  config.max_open_sockets = CONFIG_WEB_SERVER_MAX_OPEN_SOCKETS;
   // 8 KB is insufficient for root_get_handler with tracing_extract + StartSpan.
   config.stack_size = 16384;
 
@@ -635,29 +1022,66 @@ static void web_server_handler_on_wifi_disconnect(void* arg, esp_event_base_t ev
   }
 }
 
-void web_server_setup(QueueHandle_t frame_queue, QueueHandle_t command_queue,
-                      QueueHandle_t telemetry_queue) {
+void web_server_setup(QueueHandle_t frame_queue, telemetry_ring_t* telemetry_ring) {
   g_frame_queue = frame_queue;
-  g_command_queue = command_queue;
-  g_telemetry_packet_queue = telemetry_queue;
+  g_telemetry_ring = telemetry_ring;
+  g_telemetry_batch_size = telemetry_ring_capacity(telemetry_ring);
+  g_telemetry_batch = static_cast<telemetry_packet_t*>(
+      heap_caps_malloc_prefer(g_telemetry_batch_size * sizeof(telemetry_packet_t), 2,
+                              MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT, MALLOC_CAP_DEFAULT));
+  g_telemetry_binary_size = TELEMETRY_BINARY_HEADER_SIZE + TELEMETRY_BINARY_TRACE_CONTEXT_SIZE +
+                            g_telemetry_batch_size * TELEMETRY_BINARY_RECORD_MAX_SIZE;
+  g_telemetry_binary = static_cast<uint8_t*>(
+      heap_caps_malloc_prefer(g_telemetry_binary_size, 2, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT,
+                              MALLOC_CAP_DEFAULT));
+  // {"packets":[...],"dropped":4294967295} around the packets and their commas.
+  g_telemetry_json_size = 48 + g_telemetry_batch_size * (TELEMETRY_JSON_PACKET_MAX_SIZE + 1) +
+                          TELEMETRY_JSON_TRACE_CONTEXT_MAX_SIZE;
+  g_telemetry_json = static_cast<char*>(heap_caps_malloc_prefer(
+      g_telemetry_json_size, 2, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT, MALLOC_CAP_DEFAULT));
+  if (!g_telemetry_batch || !g_telemetry_binary || !g_telemetry_json) {
+    ESP_LOGE(TAG, "Failed to allocate the telemetry batch buffers");
+    return;
+  }
 
-  g_stream_req_queue = xQueueCreate(1, sizeof(httpd_req_t*));
   g_telemetry_req_queue = xQueueCreate(1, sizeof(httpd_req_t*));
 
+  for (size_t i = 0; i < CONFIG_WEB_SERVER_STREAM_MAX_SUBSCRIBERS; i++) {
+    // Allocate each sender's stack from PSRAM: the on-stack base64 chunk buffer
+    // plus cJSON trace injection and OTel span creation exhaust an 8KB DRAM stack.
+    StackType_t* sender_stack =
+        static_cast<StackType_t*>(heap_caps_malloc(32768, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+    StaticTask_t* sender_tcb = static_cast<StaticTask_t*>(
+        heap_caps_malloc(sizeof(StaticTask_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+    if (!sender_stack || !sender_tcb) {
+      ESP_LOGE(TAG, "xTaskCreate(ws_stream_sender_task) failed - no PSRAM");
+      return;
+    }
+    char name[configMAX_TASK_NAME_LEN];
+    snprintf(name, sizeof(name), "ws_stream_tx%u", static_cast<unsigned>(i));
+    g_stream_subscribers[i].task = xTaskCreateStaticPinnedToCore(
+        ws_stream_sender_task, name, 32768 / sizeof(StackType_t), &g_stream_subscribers[i], 1,
+        sender_stack, sender_tcb, tskNO_AFFINITY);
+  }
   {
-    // Allocate ws_stream_task stack from PSRAM: base64 encoding of VGA JPEG frames plus
-    // cJSON serialization and OTel span creation exhaust an 8KB DRAM stack.
+    // Besides moving frame references around, the distributor records the
+    // stage histograms and drop counters through the OTel SDK and, once per
+    // window, runs the adaptive bitrate controller (RSSI query, sensor
+    // reconfiguration over SCCB, logging), which overflows a 4KB DRAM stack.
+    // Its stack comes from PSRAM like the senders'. It runs above the senders
+    // so the camera queue is drained even while every subscriber is busy
+    // sending.
     StackType_t* stream_stack =
-        static_cast<StackType_t*>(heap_caps_malloc(32768, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+        static_cast<StackType_t*>(heap_caps_malloc(16384, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
     StaticTask_t* stream_tcb = static_cast<StaticTask_t*>(
         heap_caps_malloc(sizeof(StaticTask_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
     if (!stream_stack || !stream_tcb) {
       ESP_LOGE(TAG, "xTaskCreate(ws_stream_task) failed - no PSRAM");
       return;
     }
-    g_stream_task_handle =
-        xTaskCreateStaticPinnedToCore(ws_stream_task, "ws_stream_task", 32768 / sizeof(StackType_t),
-                                      nullptr, 1, stream_stack, stream_tcb, tskNO_AFFINITY);
+    g_stream_task_handle = xTaskCreateStaticPinnedToCore(ws_stream_task, "ws_stream_task",
+                                                         16384 / sizeof(StackType_t), nullptr, 2,
+                                                         stream_stack, stream_tcb, tskNO_AFFINITY);
   }
   {
     // Allocate ws_telemetry_task stack from PSRAM to avoid exhausting internal DRAM.
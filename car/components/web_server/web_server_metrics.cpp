@@ -3,6 +3,10 @@
 
 #ifdef CONFIG_ESP_OPENTELEMETRY_METRICS_ENABLED
 #include <cstdint>
+#include "metrics.hpp"
+#include "opentelemetry/context/context.h"
+#include "opentelemetry/metrics/async_instruments.h"
+#include "opentelemetry/metrics/observer_result.h"
 #include "opentelemetry/metrics/provider.h"
 #include "opentelemetry/nostd/shared_ptr.h"
 
@@ -10,7 +14,53 @@ namespace metrics_api = opentelemetry::metrics;
 
 namespace {
 static opentelemetry::nostd::shared_ptr<metrics_api::Counter<uint64_t>> s_frames_sent;
+static opentelemetry::nostd::shared_ptr<metrics_api::ObservableInstrument> s_bytes_copied;
+static opentelemetry::nostd::shared_ptr<metrics_api::Counter<uint64_t>> s_frames_dropped;
+static opentelemetry::nostd::shared_ptr<metrics_api::ObservableInstrument> s_stream_subscribers;
+static opentelemetry::nostd::shared_ptr<metrics_api::Histogram<double>> s_stage_capture;
+static opentelemetry::nostd::shared_ptr<metrics_api::Histogram<double>> s_stage_queue;
+static opentelemetry::nostd::shared_ptr<metrics_api::Histogram<double>> s_stage_fanout;
+static opentelemetry::nostd::shared_ptr<metrics_api::Histogram<double>> s_stage_encode;
+static opentelemetry::nostd::shared_ptr<metrics_api::Histogram<double>> s_stage_send;
+static opentelemetry::nostd::shared_ptr<metrics_api::Histogram<double>> s_frame_latency;
+
+// Peak bytes a stream sender copied into its own buffers for a single frame
+// since the last metric collection; reset on read. A zero-copy binary frame
+// only copies its header, a JSON frame copies its base64 text. Written by
+// the stream sender tasks, read+reset by the metric-reader thread; a stale or lost
+// sample is harmless for this metric, so no atomics/locking needed.
+static size_t s_peak_bytes_copied = 0;
+
+static void cb_bytes_copied(metrics_api::ObserverResult obs, void*) {
+  size_t peak = s_peak_bytes_copied;
+  s_peak_bytes_copied = 0;
+  observe_int64(obs, static_cast<int64_t>(peak));
+}
+
+// Written by the stream sender tasks on connect/disconnect.
+static int s_subscriber_count = 0;
+
+static void cb_stream_subscribers(metrics_api::ObserverResult obs, void*) {
+  observe_int64(obs, static_cast<int64_t>(s_subscriber_count));
+}
+
+// Stages are recorded in milliseconds: the SDK's default bucket boundaries
+// (0 to 10000) then span everything from a sub-frame wait to a stalled send.
+static opentelemetry::nostd::shared_ptr<metrics_api::Histogram<double>> create_stage_histogram(
+    metrics_api::Meter& meter, const char* name, const char* description) {
+  return meter.CreateDoubleHistogram(name, description, "ms");
+}
+
+static void record_ms(metrics_api::Histogram<double>* histogram, int64_t value_us) {
+  if (histogram) histogram->Record(value_us / 1000.0, opentelemetry::context::Context{});
+}
+
+static void record_ms(metrics_api::Histogram<double>* histogram, const char* format,
+                      int64_t value_us) {
+  if (!histogram) return;
+  histogram->Record(value_us / 1000.0, {{"format", format}}, opentelemetry::context::Context{});
 }
+}  // namespace
 #endif  // CONFIG_ESP_OPENTELEMETRY_METRICS_ENABLED
 
 void web_server_metrics_setup() {
@@ -19,11 +69,86 @@ void web_server_metrics_setup() {
       CONFIG_ESP_OPENTELEMETRY_SERVICE_NAME, "1.0.0");
   s_frames_sent = meter->CreateUInt64Counter("dust_mite.frames_sent",
                                              "Camera frames sent to client", "{frame}");
+
+  s_bytes_copied = meter->CreateInt64ObservableGauge(
+      "dust_mite.stream.bytes_copied_per_frame",
+      "Peak bytes copied by the stream sender for one frame since last collection", "By");
+  s_bytes_copied->AddCallback(cb_bytes_copied, nullptr);
+
+  s_frames_dropped = meter->CreateUInt64Counter(
+      "dust_mite.stream.frames_dropped", "Camera frames not delivered to a stream client", "{frame}");
+
+  s_stream_subscribers = meter->CreateInt64ObservableGauge(
+      "dust_mite.stream.subscribers", "Clients currently receiving the camera stream", "{client}");
+  s_stream_subscribers->AddCallback(cb_stream_subscribers, nullptr);
+
+  s_stage_capture = create_stage_histogram(
+      *meter, "dust_mite.stream.stage.capture",
+      "Time from the start of a frame's capture until camera_task got it from the driver");
+  s_stage_queue = create_stage_histogram(
+      *meter, "dust_mite.stream.stage.queue",
+      "Time a frame waited in the frame queue for the stream distributor");
+  s_stage_fanout = create_stage_histogram(
+      *meter, "dust_mite.stream.stage.fanout",
+      "Time from fan-out until a subscriber's sender picked the frame up");
+  s_stage_encode = create_stage_histogram(*meter, "dust_mite.stream.stage.encode",
+                                          "Time spent encoding a frame for one subscriber");
+  s_stage_send = create_stage_histogram(
+      *meter, "dust_mite.stream.stage.send",
+      "Time spent writing a frame to one subscriber's socket, excluding encoding");
+  s_frame_latency = create_stage_histogram(
+      *meter, "dust_mite.stream.frame_latency",
+      "Time from the start of a frame's capture until its last fragment was written");
 #endif
 }
 
-void web_server_metrics_update() {
+void web_server_metrics_update(size_t bytes_copied) {
 #ifdef CONFIG_ESP_OPENTELEMETRY_METRICS_ENABLED
   if (s_frames_sent) s_frames_sent->Add(1);
+  if (bytes_copied > s_peak_bytes_copied) s_peak_bytes_copied = bytes_copied;
+#else
+  (void)bytes_copied;
+#endif
+}
+
+void web_server_metrics_frame_dropped(const char* reason) {
+#ifdef CONFIG_ESP_OPENTELEMETRY_METRICS_ENABLED
+  if (s_frames_dropped) s_frames_dropped->Add(1, {{"reason", reason}});
+#else
+  (void)reason;
+#endif
+}
+
+void web_server_metrics_stream_subscribers(int count) {
+#ifdef CONFIG_ESP_OPENTELEMETRY_METRICS_ENABLED
+  s_subscriber_count = count;
+#else
+  (void)count;
+#endif
+}
+
+void web_server_metrics_frame_dequeued(int64_t capture_us, int64_t queue_us) {
+#ifdef CONFIG_ESP_OPENTELEMETRY_METRICS_ENABLED
+  record_ms(s_stage_capture.get(), capture_us);
+  record_ms(s_stage_queue.get(), queue_us);
+#else
+  (void)capture_us;
+  (void)queue_us;
+#endif
+}
+
+void web_server_metrics_frame_delivered(const char* format, int64_t fanout_us, int64_t encode_us,
+                                        int64_t send_us, int64_t total_us) {
+#ifdef CONFIG_ESP_OPENTELEMETRY_METRICS_ENABLED
+  record_ms(s_stage_fanout.get(), format, fanout_us);
+  record_ms(s_stage_encode.get(), format, encode_us);
+  record_ms(s_stage_send.get(), format, send_us);
+  record_ms(s_frame_latency.get(), format, total_us);
+#else
+  (void)format;
+  (void)fanout_us;
+  (void)encode_us;
+  (void)send_us;
+  (void)total_us;
 #endif
 }
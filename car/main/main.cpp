@@ -10,6 +10,8 @@
 #include "web_server.hpp"
 #include "web_server_metrics.hpp"
 #include "motor.hpp"
+#include "speed_control.hpp"
+#include "motor_metrics.hpp"
 #include "telemetry.hpp"
 #include "telemetry_metrics.hpp"
 #include "tracing.hpp"
@@ -31,9 +33,8 @@ static i2c_master_bus_handle_t i2c_bus_init() {
 }
 
 extern "C" void app_main() {
-  QueueHandle_t command_queue = xQueueCreate(2, sizeof(command_packet_t));
-  QueueHandle_t frame_queue = xQueueCreate(2, sizeof(camera_fb_t*));
-  QueueHandle_t telemetry_queue = xQueueCreate(2, sizeof(telemetry_packet_t));
+  QueueHandle_t frame_queue = xQueueCreate(CAMERA_FRAME_QUEUE_DEPTH, sizeof(camera_frame_t));
+  telemetry_ring_t* telemetry_ring = telemetry_ring_create(CONFIG_TELEMETRY_RING_CAPACITY);
 
   i2c_master_bus_handle_t i2c_bus = i2c_bus_init();
 
@@ -41,10 +42,11 @@ extern "C" void app_main() {
   wifi_wait_for_ip();
   sync_time();
 
-  motor_setup(command_queue);
+  motor_setup();
   camera_setup(frame_queue, i2c_bus);
-  telemetry_setup(telemetry_queue, i2c_bus);
-  web_server_setup(frame_queue, command_queue, telemetry_queue);
+  telemetry_setup(telemetry_ring, i2c_bus);
+  speed_control_setup(get_encoder_count, pps_to_kph);
+  web_server_setup(frame_queue, telemetry_ring);
 
   tracing_setup();
 
@@ -53,4 +55,5 @@ extern "C" void app_main() {
   telemetry_metrics_setup();
   camera_metrics_setup();
   web_server_metrics_setup();
+  motor_metrics_setup();
 }
@@ -6,9 +6,11 @@
 #include "camera.hpp"
 #include "web_server.hpp"
 #include "motor.hpp"
+#include "speed_control.hpp"
 #include "telemetry.hpp"
 #include "tracing.hpp"
 #include "wifi.hpp"
+#include "sdkconfig.h"
 
 static const char* TAG = "integration_test";
 
@@ -26,20 +28,20 @@ static i2c_master_bus_handle_t i2c_bus_init() {
 }
 
 extern "C" void app_main() {
-  QueueHandle_t command_queue = xQueueCreate(2, sizeof(command_packet_t));
-  QueueHandle_t frame_queue = xQueueCreate(2, sizeof(camera_fb_t*));
-  QueueHandle_t telemetry_queue = xQueueCreate(2, sizeof(telemetry_packet_t));
+  QueueHandle_t frame_queue = xQueueCreate(2, sizeof(camera_frame_t));
+  telemetry_ring_t* telemetry_ring = telemetry_ring_create(CONFIG_TELEMETRY_RING_CAPACITY);
 
   i2c_master_bus_handle_t i2c_bus = i2c_bus_init();
 
-  motor_setup(command_queue);
+  motor_setup();
   wifi_setup();
   wifi_wait_for_ip();
   sync_time();
   tracing_setup();
   camera_setup(frame_queue, i2c_bus);
-  telemetry_setup(telemetry_queue, i2c_bus);
-  web_server_setup(frame_queue, command_queue, telemetry_queue);
+  telemetry_setup(telemetry_ring, i2c_bus);
+  speed_control_setup(get_encoder_count, pps_to_kph);
+  web_server_setup(frame_queue, telemetry_ring);
 
   ESP_LOGI(TAG, "integration test app ready");
 }
@@ -1,6 +1,7 @@
 import asyncio
 import base64
 import json
+import struct
 import time
 
 import pytest
@@ -23,6 +24,50 @@ def test_command_pipeline(dut: Dut) -> None:
     dut.expect(r'JSON=\{"command": 3, "value": 0\}', timeout=5)
 
 
+def test_binary_command_pipeline(dut: Dut) -> None:
+    """Binary command frame -> web server -> same motor mailbox as JSON."""
+    ip = get_dut_ip(dut)
+    dut.expect(r'Registering URI handlers', timeout=70)
+    # opcode u8, flags u8, value i16, sequence u32 (little-endian)
+    frame = struct.pack('<BBhI', 3, 0, 0, 42)
+
+    async def run():
+        async with websockets.connect(f'ws://{ip}/') as ws:
+            await ws.send(frame)
+
+    asyncio.run(run())
+    dut.expect(r'BINARY=\{"command": 3, "value": 0, "sequence": 42\}', timeout=5)
+    dut.expect(r'COMMAND_BRAKE', timeout=5)
+
+
+def test_drive_and_look_command(dut: Dut) -> None:
+    """One DRIVE_AND_LOOK command moves the wheels and both servos in the same iteration."""
+    ip = get_dut_ip(dut)
+    dut.expect(r'Registering URI handlers', timeout=70)
+
+    async def run():
+        async with websockets.connect(f'ws://{ip}/') as ws:
+            await ws.send(json.dumps({"command": 8, "throttle": 0, "steering": 0, "pan": 30, "tilt": -10}))
+
+    asyncio.run(run())
+    dut.expect(r'COMMAND_DRIVE_AND_LOOK: 0 0', timeout=5)
+    dut.expect(r'COMMAND_LOOK_HORIZONTALLY: 30', timeout=5)
+    dut.expect(r'COMMAND_LOOK_VERTICALLY: -10', timeout=5)
+
+
+def test_cruise_command(dut: Dut) -> None:
+    """CRUISE with a zero target stops the speed loop and brakes."""
+    ip = get_dut_ip(dut)
+    dut.expect(r'Registering URI handlers', timeout=70)
+
+    async def run():
+        async with websockets.connect(f'ws://{ip}/') as ws:
+            await ws.send(json.dumps({"command": 9, "value": 0}))
+
+    asyncio.run(run())
+    dut.expect(r'COMMAND_CRUISE: 0', timeout=5)
+
+
 def test_telemetry_disconnect(dut: Dut) -> None:
     """Clean disconnect from /telemetry must not produce send errors in the firmware.
 
@@ -72,16 +117,88 @@ def test_telemetry_pipeline(dut: Dut) -> None:
     packets = asyncio.run(run())
     assert len(packets) == 3
 
-    required = {'timestamp', 'rssi', 'speed', 'accelerometer',
-                'magnetometer', 'gyroscope', 'distance_ahead'}
+    required = {'timestamp_us', 'rssi', 'speed', 'accelerometer',
+                'magnetometer', 'gyroscope', 'distance_ahead', 'orientation'}
     for pkt in packets:
         assert required <= pkt.keys(), f'missing keys: {required - pkt.keys()}'
         for vec in ('accelerometer', 'magnetometer', 'gyroscope'):
             assert {'x', 'y', 'z'} <= pkt[vec].keys()
+        assert {'roll', 'pitch', 'yaw'} <= pkt['orientation'].keys()
+
+    timestamps = [pkt['timestamp_us'] for pkt in packets]
+    assert all(isinstance(ts, int) and ts > 0 for ts in timestamps), \
+        'timestamps must be positive microsecond counts'
+    assert timestamps == sorted(timestamps), 'timestamps must increase'
+
+
+def test_telemetry_batch(dut: Dut) -> None:
+    """/telemetry?batch=1 delivers every packet published since the last send."""
+    ip = get_dut_ip(dut)
+    dut.expect(r'Starting telemetry task', timeout=70)
+
+    async def run():
+        async with websockets.connect(f'ws://{ip}/telemetry?batch=1') as ws:
+            await asyncio.wait_for(ws.recv(), timeout=5)
+            raw = await asyncio.wait_for(ws.recv(), timeout=5)
+            return json.loads(raw)
+
+    batch = asyncio.run(run())
+    assert {'packets', 'dropped'} <= batch.keys()
+    # Packets are published every 100 ms and sent every 500 ms.
+    assert len(batch['packets']) >= 3
+    assert batch['dropped'] == 0
+    for pkt in batch['packets']:
+        assert {'timestamp_us', 'rssi', 'speed', 'orientation'} <= pkt.keys()
+    timestamps = [pkt['timestamp_us'] for pkt in batch['packets']]
+    # Published every 100 ms on the esp_timer clock.
+    for previous, current in zip(timestamps, timestamps[1:]):
+        assert 50_000 <= current - previous <= 200_000
+
+
+def test_telemetry_binary(dut: Dut) -> None:
+    """/telemetry?format=binary sends batches in the compact binary encoding."""
+    ip = get_dut_ip(dut)
+    dut.expect(r'Starting telemetry task', timeout=70)
+
+    async def run():
+        async with websockets.connect(f'ws://{ip}/telemetry?format=binary') as ws:
+            await asyncio.wait_for(ws.recv(), timeout=5)
+            return await asyncio.wait_for(ws.recv(), timeout=5)
+
+    msg = asyncio.run(run())
+    assert isinstance(msg, bytes), 'expected a binary frame'
+    version, flags, count, dropped, timestamp_us = struct.unpack_from('<BBHIq', msg)
+    assert version == 1
+    assert count >= 3
+    assert dropped == 0
+    assert timestamp_us > 0
+    header_size = 16 + (25 if flags & 0x01 else 0)
+    # 17 varint fields per packet, at least one byte each.
+    assert len(msg) >= header_size + count * 17
+
+
+def test_clock_sync(dut: Dut) -> None:
+    """clock=1 makes the first message map the car's esp_timer clock to Unix time."""
+    ip = get_dut_ip(dut)
+    dut.expect(r'Starting telemetry task', timeout=70)
+
+    async def run():
+        async with websockets.connect(f'ws://{ip}/telemetry?clock=1') as ws:
+            clock = json.loads(await asyncio.wait_for(ws.recv(), timeout=5))
+            packet = json.loads(await asyncio.wait_for(ws.recv(), timeout=5))
+        async with websockets.connect(f'ws://{ip}/stream?clock=1') as ws:
+            stream_clock = json.loads(await asyncio.wait_for(ws.recv(), timeout=5))
+            frame = json.loads(await asyncio.wait_for(ws.recv(), timeout=5))
+        return clock['clock'], packet, stream_clock['clock'], frame
 
-    timestamps = [pkt['timestamp'] for pkt in packets]
-    assert all(isinstance(ts, str) and len(ts) > 0 for ts in timestamps), \
-        'timestamps must be non-empty strings'
+    clock, packet, stream_clock, frame = asyncio.run(run())
+    # The integration app syncs with SNTP before starting the servers.
+    assert clock['epoch_offset_us'] > 0
+    assert packet['timestamp_us'] >= clock['timestamp_us']
+    wall_s = (packet['timestamp_us'] + clock['epoch_offset_us']) / 1e6
+    assert abs(wall_s - time.time()) < 60, 'car clock must map to wall time'
+    assert stream_clock['timestamp_us'] > clock['timestamp_us']
+    assert frame['timestamp_us'] > 0
 
 
 def test_stream_pipeline(dut: Dut) -> None:
@@ -92,16 +209,76 @@ def test_stream_pipeline(dut: Dut) -> None:
 
     async def run():
         frames = []
+        timestamps = []
         start = time.monotonic()
         async with websockets.connect(f'ws://{ip}/stream') as ws:
             while len(frames) < frame_count:
-                raw = await asyncio.wait_for(ws.recv(), timeout=5)
-                frames.append(base64.b64decode(json.loads(raw)['data']))
+                packet = json.loads(await asyncio.wait_for(ws.recv(), timeout=5))
+                frames.append(base64.b64decode(packet['data']))
+                timestamps.append(packet['timestamp_us'])
         elapsed = time.monotonic() - start
-        return frames, elapsed
+        return frames, timestamps, elapsed
 
-    frames, elapsed = asyncio.run(run())
+    frames, timestamps, elapsed = asyncio.run(run())
+    assert timestamps == sorted(timestamps), 'capture timestamps must increase'
 
     for i, frame in enumerate(frames):
         assert frame[:2] == b'\xff\xd8', f'frame {i}: missing JPEG SOI'
         assert frame[-2:] == b'\xff\xd9', f'frame {i}: missing JPEG EOI'
+
+
+def test_stream_binary_pipeline(dut: Dut) -> None:
+    """Camera -> frame queue -> web server -> binary header + raw JPEG frames."""
+    ip = get_dut_ip(dut)
+    dut.expect(r'Registering URI handlers', timeout=70)
+    frame_count = 10
+    header = struct.Struct('<BBBBIqI16s8s')
+
+    async def run():
+        messages = []
+        async with websockets.connect(f'ws://{ip}/stream?format=binary') as ws:
+            while len(messages) < frame_count:
+                messages.append(await asyncio.wait_for(ws.recv(), timeout=5))
+        return messages
+
+    messages = asyncio.run(run())
+
+    sequences = []
+    for i, raw in enumerate(messages):
+        assert isinstance(raw, bytes), f'frame {i}: expected a binary message'
+        version, header_size, _, _, sequence, _, length, _, _ = header.unpack_from(raw)
+        assert version == 1
+        assert header_size == header.size
+        frame = raw[header_size:]
+        assert len(frame) == length, f'frame {i}: length mismatch'
+        assert frame[:2] == b'\xff\xd8', f'frame {i}: missing JPEG SOI'
+        assert frame[-2:] == b'\xff\xd9', f'frame {i}: missing JPEG EOI'
+        sequences.append(sequence)
+
+    assert sequences == sorted(sequences), 'sequence numbers must increase'
+
+
+def test_stream_fan_out(dut: Dut) -> None:
+    """One camera feed delivered to several /stream clients; a stalled client
+    drops its own frames without holding back the others."""
+    ip = get_dut_ip(dut)
+    dut.expect(r'Registering URI handlers', timeout=70)
+    frame_count = 10
+
+    async def run():
+        frames = []
+        async with websockets.connect(f'ws://{ip}/stream?format=binary') as slow, \
+                websockets.connect(f'ws://{ip}/stream') as fast:
+            await asyncio.wait_for(slow.recv(), timeout=5)
+            # Stop reading from the slow client while the fast one keeps going.
+            while len(frames) < frame_count:
+                raw = await asyncio.wait_for(fast.recv(), timeout=5)
+                frames.append(base64.b64decode(json.loads(raw)['data']))
+            slow_frame = await asyncio.wait_for(slow.recv(), timeout=5)
+        return frames, slow_frame
+
+    frames, slow_frame = asyncio.run(run())
+
+    for i, frame in enumerate(frames):
+        assert frame[:2] == b'\xff\xd8', f'frame {i}: missing JPEG SOI'
+    assert isinstance(slow_frame, bytes), 'slow client must still receive binary frames'
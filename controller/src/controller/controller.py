@@ -3,6 +3,7 @@
 import json
 import logging
 import os
+from dataclasses import dataclass
 from enum import Enum
 
 import websockets.sync.client
@@ -28,6 +29,21 @@ class Command(Enum):
     TURN_RIGHT = 5
     LOOK_HORIZONTALLY = 6
     LOOK_VERTICALLY = 7
+    DRIVE_AND_LOOK = 8
+
+
+@dataclass(frozen=True)
+class DriveAndLook:
+    """Operator input sent as a single DRIVE_AND_LOOK command.
+
+    The car applies drive, pan and tilt together, so driving and looking
+    around never interleave.
+    """
+
+    throttle: int = 0  # -100..100, negative drives backwards
+    steering: int = 0  # -100..100, negative turns left
+    pan: int = 0  # -90..90 degrees, negative looks left
+    tilt: int = 0  # -90..90 degrees, negative looks down
 
 
 def interpolate(
@@ -37,75 +53,71 @@ def interpolate(
     return (value - in_min) * (out_max - out_min) / (in_max - in_min) + out_min
 
 
-@tracer.start_as_current_span("controller.send_command")
-def send_command(
-    ws_conn: websockets.sync.client.ClientConnection,
-    command: Command,
-    value: int | None,
+@tracer.start_as_current_span("controller.send_drive_and_look")
+def send_drive_and_look(
+    ws_conn: websockets.sync.client.ClientConnection, state: DriveAndLook
 ) -> None:
-    """Send a command to the car."""
+    """Send the whole operator input to the car as one command."""
     span = trace.get_current_span()
     span.set_attribute("network.protocol.name", "websocket")
-    span.set_attribute("command_name", command.name)
-    if value is not None:
-        span.set_attribute("command_value", value)
-
-    payload = {"command": command.value, "value": value}
+    span.set_attribute("command_name", Command.DRIVE_AND_LOOK.name)
+
+    payload = {
+        "command": Command.DRIVE_AND_LOOK.value,
+        "throttle": state.throttle,
+        "steering": state.steering,
+        "pan": state.pan,
+        "tilt": state.tilt,
+    }
     payload = inject_trace_context(payload)
 
     ws_conn.send(json.dumps(payload))
 
 
-def read_input(ds: pydualsense, analog_dead_zone: int) -> tuple[Command, int | None]:
-    """Read DualSense state and return the current command and value."""
-    command = Command.BRAKE
-    value = None
+def read_input(ds: pydualsense, analog_dead_zone: int) -> DriveAndLook:
+    """Read DualSense state and return the current drive and camera input.
 
-    # TODO: Split car and camera commands
-    # Currently there is no way to drive a car and look around
-    # What's more, you can't look horizontally and vertically and the same time
-    if ds.state.DpadUp > 0:
-        command, value = Command.ADVANCE, 50
-    elif ds.state.DpadRight:
-        command, value = Command.TURN_RIGHT, 50
+    The D-pad and R2 drive, the left stick steers and the right stick moves
+    the camera; all of them can be used at the same time.
+    """
+
+    def stick(value: int) -> int:
+        return 0 if -analog_dead_zone <= value <= analog_dead_zone else value
+
+    throttle = 0
+    if ds.state.DpadUp:
+        throttle = 50
     elif ds.state.DpadDown:
-        command, value = Command.RETREAT, 50
-    elif ds.state.DpadLeft:
-        command, value = Command.TURN_LEFT, 50
-    elif not (-analog_dead_zone <= ds.state.LX <= analog_dead_zone):
-        if ds.state.LX < 0:
-            command = Command.TURN_LEFT
-            value = int(interpolate(ds.state.LX, -128, 0, 100, 0))
-        else:
-            command = Command.TURN_RIGHT
-            value = int(interpolate(ds.state.LX, 0, 127, 0, 100))
-    elif not (-analog_dead_zone <= ds.state.RX <= analog_dead_zone):
-        command = Command.LOOK_HORIZONTALLY
-        value = int(interpolate(ds.state.RX, -128, 127, -90, 90))
-    elif not (-analog_dead_zone <= ds.state.RY <= analog_dead_zone):
-        command = Command.LOOK_VERTICALLY
-        value = int(interpolate(ds.state.RY, -128, 127, 90, -90))
+        throttle = -50
     elif ds.state.R2 > 0:
-        command = Command.ADVANCE
-        value = int(interpolate(ds.state.R2, 0, 255, 0, 100))
+        throttle = int(interpolate(ds.state.R2, 0, 255, 0, 100))
+
+    steering = 0
+    if ds.state.DpadLeft:
+        steering = -50
+    elif ds.state.DpadRight:
+        steering = 50
+    elif lx := stick(ds.state.LX):
+        steering = int(interpolate(lx, -128, 127, -100, 100))
+
+    pan = int(interpolate(rx, -128, 127, -90, 90)) if (rx := stick(ds.state.RX)) else 0
+    tilt = int(interpolate(ry, -128, 127, 90, -90)) if (ry := stick(ds.state.RY)) else 0
 
-    return command, value
+    return DriveAndLook(throttle, steering, pan, tilt)
 
 
 def control(ws_conn: websockets.sync.client.ClientConnection, ds: pydualsense) -> None:
     """Read gamepad input in a loop and send commands to the car."""
     analog_dead_zone = 5
-    last_command = Command.BRAKE
-    last_value = None
+    last_state = DriveAndLook()
 
     while not ds.state.ps:
-        command, value = read_input(ds, analog_dead_zone)
+        state = read_input(ds, analog_dead_zone)
 
-        if (command != last_command) or (value != last_value):
-            logger.debug("Sending new command with value: %s - %s", command.name, value)
-            send_command(ws_conn, command, value)
-            last_command = command
-            last_value = value
+        if state != last_state:
+            logger.debug("Sending new input: %s", state)
+            send_drive_and_look(ws_conn, state)
+            last_state = state
 
 
 def main() -> None:
@@ -1,2 +1,137 @@
-def test_foo() -> None:
-    pass
+import json
+from dataclasses import dataclass, field
+
+import opentelemetry.trace
+import pytest
+from opentelemetry.sdk.trace import TracerProvider
+
+from controller.controller import (
+    Command,
+    DriveAndLook,
+    read_input,
+    send_drive_and_look,
+)
+
+ANALOG_DEAD_ZONE = 5
+
+
+@dataclass
+class _State:
+    DpadUp: bool = False
+    DpadDown: bool = False
+    DpadLeft: bool = False
+    DpadRight: bool = False
+    R2: int = 0
+    LX: int = 0
+    LY: int = 0
+    RX: int = 0
+    RY: int = 0
+    ps: bool = False
+
+
+@dataclass
+class _DualSense:
+    state: _State = field(default_factory=_State)
+
+
+@dataclass
+class _Connection:
+    sent: list[str] = field(default_factory=list)
+
+    def send(self, message: str) -> None:
+        self.sent.append(message)
+
+
+class TestReadInput:
+    def test_idle(self) -> None:
+        assert read_input(_DualSense(), ANALOG_DEAD_ZONE) == DriveAndLook()
+
+    @pytest.mark.parametrize(
+        ("state", "throttle"),
+        [
+            (_State(DpadUp=True), 50),
+            (_State(DpadDown=True), -50),
+            (_State(R2=255), 100),
+            (_State(R2=128), 50),
+            (_State(DpadUp=True, R2=255), 50),
+            (_State(DpadDown=True, R2=255), -50),
+        ],
+    )
+    def test_throttle(self, state: _State, throttle: int) -> None:
+        assert read_input(_DualSense(state), ANALOG_DEAD_ZONE).throttle == throttle
+
+    @pytest.mark.parametrize(
+        ("state", "steering"),
+        [
+            (_State(DpadLeft=True), -50),
+            (_State(DpadRight=True), 50),
+            (_State(LX=-128), -100),
+            (_State(LX=127), 100),
+            (_State(DpadRight=True, LX=-128), 50),
+        ],
+    )
+    def test_steering(self, state: _State, steering: int) -> None:
+        assert read_input(_DualSense(state), ANALOG_DEAD_ZONE).steering == steering
+
+    def test_right_stick_moves_camera(self) -> None:
+        ds = _DualSense(_State(RX=127, RY=-128))
+
+        assert read_input(ds, ANALOG_DEAD_ZONE) == DriveAndLook(pan=90, tilt=90)
+
+    def test_drives_and_looks_at_once(self) -> None:
+        ds = _DualSense(_State(R2=255, LX=127, RX=-128))
+
+        assert read_input(ds, ANALOG_DEAD_ZONE) == DriveAndLook(100, 100, -90, 0)
+
+    def test_stick_release_returns_to_idle(self) -> None:
+        ds = _DualSense(_State(LX=127, RX=127, RY=127))
+        assert read_input(ds, ANALOG_DEAD_ZONE) != DriveAndLook()
+
+        # A released stick rarely rests exactly at 0.
+        ds.state = _State(LX=ANALOG_DEAD_ZONE, RX=-ANALOG_DEAD_ZONE, RY=1)
+
+        assert read_input(ds, ANALOG_DEAD_ZONE) == DriveAndLook()
+
+    def test_releasing_r2_stops(self) -> None:
+        ds = _DualSense(_State(R2=255))
+        assert read_input(ds, ANALOG_DEAD_ZONE) == DriveAndLook(throttle=100)
+
+        ds.state = _State()
+
+        assert read_input(ds, ANALOG_DEAD_ZONE) == DriveAndLook()
+
+
+class TestSendDriveAndLook:
+    def test_sends_one_command(self) -> None:
+        connection = _Connection()
+
+        send_drive_and_look(connection, DriveAndLook(50, -20, 30, -10))  # type: ignore[arg-type]
+
+        assert len(connection.sent) == 1
+        payload = json.loads(connection.sent[0])
+        payload.pop("traceparent", None)
+        payload.pop("tracestate", None)
+        assert payload == {
+            "command": Command.DRIVE_AND_LOOK.value,
+            "throttle": 50,
+            "steering": -20,
+            "pan": 30,
+            "tilt": -10,
+        }
+
+    def test_sends_idle_input(self) -> None:
+        connection = _Connection()
+
+        send_drive_and_look(connection, DriveAndLook())  # type: ignore[arg-type]
+
+        payload = json.loads(connection.sent[0])
+        assert payload["throttle"] == payload["steering"] == 0
+        assert payload["pan"] == payload["tilt"] == 0
+
+    def test_carries_trace_context(self) -> None:
+        opentelemetry.trace.set_tracer_provider(TracerProvider())
+        connection = _Connection()
+
+        send_drive_and_look(connection, DriveAndLook(50))  # type: ignore[arg-type]
+
+        assert "traceparent" in json.loads(connection.sent[0])
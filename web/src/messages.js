@@ -6,7 +6,8 @@ export function updateStream(image, data) {
 }
 
 export function updateTelemetry(elements, data) {
-  elements.timestamp.innerText = data.timestamp;
+  // Car clock (esp_timer, microseconds since boot).
+  elements.timestamp.innerText = `${(data.timestamp_us / 1e6).toFixed(3)} s`;
   elements.rssi.innerText = `${data.rssi} dBm`;
   elements.speed.innerText = `${data.speed.toFixed(2)} km/h`;
 
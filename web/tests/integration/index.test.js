@@ -38,7 +38,7 @@ describe("handleMessage", () => {
       {
         type: "telemetry",
         data: {
-          timestamp: "2024-01-01T00:00:00Z",
+          timestamp_us: 86400123456,
           rssi: -50,
           speed: 5.25,
           accelerometer: { x: 0.1, y: -0.2, z: 9.8 },
@@ -38,7 +38,7 @@ describe("updateTelemetry", () => {
 
   test("renders all telemetry fields with correct formatting", () => {
     updateTelemetry(elements, {
-      timestamp: "2024-01-01T00:00:00Z",
+      timestamp_us: 86400123456,
       rssi: -50,
       speed: 5.256,
       accelerometer: { x: 0.1, y: -0.2, z: 9.8 },
@@ -47,7 +47,7 @@ describe("updateTelemetry", () => {
       distance_ahead: 150,
     });
 
-    expect(elements.timestamp.innerText).toBe("2024-01-01T00:00:00Z");
+    expect(elements.timestamp.innerText).toBe("86400.123 s");
     expect(elements.rssi.innerText).toBe("-50 dBm");
     expect(elements.speed.innerText).toBe("5.26 km/h");
     expect(elements.accelerometer.innerText).toBe("0.10, -0.20, 9.80 g");